@@ -0,0 +1,133 @@
+// AXI4-Lite master for the ram port of rv32_core, see bus_master for how
+// the core's accesses map to requests. Reads go out on AR with arprot[2]
+// set for the fetch stream, writes on AW and W together. Up to
+// 2**DEPTH_LOG2 reads are in flight, the responses of AXI4-Lite come back
+// in order. bready and rready are always high.
+//
+// AXI4-Lite has no locked access, arlock and awlock carry req_lock of
+// bus_master the way AXI3 locked transfers did, for a memory that holds
+// off other masters until a request comes without.
+module axi_lite_master
+    # (
+        parameter ADDR_WIDTH  = 16,
+        // see bus_master
+        parameter DEPTH_LOG2  = 2,
+        parameter FETCH_PAIRS = 0
+    )
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        // ram port of rv32_core
+        input  wire                     ram_req,
+        input  wire                     ram_lock,
+        input  wire                     ram_fetch,
+        input  wire                     ram_wr_en,
+        input  wire [4-1:0]             ram_wr_strobe,
+        input  wire [ADDR_WIDTH-1:0]    ram_addr,
+        input  wire [32-1:0]            ram_data_in,
+        output wire [32-1:0]            ram_data_out,
+        output wire [32-1:0]            ram_fetch_hi,
+        output wire                     ram_gnt,
+        output wire                     bus_error,
+        // AXI4-Lite, byte addresses
+        output wire                     awvalid,
+        input  wire                     awready,
+        output wire [ADDR_WIDTH+2-1:0]  awaddr,
+        output wire [3-1:0]             awprot,
+        output wire                     awlock,
+        output wire                     wvalid,
+        input  wire                     wready,
+        output wire [32-1:0]            wdata,
+        output wire [4-1:0]             wstrb,
+        input  wire                     bvalid,
+        output wire                     bready,
+        input  wire [2-1:0]             bresp,
+        output wire                     arvalid,
+        input  wire                     arready,
+        output wire [ADDR_WIDTH+2-1:0]  araddr,
+        output wire [3-1:0]             arprot,
+        output wire                     arlock,
+        input  wire                     rvalid,
+        output wire                     rready,
+        input  wire [32-1:0]            rdata,
+        input  wire [2-1:0]             rresp
+    );
+
+    wire                    req_valid;
+    wire                    req_ready;
+    wire                    req_we;
+    wire                    req_fetch;
+    wire                    req_lock;
+    wire [ADDR_WIDTH-1:0]   req_addr;
+    wire [32-1:0]           req_data;
+    wire [4-1:0]            req_strobe;
+
+    // the halves of a write accepted on an earlier cycle than the other
+    reg                     aw_sent;
+    reg                     w_sent;
+
+    assign awvalid   = req_valid && req_we && !aw_sent;
+    assign awaddr    = {req_addr, 2'b00};
+    assign awprot    = 3'b000;
+    assign awlock    = req_lock;
+    assign wvalid    = req_valid && req_we && !w_sent;
+    assign wdata     = req_data;
+    assign wstrb     = req_strobe;
+    assign bready    = 1'b1;
+    assign arvalid   = req_valid && !req_we;
+    assign araddr    = {req_addr, 2'b00};
+    assign arprot    = {req_fetch, 2'b00};
+    assign arlock    = req_lock;
+    assign rready    = 1'b1;
+    assign req_ready = req_we ? (aw_sent || awready) && (w_sent || wready) : arready;
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            aw_sent <= 1'b0;
+            w_sent  <= 1'b0;
+        end else if (req_valid && req_we && req_ready) begin
+            aw_sent <= 1'b0;
+            w_sent  <= 1'b0;
+        end else begin
+            aw_sent <= aw_sent || (awvalid && awready);
+            w_sent  <= w_sent || (wvalid && wready);
+        end
+    end
+
+    // reads and writes are never in flight together, so one of the two
+    // response channels answers the oldest request
+    bus_master
+    #(
+        .ADDR_WIDTH  ( ADDR_WIDTH  ),
+        .DEPTH_LOG2  ( DEPTH_LOG2  ),
+        .FETCH_PAIRS ( FETCH_PAIRS )
+    )
+    bus_inst
+    (
+        .clk           ( clk                                ),
+        .reset_n       ( reset_n                            ),
+        .ram_req       ( ram_req                            ),
+        .ram_lock      ( ram_lock                           ),
+        .ram_fetch     ( ram_fetch                          ),
+        .ram_wr_en     ( ram_wr_en                          ),
+        .ram_wr_strobe ( ram_wr_strobe                      ),
+        .ram_addr      ( ram_addr                           ),
+        .ram_data_in   ( ram_data_in                        ),
+        .ram_data_out  ( ram_data_out                       ),
+        .ram_fetch_hi  ( ram_fetch_hi                       ),
+        .ram_gnt       ( ram_gnt                            ),
+        .req_valid     ( req_valid                          ),
+        .req_ready     ( req_ready                          ),
+        .req_we        ( req_we                             ),
+        .req_fetch     ( req_fetch                          ),
+        .req_lock      ( req_lock                           ),
+        .req_addr      ( req_addr                           ),
+        .req_data      ( req_data                           ),
+        .req_strobe    ( req_strobe                         ),
+        .rsp_valid     ( rvalid || bvalid                   ),
+        .rsp_data      ( rdata                              ),
+        .rsp_err       ( rvalid ? rresp[1] : bresp[1]       ),
+        .bus_error     ( bus_error                          )
+    );
+
+endmodule
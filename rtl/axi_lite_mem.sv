@@ -0,0 +1,103 @@
+// AXI4-Lite slave over bus_delay, the latency injecting memory for
+// axi_lite_master in top.sv. A write is taken once AW and W are both valid,
+// reads and writes share one queue and answer in the order they came in.
+// Responses are always OKAY. arlock and awlock keep the ram port, see
+// axi_lite_master and bus_delay.
+module axi_lite_mem
+    # (
+        parameter ADDR_WIDTH = 16,
+        // see bus_delay
+        parameter DEPTH_LOG2 = 3
+    )
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        input  wire [8-1:0]             lat_min,
+        input  wire [8-1:0]             lat_max,
+        // AXI4-Lite, byte addresses, the protection bits are not checked
+        input  wire                     awvalid,
+        output wire                     awready,
+        // verilator lint_off UNUSEDSIGNAL
+        input  wire [ADDR_WIDTH+2-1:0]  awaddr,
+        input  wire [3-1:0]             awprot,
+        // verilator lint_on UNUSEDSIGNAL
+        input  wire                     awlock,
+        input  wire                     wvalid,
+        output wire                     wready,
+        input  wire [32-1:0]            wdata,
+        input  wire [4-1:0]             wstrb,
+        output wire                     bvalid,
+        input  wire                     bready,
+        output wire [2-1:0]             bresp,
+        input  wire                     arvalid,
+        output wire                     arready,
+        // verilator lint_off UNUSEDSIGNAL
+        input  wire [ADDR_WIDTH+2-1:0]  araddr,
+        input  wire [3-1:0]             arprot,
+        // verilator lint_on UNUSEDSIGNAL
+        input  wire                     arlock,
+        output wire                     rvalid,
+        input  wire                     rready,
+        output wire [32-1:0]            rdata,
+        output wire [2-1:0]             rresp,
+        // ram master port
+        output wire                     ram_req,
+        output wire                     ram_lock,
+        input  wire                     ram_gnt,
+        output wire                     ram_wr_en,
+        output wire [4-1:0]             ram_wr_strobe,
+        output wire [ADDR_WIDTH-1:0]    ram_addr,
+        output wire [32-1:0]            ram_data_in,
+        input  wire [32-1:0]            ram_data_out
+    );
+
+    wire                    write;
+    wire [ADDR_WIDTH-1:0]   addr;
+    wire                    req_ready;
+    wire                    rsp_valid;
+    wire                    rsp_we;
+
+    // a complete write goes first
+    assign write   = awvalid && wvalid;
+    assign addr    = write ? awaddr[ADDR_WIDTH+2-1:2] : araddr[ADDR_WIDTH+2-1:2];
+    assign awready = write && req_ready;
+    assign wready  = write && req_ready;
+    assign arready = !write && req_ready;
+    assign bvalid  = rsp_valid && rsp_we;
+    assign bresp   = 2'b00;
+    assign rvalid  = rsp_valid && !rsp_we;
+    assign rresp   = 2'b00;
+
+    bus_delay
+    #(
+        .ADDR_WIDTH ( ADDR_WIDTH ),
+        .DEPTH_LOG2 ( DEPTH_LOG2 )
+    )
+    delay_inst
+    (
+        .clk           ( clk                      ),
+        .reset_n       ( reset_n                  ),
+        .lat_min       ( lat_min                  ),
+        .lat_max       ( lat_max                  ),
+        .req_valid     ( write || arvalid         ),
+        .req_ready     ( req_ready                ),
+        .req_we        ( write                    ),
+        .req_lock      ( write ? awlock : arlock  ),
+        .req_addr      ( addr                     ),
+        .req_data      ( wdata                    ),
+        .req_strobe    ( wstrb                    ),
+        .rsp_valid     ( rsp_valid                ),
+        .rsp_ready     ( rsp_we ? bready : rready ),
+        .rsp_we        ( rsp_we                   ),
+        .rsp_data      ( rdata                    ),
+        .ram_req       ( ram_req                  ),
+        .ram_lock      ( ram_lock                 ),
+        .ram_gnt       ( ram_gnt                  ),
+        .ram_wr_en     ( ram_wr_en                ),
+        .ram_wr_strobe ( ram_wr_strobe            ),
+        .ram_addr      ( ram_addr                 ),
+        .ram_data_in   ( ram_data_in              ),
+        .ram_data_out  ( ram_data_out             )
+    );
+
+endmodule
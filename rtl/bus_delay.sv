@@ -0,0 +1,133 @@
+// Latency injecting memory behind axi_lite_mem and wb_mem, a master on the
+// shared ram port like a hart. Each request accepted on the valid/ready side
+// is due lat_min to lat_max cycles later, drawn from an LFSR, and takes a
+// granted cycle on the ram port once it is the oldest and due. Its response
+// follows on the next cycle, in request order. Up to 2**DEPTH_LOG2 requests
+// are held, so the latencies of back to back requests overlap.
+//
+// A request with req_lock keeps the ram port locked after its access, every
+// cycle until the access of one without, so the master's locked sequence
+// reaches the ram with no other master in between.
+module bus_delay
+    # (
+        parameter ADDR_WIDTH = 16,
+        parameter DEPTH_LOG2 = 3
+    )
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        // latency range in cycles on top of the minimum of two, lat_max
+        // below lat_min counts as lat_min
+        input  wire [8-1:0]             lat_min,
+        input  wire [8-1:0]             lat_max,
+        // requests
+        input  wire                     req_valid,
+        output wire                     req_ready,
+        input  wire                     req_we,
+        input  wire                     req_lock,
+        input  wire [ADDR_WIDTH-1:0]    req_addr,
+        input  wire [32-1:0]            req_data,
+        input  wire [4-1:0]             req_strobe,
+        // responses, the oldest request once it is done
+        output wire                     rsp_valid,
+        input  wire                     rsp_ready,
+        output wire                     rsp_we,
+        output wire [32-1:0]            rsp_data,
+        // ram master port
+        output wire                     ram_req,
+        output wire                     ram_lock,
+        input  wire                     ram_gnt,
+        output wire                     ram_wr_en,
+        output wire [4-1:0]             ram_wr_strobe,
+        output wire [ADDR_WIDTH-1:0]    ram_addr,
+        output wire [32-1:0]            ram_data_in,
+        input  wire [32-1:0]            ram_data_out
+    );
+
+    localparam DEPTH = 2**DEPTH_LOG2;
+
+    reg  [32-1:0]           now;
+    reg  [32-1:0]           lfsr;
+    reg  [8-1:0]            lat;
+
+    reg                     q_we[DEPTH];
+    reg                     q_lock[DEPTH];
+    reg  [ADDR_WIDTH-1:0]   q_addr[DEPTH];
+    reg  [32-1:0]           q_data[DEPTH];
+    reg  [4-1:0]            q_strobe[DEPTH];
+    reg  [32-1:0]           q_due[DEPTH];
+    reg                     q_done;
+    reg  [DEPTH_LOG2-1:0]   q_rd;
+    reg  [DEPTH_LOG2-1:0]   q_wr;
+    reg  [DEPTH_LOG2:0]     q_count;
+    // the last access asked to keep the port
+    reg                     held;
+
+    wire                    due;
+
+    // lat_min plus the LFSR folded into the range
+    always_comb begin
+        if (lat_max <= lat_min) begin
+            lat = lat_min;
+        end else begin
+            lat = lat_min + 8'(lfsr[15:0] % (16'(lat_max - lat_min) + 16'd1));
+        end
+    end
+
+    assign req_ready     = q_count != (DEPTH_LOG2+1)'(DEPTH);
+    assign due           = q_count != '0 && !q_done && $signed(now - q_due[q_rd]) >= 0;
+
+    assign rsp_valid     = q_count != '0 && q_done;
+    assign rsp_we        = q_we[q_rd];
+
+    // a held port is requested and locked on every cycle, the grants in
+    // between accesses read and are ignored
+    assign ram_req       = due || held;
+    assign ram_lock      = due ? q_lock[q_rd] : held;
+    assign ram_wr_en     = due && q_we[q_rd];
+    assign ram_wr_strobe = q_strobe[q_rd];
+    assign ram_addr      = q_addr[q_rd];
+    assign ram_data_in   = q_data[q_rd];
+
+    // the read word of the oldest request, taken on its granted cycle
+    reg  [32-1:0]           rd_data;
+
+    assign rsp_data      = rd_data;
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            now     <= '0;
+            lfsr    <= 32'h1;
+            q_done  <= 1'b0;
+            q_rd    <= '0;
+            q_wr    <= '0;
+            q_count <= '0;
+            held    <= 1'b0;
+            rd_data <= '0;
+        end else begin
+            now <= now + 32'd1;
+            if (req_valid && req_ready) begin
+                q_we[q_wr]     <= req_we;
+                q_lock[q_wr]   <= req_lock;
+                q_addr[q_wr]   <= req_addr;
+                q_data[q_wr]   <= req_data;
+                q_strobe[q_wr] <= req_strobe;
+                q_due[q_wr]    <= now + 32'd1 + 32'(lat);
+                q_wr           <= q_wr + 1'b1;
+                // Galois LFSR, x^32 + x^22 + x^2 + x + 1
+                lfsr           <= {1'b0, lfsr[31:1]} ^ (lfsr[0] ? 32'h80200003 : 32'h0);
+            end
+            if (due && ram_gnt) begin
+                q_done  <= 1'b1;
+                held    <= q_lock[q_rd];
+                rd_data <= ram_data_out;
+            end
+            if (rsp_valid && rsp_ready) begin
+                q_done <= 1'b0;
+                q_rd   <= q_rd + 1'b1;
+            end
+            q_count <= q_count + (DEPTH_LOG2+1)'(req_valid && req_ready) - (DEPTH_LOG2+1)'(rsp_valid && rsp_ready);
+        end
+    end
+
+endmodule
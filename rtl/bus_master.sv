@@ -0,0 +1,288 @@
+// Bus front end for the ram port of rv32_core, shared by axi_lite_master and
+// wb_master. The core expects the word on the cycle it is granted, so a
+// cycle is only granted once the bus answered: a read with its word, a write
+// once its response is back. Requests go out on a valid/ready channel and
+// their responses come back in the same order.
+//
+// Fetches run ahead of the core. From the address of a fetch on, up to
+// 2**DEPTH_LOG2 sequential words are requested and kept in a stream buffer,
+// a fetch anywhere else restarts the stream and drops the words still in
+// flight. Loads go out between the stream requests without disturbing it.
+// A write waits until no read is in flight and holds back the reads until
+// its response, so neither passes the other on buses with separate read and
+// write channels, and it restarts the stream if it lands on a buffered word.
+//
+// A cycle the core locks, the read half of an AMO or the check of a
+// passing SC, is only granted once the memory is held for this master: a
+// lock request goes out first and the memory keeps its port from that
+// access on. req_lock stays high on everything sent until the write that
+// ends the section, or until a release read if the core drops the lock
+// without one, so no other master gets in between. The core has to be
+// built with SYNC_READ = 0.
+module bus_master
+    # (
+        parameter ADDR_WIDTH  = 16,
+        // log2 of the requests in flight and of the stream buffer words,
+        // at least 1
+        parameter DEPTH_LOG2  = 2,
+        // a fetch from an even word also waits for the odd one, for the
+        // ram_fetch_hi of a DUAL_ISSUE or FUSION core
+        parameter FETCH_PAIRS = 0
+    )
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        // ram port of rv32_core
+        input  wire                     ram_req,
+        input  wire                     ram_lock,
+        input  wire                     ram_fetch,
+        input  wire                     ram_wr_en,
+        input  wire [4-1:0]             ram_wr_strobe,
+        input  wire [ADDR_WIDTH-1:0]    ram_addr,
+        input  wire [32-1:0]            ram_data_in,
+        output wire [32-1:0]            ram_data_out,
+        output wire [32-1:0]            ram_fetch_hi,
+        output wire                     ram_gnt,
+        // requests, held until req_ready. req_fetch marks stream reads,
+        // req_lock asks the memory to keep its port after this one.
+        output reg                      req_valid,
+        input  wire                     req_ready,
+        output reg                      req_we,
+        output reg                      req_fetch,
+        output reg                      req_lock,
+        output reg  [ADDR_WIDTH-1:0]    req_addr,
+        output reg  [32-1:0]            req_data,
+        output reg  [4-1:0]             req_strobe,
+        // one response per request, in request order, always taken
+        input  wire                     rsp_valid,
+        input  wire [32-1:0]            rsp_data,
+        input  wire                     rsp_err,
+        // a response came back with an error, held until reset
+        output reg                      bus_error
+    );
+
+    localparam DEPTH = 2**DEPTH_LOG2;
+
+    localparam KIND_STREAM = 3'd0;
+    localparam KIND_LOAD   = 3'd1;
+    localparam KIND_WRITE  = 3'd2;
+    localparam KIND_DROP   = 3'd3;
+    localparam KIND_LOCK   = 3'd4;
+
+    // stream buffer, st_count words from st_addr on are requested, the
+    // first of them in slot st_head
+    reg  [ADDR_WIDTH-1:0]   st_addr;
+    reg  [DEPTH_LOG2-1:0]   st_head;
+    reg  [DEPTH_LOG2:0]     st_count;
+    reg  [DEPTH-1:0]        st_valid;
+    reg  [32-1:0]           st_data[DEPTH];
+
+    // requests in flight, the one in the req_ registers included
+    reg  [2:0]              fl_kind[DEPTH];
+    reg  [DEPTH_LOG2-1:0]   fl_slot[DEPTH];
+    reg  [DEPTH_LOG2-1:0]   fl_rd;
+    reg  [DEPTH_LOG2-1:0]   fl_wr;
+    reg  [DEPTH_LOG2:0]     fl_count;
+
+    // the load or write the core waits for
+    reg                     ld_busy;
+    reg                     ld_have;
+    reg  [32-1:0]           ld_data;
+    reg                     wr_busy;
+    reg                     wr_done;
+
+    // lk_section from the lock request to the end of the section, lk_held
+    // once the lock request came back, lk_mem the req_lock of the last
+    // request sent
+    reg                     lk_section;
+    reg                     lk_held;
+    reg                     lk_mem;
+
+    wire                    fetch;
+    wire                    load;
+    wire                    write;
+    wire                    st_hit;
+    wire                    st_ready;
+    wire                    restart;
+    wire                    wr_restart;
+    wire                    fetch_gnt;
+    wire                    ld_gnt;
+    wire                    wr_gnt;
+    wire                    lock_ok;
+    wire                    lock_start;
+    wire                    lock_end;
+    wire                    lock_next;
+    wire                    req_free;
+    wire                    fl_free;
+    wire                    issue_write;
+    wire                    issue_lock;
+    wire                    issue_load;
+    wire                    issue_stream;
+    wire                    issue_release;
+    wire                    issue;
+    wire [DEPTH_LOG2-1:0]   st_next;
+
+    assign fetch      = ram_req && !ram_wr_en && ram_fetch;
+    assign load       = ram_req && !ram_wr_en && !ram_fetch;
+    assign write      = ram_req && ram_wr_en;
+
+    // an empty stream at the fetch address is a hit, it fills from there
+    assign st_hit     = st_addr == ram_addr;
+    assign st_ready   = st_valid[st_head] &&
+                        (FETCH_PAIRS == 0 || ram_addr[0] || (st_count > 1 && st_valid[st_head + 1'b1]));
+    assign restart    = fetch && !st_hit;
+    // ram_addr - st_addr wraps to a large value below the stream
+    assign wr_restart = write && !wr_busy && !wr_done && ADDR_WIDTH'(ram_addr - st_addr) < ADDR_WIDTH'(st_count);
+
+    // a locked cycle waits for the memory to be held
+    assign lock_ok    = !ram_lock || lk_held;
+    assign fetch_gnt  = fetch && st_hit && st_ready && lock_ok;
+    assign ld_gnt     = load && ld_have && lock_ok;
+    assign wr_gnt     = write && wr_done && lock_ok;
+
+    // the section ends with the first write the core does not lock, or
+    // with any other cycle it does not lock
+    assign lock_start = ram_req && ram_lock && !lk_section;
+    assign lock_end   = lk_section && ram_req && !ram_lock && (!write || issue_write);
+    assign lock_next  = (lk_section || issue_lock) && !lock_end;
+
+    assign ram_gnt      = fetch_gnt || ld_gnt || wr_gnt;
+    assign ram_data_out = fetch ? st_data[st_head] : ld_data;
+    assign ram_fetch_hi = st_data[st_head + 1'b1];
+
+    // one request a cycle into the req_ registers once they are free, the
+    // core's access first, a write only with nothing else in flight. The
+    // lock request goes ahead of the access it is for, and a release read
+    // goes out when the section ended with nothing else to send.
+    assign req_free      = !req_valid || req_ready;
+    assign fl_free       = fl_count != (DEPTH_LOG2+1)'(DEPTH);
+    assign st_next       = st_head + st_count[DEPTH_LOG2-1:0];
+    assign issue_lock    = req_free && fl_free && lock_start && !wr_busy;
+    assign issue_write   = req_free && write && !wr_busy && !wr_done && fl_count == '0 && !lock_start;
+    assign issue_load    = req_free && fl_free && load && !ld_busy && !ld_have && !wr_busy &&
+                           (!ram_lock || lk_section);
+    assign issue_stream  = req_free && fl_free && !write && !wr_busy && !restart && !issue_load &&
+                           !lock_start && st_count != (DEPTH_LOG2+1)'(DEPTH);
+    assign issue_release = req_free && fl_free && lk_mem && !lock_next && !wr_busy &&
+                           !issue_write && !issue_lock && !issue_load && !issue_stream;
+    assign issue         = issue_write || issue_lock || issue_load || issue_stream || issue_release;
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            st_addr    <= '0;
+            st_head    <= '0;
+            st_count   <= '0;
+            st_valid   <= '0;
+            fl_rd      <= '0;
+            fl_wr      <= '0;
+            fl_count   <= '0;
+            ld_busy    <= 1'b0;
+            ld_have    <= 1'b0;
+            ld_data    <= '0;
+            wr_busy    <= 1'b0;
+            wr_done    <= 1'b0;
+            lk_section <= 1'b0;
+            lk_held    <= 1'b0;
+            lk_mem     <= 1'b0;
+            req_valid  <= 1'b0;
+            req_we     <= 1'b0;
+            req_fetch  <= 1'b0;
+            req_lock   <= 1'b0;
+            req_addr   <= '0;
+            req_data   <= '0;
+            req_strobe <= '0;
+            bus_error  <= 1'b0;
+        end else begin
+            if (req_valid && req_ready) begin
+                req_valid <= 1'b0;
+            end
+
+            // responses
+            if (rsp_valid) begin
+                case (fl_kind[fl_rd])
+                    default: begin
+                    end
+                    KIND_STREAM: begin
+                        st_valid[fl_slot[fl_rd]] <= 1'b1;
+                        st_data[fl_slot[fl_rd]]  <= rsp_data;
+                    end
+                    KIND_LOAD: begin
+                        ld_busy <= 1'b0;
+                        ld_have <= 1'b1;
+                        ld_data <= rsp_data;
+                    end
+                    KIND_WRITE: begin
+                        wr_busy <= 1'b0;
+                        wr_done <= 1'b1;
+                    end
+                    KIND_LOCK: begin
+                        lk_held <= 1'b1;
+                    end
+                endcase
+                fl_rd <= fl_rd + 1'b1;
+                if (rsp_err) begin
+                    bus_error <= 1'b1;
+                end
+            end
+
+            // the core takes its word
+            if (fetch_gnt) begin
+                st_valid[st_head] <= 1'b0;
+                st_head           <= st_head + 1'b1;
+                st_addr           <= st_addr + 1'b1;
+            end
+            if (ld_gnt) begin
+                ld_have <= 1'b0;
+            end
+            if (wr_gnt) begin
+                wr_done <= 1'b0;
+            end
+
+            // new requests
+            if (issue) begin
+                req_valid      <= 1'b1;
+                req_we         <= issue_write;
+                req_fetch      <= issue_stream;
+                req_lock       <= lock_next;
+                req_addr       <= issue_stream ? st_addr + ADDR_WIDTH'(st_count) : ram_addr;
+                req_data       <= ram_data_in;
+                req_strobe     <= issue_write ? ram_wr_strobe : 4'b1111;
+                fl_kind[fl_wr] <= issue_write ? KIND_WRITE : issue_lock ? KIND_LOCK :
+                                  issue_load  ? KIND_LOAD  : issue_stream ? KIND_STREAM : KIND_DROP;
+                fl_slot[fl_wr] <= st_next;
+                fl_wr          <= fl_wr + 1'b1;
+                lk_mem         <= lock_next;
+            end
+            if (issue_write) begin
+                wr_busy <= 1'b1;
+            end
+            if (issue_load) begin
+                ld_busy <= 1'b1;
+            end
+            fl_count <= fl_count + (DEPTH_LOG2+1)'(issue) - (DEPTH_LOG2+1)'(rsp_valid);
+            st_count <= st_count + (DEPTH_LOG2+1)'(issue_stream) - (DEPTH_LOG2+1)'(fetch_gnt);
+
+            lk_section <= lock_next;
+            if (!lock_next) begin
+                lk_held <= 1'b0;
+            end
+
+            // a fetch off the stream starts it over at its address, the
+            // words on the way are dropped as they come back, and so is a
+            // lock request whose section already ended
+            for (int i = 0; i < DEPTH; i++) begin
+                if (DEPTH_LOG2'(DEPTH_LOG2'(i) - fl_rd) < fl_count &&
+                    ((fl_kind[i] == KIND_STREAM && (restart || wr_restart)) ||
+                     (fl_kind[i] == KIND_LOCK && lock_end))) begin
+                    fl_kind[i] <= KIND_DROP;
+                end
+            end
+            if (restart || wr_restart) begin
+                st_addr  <= restart ? ram_addr : st_addr;
+                st_count <= '0;
+                st_valid <= '0;
+            end
+        end
+    end
+
+endmodule
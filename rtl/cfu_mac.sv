@@ -0,0 +1,90 @@
+// Example accelerator for the custom-0 port of rv32_core, and the interface
+// any other one plugs in with. start is high for one cycle with the function
+// and both operands, done comes on that cycle or any later one with the
+// result. A new start only follows done.
+//
+//  func3 | operation
+//  ------+-------------------------------------------------------------------
+//  0     | mul, low word of rs1 * rs2, done 8 cycles after start
+//  1     | mulhu, high word of the unsigned rs1 * rs2, the same
+//  2     | sad, sum of the absolute differences of the four byte lanes, on
+//        | the start cycle
+//  other | 0, on the start cycle
+//
+// The core has no multiplier, the multiply retires 4 bits of rs2 a cycle.
+module cfu_mac
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        input  wire                     start,
+        // {func7, func3} of the instruction, func7 is not used here
+        // verilator lint_off UNUSEDSIGNAL
+        input  wire [10-1:0]            func,
+        // verilator lint_on UNUSEDSIGNAL
+        input  wire [32-1:0]            rs1,
+        input  wire [32-1:0]            rs2,
+        output wire                     done,
+        output wire [32-1:0]            result
+    );
+
+    localparam FUNC_MUL   = 3'd0;
+    localparam FUNC_MULHU = 3'd1;
+    localparam FUNC_SAD   = 3'd2;
+
+    reg         busy;
+    reg         high;
+    reg  [2:0]  step;
+    reg  [31:0] mcand;
+    reg  [31:0] mplier;
+    reg  [63:0] acc;
+
+    wire        is_mul;
+    wire [63:0] partial;
+    wire [63:0] product;
+    reg  [9:0]  sad;
+
+    // the partial product of this cycle's nibble, the last one completes the
+    // product combinationally
+    assign is_mul  = func[2:0] == FUNC_MUL || func[2:0] == FUNC_MULHU;
+    assign partial = 64'(36'(mcand) * 36'(mplier[3:0])) << {step, 2'b00};
+    assign product = acc + partial;
+
+    always_comb begin
+        sad = '0;
+        for (int i = 0; i < 4; i++) begin
+            if (rs1[i*8 +: 8] > rs2[i*8 +: 8]) begin
+                sad = sad + 10'(rs1[i*8 +: 8] - rs2[i*8 +: 8]);
+            end else begin
+                sad = sad + 10'(rs2[i*8 +: 8] - rs1[i*8 +: 8]);
+            end
+        end
+    end
+
+    assign done   = busy ? step == 3'd7 : start && !is_mul;
+    assign result = busy                  ? (high ? product[63:32] : product[31:0]) :
+                    func[2:0] == FUNC_SAD ? 32'(sad) : 32'd0;
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            busy   <= 1'b0;
+            high   <= 1'b0;
+            step   <= '0;
+            mcand  <= '0;
+            mplier <= '0;
+            acc    <= '0;
+        end else if (busy) begin
+            acc    <= product;
+            mplier <= mplier >> 4;
+            step   <= step + 3'd1;
+            busy   <= step != 3'd7;
+        end else if (start && is_mul) begin
+            busy   <= 1'b1;
+            high   <= func[2:0] == FUNC_MULHU;
+            step   <= '0;
+            mcand  <= rs1;
+            mplier <= rs2;
+            acc    <= '0;
+        end
+    end
+
+endmodule
@@ -0,0 +1,81 @@
+// The example accelerator behind a peripheral register window, the way
+// firmware reaches it without the custom-0 port. Kept as the baseline the
+// custom instructions are measured against, see src/cfu.cpp.
+//
+//  byte offset | register
+//  ------------+-------------------------------------------------------------
+//  0x00        | rs1
+//  0x04        | rs2
+//  0x08        | write {func7, func3} to start, reads bit 0 busy
+//  0x0c        | result of the last operation
+module cfu_mmio
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        // register port, addr is the word offset inside the block
+        input  wire                     reg_wr_en,
+        input  wire [2-1:0]             reg_addr,
+        input  wire [32-1:0]            reg_data_in,
+        output reg  [32-1:0]            reg_data_out
+    );
+
+    localparam REG_RS1    = 2'd0;
+    localparam REG_RS2    = 2'd1;
+    localparam REG_FUNC   = 2'd2;
+    localparam REG_RESULT = 2'd3;
+
+    reg  [31:0] rs1;
+    reg  [31:0] rs2;
+    reg  [31:0] result;
+    reg         busy;
+
+    wire        start;
+    wire        done;
+    wire [31:0] cfu_result;
+
+    assign start = reg_wr_en && reg_addr == REG_FUNC && !busy;
+
+    cfu_mac cfu_inst
+    (
+        .clk     ( clk                ),
+        .reset_n ( reset_n            ),
+        .start   ( start              ),
+        .func    ( reg_data_in[9:0]   ),
+        .rs1     ( rs1                ),
+        .rs2     ( rs2                ),
+        .done    ( done               ),
+        .result  ( cfu_result         )
+    );
+
+    always_comb begin
+        case (reg_addr)
+            REG_RS1:    reg_data_out = rs1;
+            REG_RS2:    reg_data_out = rs2;
+            REG_FUNC:   reg_data_out = {31'd0, busy};
+            REG_RESULT: reg_data_out = result;
+        endcase
+    end
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            rs1    <= '0;
+            rs2    <= '0;
+            result <= '0;
+            busy   <= 1'b0;
+        end else begin
+            if (reg_wr_en && reg_addr == REG_RS1) begin
+                rs1 <= reg_data_in;
+            end
+            if (reg_wr_en && reg_addr == REG_RS2) begin
+                rs2 <= reg_data_in;
+            end
+            if (done) begin
+                result <= cfu_result;
+                busy   <= 1'b0;
+            end else if (start) begin
+                busy   <= 1'b1;
+            end
+        end
+    end
+
+endmodule
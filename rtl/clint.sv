@@ -0,0 +1,117 @@
+// Core local interruptor, a compact take on the SiFive CLINT register map.
+//
+//  byte offset | register
+//  ------------+-------------------------------------------------------------
+//  0x00 / 0x04 | mtime lo / hi
+//  0x08        | doorbell, reads 1 while the host line is pending, write 1 to
+//              | clear
+//  0x20 + 4*h  | msip for hart h, bit 0
+//  0x40 + 8*h  | mtimecmp lo / hi for hart h
+module clint
+    # (
+        parameter NUM_HARTS = 1
+    )
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        // register port, addr is the word offset inside the block
+        input  wire                     wr_en,
+        input  wire [4-1:0]             wr_strobe,
+        input  wire [5-1:0]             addr,
+        input  wire [32-1:0]            data_in,
+        output reg  [32-1:0]            data_out,
+        // host doorbell, latched until firmware clears it
+        input  wire                     ext_irq_set,
+        // see rv32_core, only a Verilated model adds it
+        input  wire [32-1:0]            time_skip,
+        output wire [NUM_HARTS-1:0]     timer_irq,
+        output wire [NUM_HARTS-1:0]     soft_irq,
+        output wire                     ext_irq
+    );
+
+    reg [63:0]              mtime;
+    reg [63:0]              mtimecmp[NUM_HARTS];
+    reg [NUM_HARTS-1:0]     msip;
+    reg                     doorbell;
+
+    wire [31:0] wr_mask;
+
+    genvar i;
+    generate
+        for (i = 0; i < 4; i = i + 1) begin
+            assign wr_mask[i*8+7:i*8] = wr_strobe[i] ? 8'hff : 8'h00;
+        end
+        for (i = 0; i < NUM_HARTS; i = i + 1) begin
+            assign timer_irq[i] = mtime >= mtimecmp[i];
+        end
+    endgenerate
+
+    assign soft_irq = msip;
+    assign ext_irq  = doorbell;
+
+    always_comb begin
+        data_out = 32'd0;
+        case (addr)
+            default: begin
+            end
+            5'd0: data_out = mtime[31:0];
+            5'd1: data_out = mtime[63:32];
+            5'd2: data_out = {31'd0, doorbell};
+        endcase
+        for (int h = 0; h < NUM_HARTS; h++) begin
+            if (addr == 5'(8 + h)) begin
+                data_out = {31'd0, msip[h]};
+            end
+            if (addr == 5'(16 + 2 * h)) begin
+                data_out = mtimecmp[h][31:0];
+            end
+            if (addr == 5'(17 + 2 * h)) begin
+                data_out = mtimecmp[h][63:32];
+            end
+        end
+    end
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            mtime    <= '0;
+            mtimecmp <= '{default: '1};
+            msip     <= '0;
+            doorbell <= 1'b0;
+        end else begin
+`ifdef VERILATOR
+            mtime <= mtime + 64'd1 + 64'(time_skip);
+`else
+            mtime <= mtime + 64'd1;
+`endif
+            if (wr_en) begin
+                case (addr)
+                    default: begin
+                    end
+                    5'd0: mtime[31:0]  <= (data_in & wr_mask) | (mtime[31:0] & ~wr_mask);
+                    5'd1: mtime[63:32] <= (data_in & wr_mask) | (mtime[63:32] & ~wr_mask);
+                    5'd2: begin
+                        if (wr_strobe[0] && data_in[0]) begin
+                            doorbell <= 1'b0;
+                        end
+                    end
+                endcase
+                for (int h = 0; h < NUM_HARTS; h++) begin
+                    if (addr == 5'(8 + h) && wr_strobe[0]) begin
+                        msip[h] <= data_in[0];
+                    end
+                    if (addr == 5'(16 + 2 * h)) begin
+                        mtimecmp[h][31:0]  <= (data_in & wr_mask) | (mtimecmp[h][31:0] & ~wr_mask);
+                    end
+                    if (addr == 5'(17 + 2 * h)) begin
+                        mtimecmp[h][63:32] <= (data_in & wr_mask) | (mtimecmp[h][63:32] & ~wr_mask);
+                    end
+                end
+            end
+            // a new ring wins over a clear in the same cycle
+            if (ext_irq_set) begin
+                doorbell <= 1'b1;
+            end
+        end
+    end
+
+endmodule
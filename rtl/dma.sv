@@ -0,0 +1,154 @@
+// Word at a time DMA engine, a master on the shared ram port.
+//
+//  byte offset | register
+//  ------------+-------------------------------------------------------------
+//  0x00        | source byte address
+//  0x04        | destination byte address
+//  0x08        | number of words to move
+//  0x0c        | source stride in bytes, 4 after reset
+//  0x10        | destination stride in bytes, 4 after reset
+//  0x14        | control, bit 0 starts a transfer (ignored while busy), bit 1
+//              | raises irq while a finished transfer is not cleared
+//  0x18        | status, bit 0 busy, bit 1 done, write 1 to bit 1 to clear
+//
+// Every word takes a granted read cycle and a granted write cycle. With a
+// SYNC_READ ram the word arrives on the cycle after the read, granted or not.
+module dma
+    # (
+        parameter ADDR_WIDTH = 16,
+        parameter SYNC_READ  = 0
+    )
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        // register port, addr is the word offset inside the block
+        input  wire                     reg_wr_en,
+        input  wire [5-1:0]             reg_addr,
+        input  wire [32-1:0]            reg_data_in,
+        output reg  [32-1:0]            reg_data_out,
+        // ram master port
+        output wire                     ram_req,
+        input  wire                     ram_gnt,
+        output wire                     ram_wr_en,
+        output wire [4-1:0]             ram_wr_strobe,
+        output wire [ADDR_WIDTH-1:0]    ram_addr,
+        output wire [32-1:0]            ram_data_in,
+        input  wire [32-1:0]            ram_data_out,
+        output wire                     irq
+    );
+
+    localparam CTRL_START   = 0;
+    localparam CTRL_IRQ_EN  = 1;
+    localparam STATUS_BUSY  = 0;
+    localparam STATUS_DONE  = 1;
+
+    reg [31:0]  src;
+    reg [31:0]  dst;
+    reg [31:0]  count;
+    reg [31:0]  src_stride;
+    reg [31:0]  dst_stride;
+    reg         irq_en;
+    reg         busy;
+    reg         done;
+
+    // transfer in flight
+    reg [31:0]  cur_src;
+    reg [31:0]  cur_dst;
+    reg [31:0]  remaining;
+    reg         phase_wr;
+    reg         rd_wait;
+    reg [31:0]  buffer;
+
+    // still asks on the rd_wait cycle so core_sleep stays low, that grant
+    // goes unused
+    assign ram_req       = busy;
+    assign ram_wr_en     = busy && phase_wr;
+    assign ram_wr_strobe = 4'b1111;
+    assign ram_addr      = phase_wr ? cur_dst[ADDR_WIDTH-1+2:2] : cur_src[ADDR_WIDTH-1+2:2];
+    assign ram_data_in   = buffer;
+    assign irq           = irq_en && done;
+
+    always_comb begin
+        case (reg_addr)
+            default: reg_data_out = 32'd0;
+            5'd0:    reg_data_out = src;
+            5'd1:    reg_data_out = dst;
+            5'd2:    reg_data_out = count;
+            5'd3:    reg_data_out = src_stride;
+            5'd4:    reg_data_out = dst_stride;
+            5'd5:    reg_data_out = 32'(irq_en) << CTRL_IRQ_EN;
+            5'd6:    reg_data_out = (32'(done) << STATUS_DONE) | (32'(busy) << STATUS_BUSY);
+        endcase
+    end
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            src        <= '0;
+            dst        <= '0;
+            count      <= '0;
+            src_stride <= 32'd4;
+            dst_stride <= 32'd4;
+            irq_en     <= 1'b0;
+            busy       <= 1'b0;
+            done       <= 1'b0;
+            cur_src    <= '0;
+            cur_dst    <= '0;
+            remaining  <= '0;
+            phase_wr   <= 1'b0;
+            rd_wait    <= 1'b0;
+            buffer     <= '0;
+        end else begin
+            if (rd_wait) begin
+                buffer   <= ram_data_out;
+                phase_wr <= 1'b1;
+                rd_wait  <= 1'b0;
+            end else if (busy && ram_gnt) begin
+                if (!phase_wr) begin
+                    if (SYNC_READ != 0) begin
+                        rd_wait  <= 1'b1;
+                    end else begin
+                        buffer   <= ram_data_out;
+                        phase_wr <= 1'b1;
+                    end
+                end else begin
+                    phase_wr  <= 1'b0;
+                    cur_src   <= cur_src + src_stride;
+                    cur_dst   <= cur_dst + dst_stride;
+                    remaining <= remaining - 1'b1;
+                    if (remaining == 32'd1) begin
+                        busy <= 1'b0;
+                        done <= 1'b1;
+                    end
+                end
+            end
+            if (reg_wr_en) begin
+                case (reg_addr)
+                    default: begin
+                    end
+                    5'd0: src        <= reg_data_in;
+                    5'd1: dst        <= reg_data_in;
+                    5'd2: count      <= reg_data_in;
+                    5'd3: src_stride <= reg_data_in;
+                    5'd4: dst_stride <= reg_data_in;
+                    5'd5: begin
+                        irq_en <= reg_data_in[CTRL_IRQ_EN];
+                        if (reg_data_in[CTRL_START] && !busy) begin
+                            cur_src   <= src;
+                            cur_dst   <= dst;
+                            remaining <= count;
+                            phase_wr  <= 1'b0;
+                            busy      <= count != 32'd0;
+                            done      <= count == 32'd0;
+                        end
+                    end
+                    5'd6: begin
+                        if (reg_data_in[STATUS_DONE]) begin
+                            done <= 1'b0;
+                        end
+                    end
+                endcase
+            end
+        end
+    end
+
+endmodule
@@ -0,0 +1,69 @@
+module mem_arbiter
+    # (
+        parameter NUM_PORTS  = 2,
+        parameter ADDR_WIDTH = 16
+    )
+    (
+        input  wire                             clk,
+        input  wire                             reset_n,
+        // master ports, flattened with port 0 in the low bits
+        input  wire [NUM_PORTS-1:0]             m_req,
+        input  wire [NUM_PORTS-1:0]             m_lock,
+        output wire [NUM_PORTS-1:0]             m_gnt,
+        input  wire [NUM_PORTS-1:0]             m_wr_en,
+        input  wire [NUM_PORTS*4-1:0]           m_wr_strobe,
+        input  wire [NUM_PORTS*ADDR_WIDTH-1:0]  m_addr,
+        input  wire [NUM_PORTS*32-1:0]          m_data_in,
+        output wire [32-1:0]                    m_data_out,
+        // ram port
+        output wire                             ram_wr_en,
+        output wire [4-1:0]                     ram_wr_strobe,
+        output wire [ADDR_WIDTH-1:0]            ram_addr,
+        output wire [32-1:0]                    ram_data_in,
+        input  wire [32-1:0]                    ram_data_out
+    );
+
+    localparam IDX_WIDTH = (NUM_PORTS > 1) ? $clog2(NUM_PORTS) : 1;
+
+    reg  [IDX_WIDTH-1:0]    last;
+    reg                     locked;
+    reg  [IDX_WIDTH-1:0]    sel;
+    reg                     sel_valid;
+
+    // Round robin starting after the last granted port. A port that asserted
+    // m_lock on its granted cycle keeps the grant on the next one.
+    always_comb begin
+        sel       = last;
+        sel_valid = 1'b0;
+        if (locked && m_req[last]) begin
+            sel_valid = 1'b1;
+        end else begin
+            for (int i = NUM_PORTS; i >= 1; i--) begin
+                if (m_req[(int'(last) + i) % NUM_PORTS]) begin
+                    sel       = IDX_WIDTH'((int'(last) + i) % NUM_PORTS);
+                    sel_valid = 1'b1;
+                end
+            end
+        end
+    end
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            last   <= '0;
+            locked <= 1'b0;
+        end else if (sel_valid) begin
+            last   <= sel;
+            locked <= m_lock[sel];
+        end else begin
+            locked <= 1'b0;
+        end
+    end
+
+    assign m_gnt         = sel_valid ? NUM_PORTS'(1) << sel : '0;
+    assign m_data_out    = ram_data_out;
+    assign ram_wr_en     = sel_valid & m_wr_en[sel];
+    assign ram_wr_strobe = m_wr_strobe[sel*4 +: 4];
+    assign ram_addr      = m_addr[sel*ADDR_WIDTH +: ADDR_WIDTH];
+    assign ram_data_in   = m_data_in[sel*32 +: 32];
+
+endmodule
@@ -1,7 +1,12 @@
 module ram
     # (
         parameter ADDR_WIDTH = 16,
-        parameter DATA_WIDTH = 32
+        parameter DATA_WIDTH = 32,
+        // the outputs are registered, the word at the address of the cycle
+        // before as read before that cycle's write, so the array maps to
+        // block ram. b_data_out_hi is not kept, SYNC_READ cores are single
+        // issue.
+        parameter SYNC_READ  = 0
     )
     (
         input  wire                    clk,
@@ -16,32 +21,42 @@ module ram
         input  wire [DATA_WIDTH/8-1:0] b_wr_strobe,
         input  wire [ADDR_WIDTH-1:0]   b_addr,
         input  wire [DATA_WIDTH-1:0]   b_data_in,
-        output wire [DATA_WIDTH-1:0]   b_data_out
+        output wire [DATA_WIDTH-1:0]   b_data_out,
+        // the odd word of the aligned pair at b_addr, so port B reads 64 bit
+        // wide for the instruction fetch
+        output wire [DATA_WIDTH-1:0]   b_data_out_hi
     );
 
-    wire [DATA_WIDTH-1:0] a_wr_mask;
-    wire [DATA_WIDTH-1:0] b_wr_mask;
+    reg [DATA_WIDTH-1:0] mem[1<<ADDR_WIDTH];
 
-    genvar i;
-    generate
-        for (i = 0; i < DATA_WIDTH / 8; i = i + 1) begin
-            assign a_wr_mask[i*8+7:i*8] = a_wr_strobe[i] ? 8'hff : 8'h00;
-            assign b_wr_mask[i*8+7:i*8] = b_wr_strobe[i] ? 8'hff : 8'h00;
-        end
-    endgenerate
+    if (SYNC_READ != 0) begin : gen_sync_read
+        reg [DATA_WIDTH-1:0] a_data_q;
+        reg [DATA_WIDTH-1:0] b_data_q;
 
-    reg [DATA_WIDTH-1:0] mem[1<<ADDR_WIDTH];
+        always_ff @(posedge(clk)) begin
+            a_data_q <= mem[a_addr];
+            b_data_q <= mem[b_addr];
+        end
 
-    assign a_data_out = mem[a_addr];
-    assign b_data_out = mem[b_addr];
+        assign a_data_out    = a_data_q;
+        assign b_data_out    = b_data_q;
+        assign b_data_out_hi = '0;
+    end else begin : gen_async_read
+        assign a_data_out    = mem[a_addr];
+        assign b_data_out    = mem[b_addr];
+        assign b_data_out_hi = mem[{b_addr[ADDR_WIDTH-1:1], 1'b1}];
+    end
 
+    // byte lane writes, the form block ram write enables take
     always_ff @(posedge(clk)) begin
-        if (b_wr_en) begin
-            mem[b_addr] <= (b_data_in & b_wr_mask) | (mem[b_addr] & ~b_wr_mask);
-        end
-        // Port A take priority in case same address is used for both ports
-        if (a_wr_en) begin
-            mem[a_addr] <= (a_data_in & a_wr_mask) | (mem[a_addr] & ~a_wr_mask);
+        for (int lane = 0; lane < DATA_WIDTH / 8; lane++) begin
+            if (b_wr_en && b_wr_strobe[lane]) begin
+                mem[b_addr][lane*8 +: 8] <= b_data_in[lane*8 +: 8];
+            end
+            // Port A take priority in case same address is used for both ports
+            if (a_wr_en && a_wr_strobe[lane]) begin
+                mem[a_addr][lane*8 +: 8] <= a_data_in[lane*8 +: 8];
+            end
         end
     end
 
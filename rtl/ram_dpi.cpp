@@ -0,0 +1,184 @@
+#include "ram_dpi.h"
+
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DIR_LOG2    (32 - RAM_DPI_PAGE_WORDS_LOG2 - RAM_DPI_TABLE_LOG2)
+
+using namespace std;
+
+namespace {
+
+struct page_table {
+    uint32_t *pages[1 << RAM_DPI_TABLE_LOG2];
+};
+
+struct mapping {
+    void *base;
+    size_t len;
+};
+
+// the memory of one ram_dpi instance
+struct ram_space {
+    page_table *directory[1 << DIR_LOG2];
+    // what ram_dpi_clear() has to give back
+    vector<uint32_t *> allocated;
+    vector<mapping> mappings;
+    size_t page_count;
+};
+
+// Spaces by scope. A model is clocked from one thread, so each thread keeps
+// the last one it used and only takes the lock when it switches.
+mutex spaces_lock;
+unordered_map<svScope, ram_space *> spaces;
+thread_local svScope last_scope;
+thread_local ram_space *last_space;
+
+ram_space &space(svScope scope)
+{
+    if (scope != last_scope || !last_space) {
+        lock_guard<mutex> guard(spaces_lock);
+        ram_space *&s = spaces[scope];
+
+        if (!s)
+            s = new ram_space();
+        last_scope = scope;
+        last_space = s;
+    }
+    return *last_space;
+}
+
+uint32_t *&page_slot(ram_space &sp, uint32_t addr)
+{
+    page_table *&table = sp.directory[addr >> (32 - DIR_LOG2)];
+
+    if (!table)
+        table = new page_table();
+    return table->pages[(addr >> RAM_DPI_PAGE_WORDS_LOG2) & ((1 << RAM_DPI_TABLE_LOG2) - 1)];
+}
+
+// the page holding addr, nullptr when it was never written
+uint32_t *find_page(ram_space &sp, uint32_t addr)
+{
+    page_table *table = sp.directory[addr >> (32 - DIR_LOG2)];
+
+    if (!table)
+        return nullptr;
+    return table->pages[(addr >> RAM_DPI_PAGE_WORDS_LOG2) & ((1 << RAM_DPI_TABLE_LOG2) - 1)];
+}
+
+uint32_t *alloc_page(ram_space &sp, uint32_t addr)
+{
+    uint32_t *&slot = page_slot(sp, addr);
+
+    if (!slot) {
+        slot = static_cast<uint32_t *>(calloc(RAM_DPI_PAGE_WORDS, sizeof(uint32_t)));
+        if (!slot)
+            abort();
+        sp.allocated.push_back(slot);
+        sp.page_count++;
+    }
+    return slot;
+}
+
+}
+
+unsigned int ram_dpi_read(unsigned int addr, unsigned int generation)
+{
+    (void)generation;
+    return ram_dpi_peek(svGetScope(), addr);
+}
+
+void ram_dpi_write(unsigned int addr, unsigned int data, unsigned int mask)
+{
+    uint32_t &word = alloc_page(space(svGetScope()), addr)[addr & (RAM_DPI_PAGE_WORDS - 1)];
+
+    word = (data & mask) | (word & ~mask);
+}
+
+int ram_dpi_map(const char *path, unsigned int byte_addr)
+{
+    ram_space &sp = space(svGetScope());
+    struct stat st;
+    int fd;
+    void *base;
+    size_t len;
+
+    if (byte_addr % RAM_DPI_PAGE_BYTES)
+        return -1;
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 ||
+        (uint64_t)byte_addr + st.st_size > (1ull << 32)) {
+        close(fd);
+        return -1;
+    }
+    // the tail of the last page past the end of the file reads as zero
+    len = (st.st_size + RAM_DPI_PAGE_BYTES - 1) & ~(size_t)(RAM_DPI_PAGE_BYTES - 1);
+    base = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return -1;
+    sp.mappings.push_back({base, len});
+
+    for (size_t off = 0; off < len; off += RAM_DPI_PAGE_BYTES) {
+        uint32_t *&slot = page_slot(sp, (byte_addr + off) >> 2);
+
+        if (!slot)
+            sp.page_count++;
+        slot = reinterpret_cast<uint32_t *>(static_cast<char *>(base) + off);
+    }
+    return 0;
+}
+
+uint32_t ram_dpi_peek(svScope ram, uint32_t addr)
+{
+    uint32_t *page = find_page(space(ram), addr);
+
+    return page ? page[addr & (RAM_DPI_PAGE_WORDS - 1)] : 0;
+}
+
+void ram_dpi_poke(svScope ram, uint32_t addr, uint32_t data)
+{
+    alloc_page(space(ram), addr)[addr & (RAM_DPI_PAGE_WORDS - 1)] = data;
+}
+
+size_t ram_dpi_pages(svScope ram)
+{
+    return space(ram).page_count;
+}
+
+void ram_dpi_clear(svScope ram)
+{
+    ram_space &sp = space(ram);
+
+    for (page_table *&table : sp.directory) {
+        delete table;
+        table = nullptr;
+    }
+    for (uint32_t *page : sp.allocated)
+        free(page);
+    for (mapping &m : sp.mappings)
+        munmap(m.base, m.len);
+    sp.allocated.clear();
+    sp.mappings.clear();
+    sp.page_count = 0;
+}
+
+void ram_dpi_release(svScope ram)
+{
+    ram_dpi_clear(ram);
+
+    lock_guard<mutex> guard(spaces_lock);
+    delete spaces[ram];
+    spaces.erase(ram);
+    last_space = nullptr;
+}
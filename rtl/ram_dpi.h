@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "svdpi.h"
+
+// Host side of rtl/ram_dpi.sv. Word addresses are 32 bits wide, split into a
+// directory, a table and a 4 KiB page. Untouched pages read as zero and
+// cost nothing until the first write allocates them. Every ram_dpi instance
+// has a page table of its own, found by its DPI scope.
+#define RAM_DPI_PAGE_WORDS_LOG2 10
+#define RAM_DPI_TABLE_LOG2      10
+#define RAM_DPI_PAGE_WORDS      (1u << RAM_DPI_PAGE_WORDS_LOG2)
+#define RAM_DPI_PAGE_BYTES      (RAM_DPI_PAGE_WORDS * 4)
+
+extern "C" {
+// DPI imports, declared again by the Verilated model. They work on the page
+// table of the calling instance.
+unsigned int ram_dpi_read(unsigned int addr, unsigned int generation);
+void ram_dpi_write(unsigned int addr, unsigned int data, unsigned int mask);
+// Map a raw little endian image copy on write from a page aligned byte
+// address, replacing whatever those pages held. 0 on success.
+int ram_dpi_map(const char *path, unsigned int byte_addr);
+}
+
+// Testbench backdoor by word address into the ram_dpi instance at scope,
+// see svGetScopeFromName(). The ram outputs only pick up a poke once the
+// address on the port changes or the next write lands.
+uint32_t ram_dpi_peek(svScope ram, uint32_t addr);
+void ram_dpi_poke(svScope ram, uint32_t addr, uint32_t data);
+// pages backed by host memory, allocated or mapped
+size_t ram_dpi_pages(svScope ram);
+// drop every page and mapping, the whole space reads as zero again
+void ram_dpi_clear(svScope ram);
+// drop the page table itself, before the model goes away
+void ram_dpi_release(svScope ram);
@@ -0,0 +1,102 @@
+// Drop in for ram with the words kept in a sparse page table on the host,
+// see ram_dpi.cpp. Pages are allocated on the first write, so the address
+// width can grow to the full 32 bits without the model or its reset growing
+// with it. `+ram_image=<file>` maps a raw binary image at
+// `+ram_image_base=<hex byte address>`, 0x10000 by default. The imports are
+// context calls, so every instance reads and writes a page table of its own.
+module ram_dpi
+    # (
+        parameter ADDR_WIDTH = 16,
+        parameter DATA_WIDTH = 32,
+        // see ram
+        parameter SYNC_READ  = 0
+    )
+    (
+        input  wire                    clk,
+        // port A
+        input  wire                    a_wr_en,
+        input  wire [DATA_WIDTH/8-1:0] a_wr_strobe,
+        input  wire [ADDR_WIDTH-1:0]   a_addr,
+        input  wire [DATA_WIDTH-1:0]   a_data_in,
+        output reg  [DATA_WIDTH-1:0]   a_data_out,
+        // port B
+        input  wire                    b_wr_en,
+        input  wire [DATA_WIDTH/8-1:0] b_wr_strobe,
+        input  wire [ADDR_WIDTH-1:0]   b_addr,
+        input  wire [DATA_WIDTH-1:0]   b_data_in,
+        output reg  [DATA_WIDTH-1:0]   b_data_out,
+        // the odd word of the aligned pair at b_addr, so port B reads 64 bit
+        // wide for the instruction fetch
+        output reg  [DATA_WIDTH-1:0]   b_data_out_hi
+    );
+
+    import "DPI-C" context function int unsigned ram_dpi_read(input int unsigned addr, input int unsigned generation);
+    import "DPI-C" context function void ram_dpi_write(input int unsigned addr, input int unsigned data, input int unsigned mask);
+    import "DPI-C" context function int ram_dpi_map(input string path, input int unsigned byte_addr);
+
+    // the words live behind the DPI calls, so the reads also take the count
+    // of clocks with a write to see a new value at an unchanged address
+    reg  [31:0]           generation;
+    // only read with SYNC_READ
+    // verilator lint_off UNUSEDSIGNAL
+    reg  [DATA_WIDTH-1:0] a_data_q;
+    reg  [DATA_WIDTH-1:0] b_data_q;
+    // verilator lint_on UNUSEDSIGNAL
+    wire [DATA_WIDTH-1:0] a_wr_mask;
+    wire [DATA_WIDTH-1:0] b_wr_mask;
+
+    genvar i;
+    generate
+        for (i = 0; i < DATA_WIDTH / 8; i = i + 1) begin
+            assign a_wr_mask[i*8+7:i*8] = a_wr_strobe[i] ? 8'hff : 8'h00;
+            assign b_wr_mask[i*8+7:i*8] = b_wr_strobe[i] ? 8'hff : 8'h00;
+        end
+    endgenerate
+
+    string       image;
+    int unsigned image_base;
+
+    initial begin
+        generation = 0;
+        if ($value$plusargs("ram_image=%s", image)) begin
+            if (!$value$plusargs("ram_image_base=%h", image_base))
+                image_base = 32'h10000;
+            if (ram_dpi_map(image, image_base) != 0)
+                $fatal(1, "ram_dpi: cannot map %s", image);
+        end
+    end
+
+    always_ff @(posedge(clk)) begin
+        // the writes below go to the host right away, so the registered
+        // reads of SYNC_READ come first in the same block
+        if (SYNC_READ != 0) begin
+            a_data_q <= ram_dpi_read(32'(a_addr), generation);
+            b_data_q <= ram_dpi_read(32'(b_addr), generation);
+        end
+        if (b_wr_en) begin
+            ram_dpi_write(32'(b_addr), b_data_in, b_wr_mask);
+        end
+        // Port A take priority in case same address is used for both ports
+        if (a_wr_en) begin
+            ram_dpi_write(32'(a_addr), a_data_in, a_wr_mask);
+        end
+        if (a_wr_en || b_wr_en) begin
+            generation <= generation + 1;
+        end
+    end
+
+    if (SYNC_READ == 0) begin : gen_async_read
+        always_comb begin
+            a_data_out = ram_dpi_read(32'(a_addr), generation);
+            b_data_out = ram_dpi_read(32'(b_addr), generation);
+            b_data_out_hi = ram_dpi_read(32'({b_addr[ADDR_WIDTH-1:1], 1'b1}), generation);
+        end
+    end else begin : gen_sync_read
+        always_comb begin
+            a_data_out    = a_data_q;
+            b_data_out    = b_data_q;
+            b_data_out_hi = '0;
+        end
+    end
+
+endmodule
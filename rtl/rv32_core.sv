@@ -1,17 +1,84 @@
 module rv32_core
     # (
         parameter ADDR_WIDTH = 16,
-        parameter START_ADDR = 32'h10000
+        parameter START_ADDR = 32'h10000,
+        // byte address of the 256 byte peripheral window of top.sv, below
+        // the top of the ram space once ADDR_WIDTH is over 16
+        parameter PERIPH_BASE = 32'h3ff00,
+        // byte address of the 4 KiB page the testbench polls, written
+        // through like the peripherals
+        parameter MAILBOX_BASE = 32'h1f000,
+        parameter HART_ID    = 0,
+        // store buffer entries, and the cycles the oldest one may wait
+        // before it is written back regardless
+        parameter SB_DEPTH   = 4,
+        parameter SB_AGE     = 16,
+        // issue pairs of instructions from 8 byte aligned fetches
+        parameter DUAL_ISSUE = 0,
+        // execute the common two instruction idioms as one operation
+        parameter FUSION     = 0,
+        // an accelerator is attached to the cfu port, custom-0 instructions
+        // fault without one
+        parameter CFU        = 0,
+        // ram_data_out is the word at the ram_addr of the cycle before and
+        // the register file reads on a clock edge, so both map to block ram.
+        // Every instruction then takes an address, a decode and an execute
+        // cycle, see sync_ready. DUAL_ISSUE and FUSION are left off with it.
+        parameter SYNC_READ  = 0
     )
     (
         input  wire                     clk,
         input  wire                     reset_n,
         // ram interface
-        output reg                      ram_wr_en,
-        output reg   [4-1:0]            ram_wr_strobe,
+        output wire                     ram_wr_en,
+        output wire  [4-1:0]            ram_wr_strobe,
         output wire  [ADDR_WIDTH-1:0]   ram_addr,
-        output reg   [32-1:0]           ram_data_in,
+        output wire  [32-1:0]           ram_data_in,
         input  wire  [32-1:0]           ram_data_out,
+        // the odd word of the aligned pair at ram_addr, the upper half of a
+        // 64 bit fetch
+        input  wire  [32-1:0]           ram_fetch_hi,
+        // ram arbitration, the core only advances on cycles it is granted
+        output wire                     ram_req,
+        output wire                     ram_lock,
+        input  wire                     ram_gnt,
+        // ram_addr is an instruction fetch, not a load, AMO or write back,
+        // see rtl/bus_master.sv
+        output wire                     ram_fetch,
+        // writes seen on the shared ram port, used to break reservations
+        input  wire                     snoop_wr_en,
+        input  wire  [ADDR_WIDTH-1:0]   snoop_addr,
+        // machine mode interrupt lines
+        input  wire                     timer_irq,
+        input  wire                     soft_irq,
+        input  wire                     ext_irq,
+        // extra cycles the counters account for this clock, used by the
+        // testbench to skip idle time while the core is parked in wfi. Only
+        // a Verilated model adds it, synthesis leaves it unconnected.
+        input  wire  [32-1:0]           time_skip,
+        output wire                     sleep,
+        // ecall stalls the core until the host services it, a7 holds the
+        // call number and a0 - a2 the arguments, a0 takes ecall_ret on ack
+        output wire                     ecall_req,
+        input  wire                     ecall_ack,
+        input  wire  [32-1:0]           ecall_ret,
+        // custom-0 accelerator, see rtl/cfu_mac.sv for the handshake. The
+        // core holds an R-type custom-0 instruction until cfu_done and
+        // writes cfu_result to rd.
+        output wire                     cfu_start,
+        output wire  [10-1:0]           cfu_func,
+        output wire  [32-1:0]           cfu_rs1,
+        output wire  [32-1:0]           cfu_rs2,
+        input  wire                     cfu_done,
+        input  wire  [32-1:0]           cfu_result,
+        // instruction trace, after the E-Trace ingress port. trace_iretire
+        // instructions retire this cycle from trace_iaddr on, trace_itype
+        // holds the type of each, the first in [2:0]. An interrupt is a cycle
+        // that retires nothing, with type 2 and the interrupted instruction
+        // at trace_iaddr. See rtl/trace_encoder.sv.
+        output wire  [1:0]              trace_iretire,
+        output wire  [2*3-1:0]          trace_itype,
+        output wire  [32-1:0]           trace_iaddr,
         output reg   [3:0]              core_fault
     );
 
@@ -26,7 +93,9 @@ module rv32_core
         op_arith_i       = 7'b0010011,
         op_store         = 7'b0100011,
         op_fence         = 7'b0001111,
-        op_esys_csr      = 7'b1110011
+        op_esys_csr      = 7'b1110011,
+        op_amo           = 7'b0101111,
+        op_custom0       = 7'b0001011
     } opcode_val;
 
     opcode_val opcode;
@@ -38,10 +107,10 @@ module rv32_core
     wire [31:0] imm_i;
     wire [31:0] imm_s;
     wire [31:0] imm_b;
-    wire [31:0] imm_u;
     wire [31:0] imm_j;
 
     wire [31:0] store_addr_comb;
+    wire [31:0] load_addr_comb;
 
 
     wire [31:0] instruction;
@@ -49,6 +118,7 @@ module rv32_core
     assign opcode = opcode_val'(instruction[6 : 0]);
 
     assign store_addr_comb = rs1_data + imm_s;
+    assign load_addr_comb  = rs1_data + imm_i;
 
     assign     rd = instruction[11: 7];
     assign  func3 = instruction[14:12];
@@ -58,7 +128,6 @@ module rv32_core
     assign  imm_i = {{21{instruction[31]}}, instruction[30:20]};
     assign  imm_s = {{21{instruction[31]}}, instruction[30:25], instruction[11:7]};
     assign  imm_b = {{20{instruction[31]}}, instruction[7], instruction[30:25], instruction[11:8], 1'b0};
-    assign  imm_u = {instruction[31:12], {12{1'b0}}};
     assign  imm_j = {{12{instruction[31]}}, instruction[19:12], instruction[20], instruction[30:21], 1'b0};
 
     reg [31:0]  pc;
@@ -67,8 +136,68 @@ module rv32_core
     // verilator lint_off UNUSEDSIGNAL
     reg [31:0]  load_store_addr;
     // verilator lint_on UNUSEDSIGNAL
-    assign ram_addr    = core_hault ? load_store_addr[ADDR_WIDTH-1+2:2] : pc[ADDR_WIDTH-1+2:2];
-    assign instruction = core_hault ? prev_inst : ram_data_out;
+    reg         wfi_sleep;
+    reg         ecall_wait;
+    wire        irq_take;
+    // the data write of a peripheral store, SC or AMO on its core_hault cycle
+    reg         data_wr_en;
+    reg [4-1:0] data_wr_strobe;
+    reg [31:0]  data_wr_data;
+    // With SYNC_READ the ram answers a cycle after the address and the
+    // register file a cycle after the instruction, so phase counts the
+    // address, decode and execute cycles of an instruction and of each
+    // core_hault cycle. The core keeps the port locked and its address
+    // steady until the execute cycle, sync_ready, where the decode and
+    // execute below work as without it. A held instruction stays in its
+    // execute cycle.
+    reg [1:0]   phase;
+    wire        sync_ready;
+
+    assign sync_ready = SYNC_READ == 0 || phase == 2'd2;
+
+    // Stores to ram retire into the store buffer without a stall, entry 0 is
+    // the oldest and stores to the word of the youngest entry merge into it.
+    // The port is shared with the fetch, so an entry is written back on a
+    // cycle the core holds an instruction in prev_inst (sb_hold) that has to
+    // wait for the buffer: a fence, AMO, ecall or wfi, a load it can not
+    // forward, a peripheral or mailbox access, a store to a full buffer, or
+    // any instruction once the oldest entry waited SB_AGE cycles. The held
+    // instruction executes on the cycle the last entry it waits for drains.
+    localparam SB_BITS = $clog2(SB_DEPTH + 1);
+    localparam SB_IDX  = $clog2(SB_DEPTH);
+    localparam SB_AGES = $clog2(SB_AGE + 1);
+
+    reg  [ADDR_WIDTH-1:0]       sb_addr[SB_DEPTH];
+    reg  [31:0]                 sb_data[SB_DEPTH];
+    reg  [4-1:0]                sb_strobe[SB_DEPTH];
+    reg  [SB_BITS-1:0]          sb_count;
+    reg  [SB_AGES-1:0]          sb_age;
+    reg                         sb_hold;
+    wire                        sb_drain;
+    wire [SB_BITS-1:0]          sb_live;
+    wire                        sb_stale;
+    reg                         sb_wait;
+
+    assign sb_drain = sb_hold && sb_count != '0;
+    // entries left once this cycle's write back is done
+    assign sb_live  = sb_count - SB_BITS'(sb_drain);
+    assign sb_stale = !sb_drain && sb_count != '0 && sb_age == SB_AGES'(SB_AGE);
+
+    assign ram_addr      = sb_drain   ? sb_addr[0] :
+                           core_hault ? load_store_addr[ADDR_WIDTH-1+2:2] : pc[ADDR_WIDTH-1+2:2];
+    assign ram_fetch     = !sb_drain && !core_hault;
+    assign ram_wr_en     = sb_drain || (data_wr_en && sync_ready);
+    assign ram_wr_strobe = sb_drain ? sb_strobe[0] : data_wr_strobe;
+    assign ram_data_in   = sb_drain ? sb_data[0] : data_wr_data;
+    // an instruction replaced by a trap executes as a nop
+    assign instruction   = core_hault ? prev_inst :
+                           irq_take   ? 32'h00000013 :
+                           sb_hold    ? prev_inst : ram_data_out;
+
+    // every awake cycle is either a fetch or a data access
+    assign ram_req     = !wfi_sleep && !ecall_wait;
+    assign sleep       = wfi_sleep;
+    assign ecall_req   = ecall_wait;
 
 
     typedef enum logic [3:0] {
@@ -82,13 +211,304 @@ module rv32_core
     wire [32-1:0]   rs1_data;
     wire [32-1:0]   rs2_data;
 
-    assign rs1_data = (rs1 == 0) ? 32'd0 : regs[rs1];
-    assign rs2_data = (rs2 == 0) ? 32'd0 : regs[rs2];
+    // with SYNC_READ the register file is read on the decode cycle
+    reg  [32-1:0]   rs1_q;
+    reg  [32-1:0]   rs2_q;
+
+    always_ff @(posedge(clk)) begin
+        rs1_q <= regs[rs1];
+        rs2_q <= regs[rs2];
+    end
+
+    assign rs1_data = (rs1 == 0) ? 32'd0 : SYNC_READ != 0 ? rs1_q : regs[rs1];
+    assign rs2_data = (rs2 == 0) ? 32'd0 : SYNC_READ != 0 ? rs2_q : regs[rs2];
 
     reg [63:0] rdcycle;
     reg [63:0] rdtime;
     reg [63:0] rdinstret;
 
+    // fused pairs per idiom, read as hpmcounter3-6
+    localparam FUSE_LUI_ADDI    = 0;
+    localparam FUSE_AUIPC_JALR  = 1;
+    localparam FUSE_SHIFT       = 2;
+    localparam FUSE_ADDI_BRANCH = 3;
+
+    reg [31:0] fuse_count [4];
+
+    // A custom-0 instruction starts the accelerator once and waits in
+    // prev_inst like a store buffer hold until it is done. A result that
+    // comes while the instruction can not retire yet is kept for it, and
+    // interrupts wait for the operation so the result always finds its
+    // instruction.
+    reg         cfu_busy;
+    reg         cfu_have;
+    reg  [31:0] cfu_data;
+    wire        cfu_run;
+    wire        cfu_wait;
+    wire        cfu_retire;
+
+    assign cfu_run    = CFU != 0 && opcode == op_custom0 && ram_gnt && !wfi_sleep && !ecall_wait &&
+                        sync_ready && !core_hault && !irq_take;
+    assign cfu_start  = cfu_run && !cfu_busy && !cfu_have;
+    assign cfu_wait   = cfu_run && !cfu_have && !((cfu_start || cfu_busy) && cfu_done);
+    assign cfu_retire = cfu_run && !cfu_wait && !sb_wait;
+    assign cfu_func   = {func7, func3};
+    assign cfu_rs1    = rs1_data;
+    assign cfu_rs2    = rs2_data;
+
+    // machine mode trap state, only direct mode mtvec is supported
+    localparam MIP_MSIP = 3;
+    localparam MIP_MTIP = 7;
+    localparam MIP_MEIP = 11;
+
+    reg         mstatus_mie;
+    reg         mstatus_mpie;
+    reg  [31:0] mie;
+    reg  [31:0] mtvec;
+    reg  [31:0] mscratch;
+    reg  [31:0] mepc;
+    reg  [31:0] mcause;
+    wire [31:0] mip;
+    wire        irq_wake;
+    reg  [4:0]  irq_cause;
+
+    assign mip      = (32'(ext_irq) << MIP_MEIP) | (32'(timer_irq) << MIP_MTIP) | (32'(soft_irq) << MIP_MSIP);
+    assign irq_wake = |(mip & mie);
+    assign irq_take = sync_ready && !core_hault && !cfu_busy && !cfu_have && mstatus_mie && irq_wake;
+
+    always_comb begin
+        if (mip[MIP_MEIP] && mie[MIP_MEIP]) begin
+            irq_cause = 5'(MIP_MEIP);
+        end else if (mip[MIP_MSIP] && mie[MIP_MSIP]) begin
+            irq_cause = 5'(MIP_MSIP);
+        end else begin
+            irq_cause = 5'(MIP_MTIP);
+        end
+    end
+
+    reg  [31:0] csr_rdata;
+    reg         csr_valid;
+    reg         csr_writable;
+    reg  [31:0] csr_wdata;
+    wire [31:0] csr_src;
+    wire        csr_wr;
+
+    // csrrs/csrrc with rs1 = x0 only read
+    assign csr_src = func3[2] ? {27'd0, rs1} : rs1_data;
+    assign csr_wr  = func3[1:0] == 2'b01 || rs1 != 5'b00000;
+
+    always_comb begin
+        csr_valid    = 1'b1;
+        csr_writable = 1'b0;
+        case (imm_i[11:0])
+            default: begin
+                csr_valid = 1'b0;
+                csr_rdata = 32'd0;
+            end
+            12'hc00: csr_rdata = rdcycle[31:0];
+            12'hc01: csr_rdata = rdtime[31:0];
+            12'hc02: csr_rdata = rdinstret[31:0];
+            12'hc80: csr_rdata = rdcycle[63:32];
+            12'hc81: csr_rdata = rdtime[63:32];
+            12'hc82: csr_rdata = rdinstret[63:32];
+            12'hc03: csr_rdata = fuse_count[FUSE_LUI_ADDI];
+            12'hc04: csr_rdata = fuse_count[FUSE_AUIPC_JALR];
+            12'hc05: csr_rdata = fuse_count[FUSE_SHIFT];
+            12'hc06: csr_rdata = fuse_count[FUSE_ADDI_BRANCH];
+            12'hf14: csr_rdata = 32'(HART_ID); // mhartid
+            12'h300: begin // mstatus, MPP is hardwired to machine mode
+                csr_rdata    = {19'd0, 2'b11, 3'd0, mstatus_mpie, 3'd0, mstatus_mie, 3'd0};
+                csr_writable = 1'b1;
+            end
+            12'h304: begin
+                csr_rdata    = mie;
+                csr_writable = 1'b1;
+            end
+            12'h305: begin
+                csr_rdata    = mtvec;
+                csr_writable = 1'b1;
+            end
+            12'h340: begin
+                csr_rdata    = mscratch;
+                csr_writable = 1'b1;
+            end
+            12'h341: begin
+                csr_rdata    = mepc;
+                csr_writable = 1'b1;
+            end
+            12'h342: begin
+                csr_rdata    = mcause;
+                csr_writable = 1'b1;
+            end
+            12'h344: begin // mip pending bits follow the irq lines, writes are ignored
+                csr_rdata    = mip;
+                csr_writable = 1'b1;
+            end
+        endcase
+        case (func3[1:0])
+            default: csr_wdata = csr_src;
+            2'b10:   csr_wdata = csr_rdata | csr_src;
+            2'b11:   csr_wdata = csr_rdata & ~csr_src;
+        endcase
+    end
+
+    typedef enum logic [4:0] {
+        amo_add     = 5'b00000,
+        amo_swap    = 5'b00001,
+        amo_lr      = 5'b00010,
+        amo_sc      = 5'b00011,
+        amo_xor     = 5'b00100,
+        amo_or      = 5'b01000,
+        amo_and     = 5'b01100,
+        amo_min     = 5'b10000,
+        amo_max     = 5'b10100,
+        amo_minu    = 5'b11000,
+        amo_maxu    = 5'b11100
+    } amo_val;
+
+    amo_val                 amo_func5;
+    reg                     amo_wr;
+    reg                     resv_valid;
+    reg  [ADDR_WIDTH-1:0]   resv_addr;
+    reg  [31:0]             amo_result;
+    wire                    amo_is_rmw;
+    wire                    sc_pass;
+    wire                    resv_snoop_hit;
+
+    assign amo_func5      = amo_val'(instruction[31:27]);
+    assign amo_is_rmw     = amo_func5 != amo_lr && amo_func5 != amo_sc;
+    assign sc_pass        = resv_valid && resv_addr == rs1_data[ADDR_WIDTH-1+2:2];
+    assign resv_snoop_hit = snoop_wr_en && snoop_addr == resv_addr;
+
+    // Hold the ram grant between the read and write of an AMO and between the
+    // reservation check and write of a passing SC so no other hart can sneak
+    // a write in between.
+    assign ram_lock = !sync_ready || ((opcode == op_amo) &&
+                      (core_hault ? (amo_is_rmw && !amo_wr) : (amo_func5 == amo_sc && sc_pass && !sb_wait)));
+
+    // byte lanes and data of a store, and the lanes a load reads
+    reg  [4-1:0]        store_strobe;
+    reg  [31:0]         store_data;
+    wire [31:0]         store_mask;
+    wire                store_valid;
+    wire                store_direct;
+    wire                store_merge;
+    reg  [4-1:0]        load_strobe;
+    wire                load_valid;
+    wire                load_direct;
+    reg                 sb_hit;
+    reg  [SB_IDX-1:0]   sb_hit_idx;
+    wire                sb_fwd;
+    wire [31:0]         load_word;
+    wire [1:0]          load_offset;
+    reg  [31:0]         load_result;
+
+    always_comb begin
+        case (func3[1:0])
+            2'b00: begin
+                store_strobe = 4'b0001 << store_addr_comb[1:0];
+                store_data   = {4{rs2_data[7:0]}};
+                load_strobe  = 4'b0001 << load_addr_comb[1:0];
+            end
+            2'b01: begin
+                store_strobe = store_addr_comb[1] ? 4'b1100 : 4'b0011;
+                store_data   = {2{rs2_data[15:0]}};
+                load_strobe  = load_addr_comb[1] ? 4'b1100 : 4'b0011;
+            end
+            default: begin
+                store_strobe = 4'b1111;
+                store_data   = rs2_data;
+                load_strobe  = 4'b1111;
+            end
+        endcase
+    end
+
+    assign store_mask   = {{8{store_strobe[3]}}, {8{store_strobe[2]}}, {8{store_strobe[1]}}, {8{store_strobe[0]}}};
+    assign store_valid  = func3 == 3'b000 || func3 == 3'b001 || func3 == 3'b010;
+    assign load_valid   = store_valid || func3 == 3'b100 || func3 == 3'b101;
+    // the peripherals of top.sv and the mailbox page are accessed in
+    // program order with the buffer empty
+    assign store_direct = store_addr_comb[ADDR_WIDTH-1+2:8] == PERIPH_BASE[ADDR_WIDTH-1+2:8] ||
+                          store_addr_comb[ADDR_WIDTH-1+2:12] == MAILBOX_BASE[ADDR_WIDTH-1+2:12];
+    assign load_direct  = load_addr_comb[ADDR_WIDTH-1+2:8] == PERIPH_BASE[ADDR_WIDTH-1+2:8] ||
+                          load_addr_comb[ADDR_WIDTH-1+2:12] == MAILBOX_BASE[ADDR_WIDTH-1+2:12];
+    assign store_merge  = sb_live != '0 && sb_addr[SB_IDX'(sb_count - 1'b1)] == store_addr_comb[ADDR_WIDTH-1+2:2];
+
+    // the youngest entry left after this cycle holding the word of a load
+    always_comb begin
+        sb_hit     = 1'b0;
+        sb_hit_idx = '0;
+        for (int i = 0; i < SB_DEPTH; i++) begin
+            if (i >= int'(sb_drain) && i < int'(sb_count) &&
+                    sb_addr[i] == load_addr_comb[ADDR_WIDTH-1+2:2]) begin
+                sb_hit     = 1'b1;
+                sb_hit_idx = SB_IDX'(i);
+            end
+        end
+    end
+
+    assign sb_fwd = sb_hit && (sb_strobe[sb_hit_idx] & load_strobe) == load_strobe;
+
+    always_comb begin
+        sb_wait = 1'b0;
+        if (!core_hault && !irq_take) begin
+            case (opcode)
+                default:     sb_wait = sb_stale;
+                op_load:     sb_wait = sb_stale || (load_direct ? sb_live != '0 : sb_hit && !sb_fwd);
+                op_store:    sb_wait = sb_stale || (store_direct ? sb_live != '0 :
+                                                    sb_live == SB_BITS'(SB_DEPTH) && !store_merge);
+                op_fence,
+                op_amo:      sb_wait = sb_live != '0;
+                // ecall and wfi hand over to the host or other harts
+                op_esys_csr: sb_wait = sb_stale || (func3 == 3'b000 && sb_live != '0);
+            endcase
+        end
+    end
+
+    // a load takes its data from the port on its core_hault cycle, or from
+    // the buffer right away
+    assign load_word   = core_hault ? ram_data_out : sb_data[sb_hit_idx];
+    assign load_offset = core_hault ? load_store_addr[1:0] : load_addr_comb[1:0];
+
+    always_comb begin
+        case (func3)
+            default: load_result = load_word;
+            3'b001:  load_result = load_offset[1] ? {{16{load_word[31]}}, load_word[31:16]} :
+                                                    {{16{load_word[15]}}, load_word[15:0]};
+            3'b101:  load_result = load_offset[1] ? {16'd0, load_word[31:16]} : {16'd0, load_word[15:0]};
+            3'b000: begin
+                case (load_offset)
+                    2'b00: load_result = {{24{load_word[7]}}, load_word[7:0]};
+                    2'b01: load_result = {{24{load_word[15]}}, load_word[15:8]};
+                    2'b10: load_result = {{24{load_word[23]}}, load_word[23:16]};
+                    2'b11: load_result = {{24{load_word[31]}}, load_word[31:24]};
+                endcase
+            end
+            3'b100: begin
+                case (load_offset)
+                    2'b00: load_result = {24'd0, load_word[7:0]};
+                    2'b01: load_result = {24'd0, load_word[15:8]};
+                    2'b10: load_result = {24'd0, load_word[23:16]};
+                    2'b11: load_result = {24'd0, load_word[31:24]};
+                endcase
+            end
+        endcase
+    end
+
+    always_comb begin
+        case (amo_func5)
+            default:  amo_result = rs2_data;
+            amo_add:  amo_result = ram_data_out + rs2_data;
+            amo_xor:  amo_result = ram_data_out ^ rs2_data;
+            amo_or:   amo_result = ram_data_out | rs2_data;
+            amo_and:  amo_result = ram_data_out & rs2_data;
+            amo_min:  amo_result = ($signed(ram_data_out) < $signed(rs2_data)) ? ram_data_out : rs2_data;
+            amo_max:  amo_result = ($signed(ram_data_out) > $signed(rs2_data)) ? ram_data_out : rs2_data;
+            amo_minu: amo_result = (ram_data_out < rs2_data) ? ram_data_out : rs2_data;
+            amo_maxu: amo_result = (ram_data_out > rs2_data) ? ram_data_out : rs2_data;
+        endcase
+    end
+
     typedef enum logic [2:0] {
         arith_add   = 3'b000,
         arith_sll   = 3'b001,
@@ -100,28 +520,291 @@ module rv32_core
         arith_and   = 3'b111
     } arith_val;
 
+    // Result of lui, auipc, op and op-imm, bit 32 is clear for an encoding
+    // that does not decode. Both issue slots use it.
+    function automatic logic [32:0] alu_exec(input logic [31:0] inst, input logic [31:0] a,
+                                             input logic [31:0] b, input logic [31:0] inst_pc);
+        logic [31:0] src;
+        logic        alt;
+        logic        ok;
+        logic [31:0] r;
+
+        // op-imm only checks func7 on the shifts
+        src = inst[5] ? b : {{21{inst[31]}}, inst[30:20]};
+        alt = inst[31:25] == 7'b0100000;
+        ok  = inst[31:25] == 7'b0000000 ||
+              (!inst[5] && inst[14:12] != arith_sll && inst[14:12] != arith_sr) ||
+              (alt && (inst[14:12] == arith_sr || (inst[5] && inst[14:12] == arith_add)));
+        case (arith_val'(inst[14:12]))
+            arith_add:  r = (inst[5] && alt) ? a - src : a + src;
+            arith_sll:  r = a << src[4:0];
+            arith_slt:  r = {31'd0, $signed(a) < $signed(src)};
+            arith_sltu: r = {31'd0, a < src};
+            arith_xor:  r = a ^ src;
+            arith_sr:   r = alt ? $signed(a) >>> src[4:0] : a >> src[4:0];
+            arith_or:   r = a | src;
+            arith_and:  r = a & src;
+        endcase
+        case (opcode_val'(inst[6:0]))
+            op_lui:     alu_exec = {1'b1, inst[31:12], 12'd0};
+            op_auipc:   alu_exec = {1'b1, inst_pc + {inst[31:12], 12'd0}};
+            op_arith,
+            op_arith_i: alu_exec = {ok, r};
+            default:    alu_exec = '0;
+        endcase
+    endfunction
+
+    // bit 1 is set for a valid condition, bit 0 if the branch is taken
+    function automatic logic [1:0] branch_exec(input logic [2:0] f3, input logic [31:0] a,
+                                               input logic [31:0] b);
+        case (f3)
+            3'b000:  branch_exec = {1'b1, a == b};
+            3'b001:  branch_exec = {1'b1, a != b};
+            3'b100:  branch_exec = {1'b1, $signed(a) < $signed(b)};
+            3'b101:  branch_exec = {1'b1, $signed(a) >= $signed(b)};
+            3'b110:  branch_exec = {1'b1, a < b};
+            3'b111:  branch_exec = {1'b1, a >= b};
+            default: branch_exec = 2'b00;
+        endcase
+    endfunction
+
+    wire [32:0] alu0;
+    wire [1:0]  br0;
+
+    assign alu0 = alu_exec(instruction, rs1_data, rs2_data, pc);
+    assign br0  = branch_exec(func3, rs1_data, rs2_data);
+
+    // Dual issue. A fetch from an 8 byte aligned pc brings the next word
+    // along in ram_fetch_hi and slot 1 issues it in the same cycle. Slot 1
+    // takes the ALU instructions, branches and jumps, slot 0 anything but a
+    // jump, a taken branch or an instruction that waits or traps, so at most
+    // one memory access issues per pair. A slot 0 ALU result is forwarded to
+    // the slot 1 operands, a slot 0 load writes after the pair, so slot 1 may
+    // not read or write its register. Slot 1 is written last and wins when
+    // both write the same register.
+    wire [31:0] inst1;
+    wire [4:0]  rd1;
+    wire [4:0]  rs1_1;
+    wire [4:0]  rs2_1;
+    wire [31:0] imm_i1;
+    wire [31:0] imm_b1;
+    wire [31:0] imm_j1;
+    wire [31:0] rs1_data1;
+    wire [31:0] rs2_data1;
+    wire [32:0] alu1;
+    wire [1:0]  br1;
+    wire        slot0_alu;
+    reg         slot0_ok;
+    reg         slot1_ok;
+    reg         slot1_rd;
+    reg         slot1_rs1;
+    reg         slot1_rs2;
+    wire        load_hazard;
+    wire        dual;
+
+    assign inst1  = ram_fetch_hi;
+    assign rd1    = inst1[11: 7];
+    assign rs1_1  = inst1[19:15];
+    assign rs2_1  = inst1[24:20];
+    assign imm_i1 = {{21{inst1[31]}}, inst1[30:20]};
+    assign imm_b1 = {{20{inst1[31]}}, inst1[7], inst1[30:25], inst1[11:8], 1'b0};
+    assign imm_j1 = {{12{inst1[31]}}, inst1[19:12], inst1[20], inst1[30:21], 1'b0};
+
+    assign slot0_alu = alu0[32] && (opcode == op_lui || opcode == op_auipc ||
+                                    opcode == op_arith || opcode == op_arith_i);
+    assign rs1_data1 = (rs1_1 == 0) ? 32'd0 : (slot0_alu && rd == rs1_1) ? alu0[31:0] : regs[rs1_1];
+    assign rs2_data1 = (rs2_1 == 0) ? 32'd0 : (slot0_alu && rd == rs2_1) ? alu0[31:0] : regs[rs2_1];
+    assign alu1      = alu_exec(inst1, rs1_data1, rs2_data1, pc + 32'd4);
+    assign br1       = branch_exec(inst1[14:12], rs1_data1, rs2_data1);
+
+    always_comb begin
+        case (opcode)
+            default:     slot0_ok = 1'b0;
+            op_lui,
+            op_auipc,
+            op_arith,
+            op_arith_i:  slot0_ok = alu0[32];
+            op_b_x:      slot0_ok = br0[1] && !br0[0];
+            op_load:     slot0_ok = load_valid;
+            op_store:    slot0_ok = store_valid;
+        endcase
+        slot1_rd  = 1'b1;
+        slot1_rs1 = 1'b1;
+        slot1_rs2 = 1'b0;
+        case (opcode_val'(inst1[6:0]))
+            default: begin
+                slot1_ok  = 1'b0;
+            end
+            op_lui, op_auipc: begin
+                slot1_ok  = 1'b1;
+                slot1_rs1 = 1'b0;
+            end
+            op_arith_i: begin
+                slot1_ok  = alu1[32];
+            end
+            op_arith: begin
+                slot1_ok  = alu1[32];
+                slot1_rs2 = 1'b1;
+            end
+            op_b_x: begin
+                slot1_ok  = br1[1];
+                slot1_rd  = 1'b0;
+                slot1_rs2 = 1'b1;
+            end
+            op_jal: begin
+                slot1_ok  = 1'b1;
+                slot1_rs1 = 1'b0;
+            end
+            op_jalr: begin
+                slot1_ok  = inst1[14:12] == 3'b000;
+            end
+        endcase
+    end
+
+    assign load_hazard = opcode == op_load && rd != 5'd0 &&
+                         ((slot1_rd && rd1 == rd) || (slot1_rs1 && rs1_1 == rd) || (slot1_rs2 && rs2_1 == rd));
+
+    // Macro-op fusion. The second half of an idiom consumes the register the
+    // first half wrote, so the pair is one operation with a single register
+    // write. It reuses the slot 1 decode and forwarding of dual issue and
+    // works on the same aligned pairs, without the second write port.
+    //   lui/auipc rd + addi rd, rd       constant and address builds
+    //   auipc rd + jalr rd/x0, rd        far calls and tail calls
+    //   slli rd + srli/srai rd, rd       zero and sign extension
+    //   addi rd + branch on rd           loop tails
+    reg  [3:0]  fuse_kind;
+    wire        fuse;
+
+    always_comb begin
+        fuse_kind = '0;
+        if (slot0_alu && rd != 5'd0 && rs1_1 == rd) begin
+            fuse_kind[FUSE_LUI_ADDI]    = (opcode == op_lui || opcode == op_auipc) &&
+                                          inst1[6:0] == op_arith_i && inst1[14:12] == arith_add && rd1 == rd;
+            fuse_kind[FUSE_AUIPC_JALR]  = opcode == op_auipc && inst1[6:0] == op_jalr && inst1[14:12] == 3'b000 &&
+                                          (rd1 == rd || rd1 == 5'd0);
+            fuse_kind[FUSE_SHIFT]       = opcode == op_arith_i && func3 == arith_sll &&
+                                          inst1[6:0] == op_arith_i && inst1[14:12] == arith_sr &&
+                                          alu1[32] && rd1 == rd;
+        end
+        fuse_kind[FUSE_ADDI_BRANCH] = slot0_alu && rd != 5'd0 && opcode == op_arith_i && func3 == arith_add &&
+                                      inst1[6:0] == op_b_x && br1[1] && (rs1_1 == rd || rs2_1 == rd);
+    end
+
+    assign fuse = FUSION != 0 && SYNC_READ == 0 && !pc[2] && !core_hault && !sb_hold && !irq_take && !sb_wait && fuse_kind != '0;
+
+    // a fused pair does not issue as a dual pair as well
+    assign dual = DUAL_ISSUE != 0 && SYNC_READ == 0 && !pc[2] && !core_hault && !sb_hold && !irq_take && !sb_wait &&
+                  slot0_ok && slot1_ok && !load_hazard && !fuse;
+
+    // E-Trace instruction types, the ones this core produces
+    localparam ITYPE_NONE      = 3'd0;
+    localparam ITYPE_INTERRUPT = 3'd2;
+    localparam ITYPE_RETURN    = 3'd3;
+    localparam ITYPE_NOT_TAKEN = 3'd4;
+    localparam ITYPE_TAKEN     = 3'd5;
+    localparam ITYPE_JUMP      = 3'd6;
+
+    function automatic logic [2:0] trace_type(input logic [31:0] inst, input logic taken);
+        case (opcode_val'(inst[6:0]))
+            op_b_x:      trace_type = taken ? ITYPE_TAKEN : ITYPE_NOT_TAKEN;
+            op_jalr:     trace_type = ITYPE_JUMP;
+            // mret
+            op_esys_csr: trace_type = inst == 32'h30200073 ? ITYPE_RETURN : ITYPE_NONE;
+            default:     trace_type = ITYPE_NONE;
+        endcase
+    endfunction
+
+    // the cycles the main state update below executes an instruction, the
+    // same conditions in the same order
+    wire        trace_exec;
+
+    assign trace_exec       = ram_gnt && !wfi_sleep && !ecall_wait && sync_ready && !sb_wait && !cfu_wait;
+    assign trace_iretire    = !trace_exec || core_hault || irq_take ? 2'd0 : dual || fuse ? 2'd2 : 2'd1;
+    assign trace_iaddr      = pc;
+    assign trace_itype[2:0] = trace_exec && irq_take ? ITYPE_INTERRUPT : trace_type(instruction, br0[0]);
+    assign trace_itype[5:3] = trace_iretire == 2'd2 ? trace_type(inst1, br1[0]) : ITYPE_NONE;
+
+    // cycle and time keep counting while other harts own the ram
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            rdcycle <= '0;
+            rdtime  <= '0;
+        end else begin
+`ifdef VERILATOR
+            rdcycle <= rdcycle + 64'd1 + 64'(time_skip);
+            rdtime  <= rdtime + 64'd1 + 64'(time_skip);
+`else
+            rdcycle <= rdcycle + 64'd1;
+            rdtime  <= rdtime + 64'd1;
+`endif
+        end
+    end
+
     always_ff @(posedge(clk)) begin
         if (!reset_n) begin
             pc              <= START_ADDR;
             core_fault      <= '0;
-            ram_wr_en       <= '0;
-            ram_wr_strobe   <= '1;
-            ram_data_in     <= '0;
+            data_wr_en      <= '0;
+            data_wr_strobe  <= '1;
+            data_wr_data    <= '0;
             core_hault      <= '0;
             prev_inst       <= '0;
             load_store_addr <= '0;
-            ram_wr_en       <= 1'b0;
-            rdcycle         <= '0;
-            rdtime          <= '0;
+            data_wr_en      <= 1'b0;
+            sb_hold         <= 1'b0;
             rdinstret       <= '0;
-            regs            <= '{default: '0};
-        end else begin
-            pc        <= core_hault ? pc : pc + 32'd4;
+            fuse_count      <= '{default: '0};
+            amo_wr          <= 1'b0;
+            resv_valid      <= 1'b0;
+            resv_addr       <= '0;
+            wfi_sleep       <= 1'b0;
+            ecall_wait      <= 1'b0;
+            mstatus_mie     <= 1'b0;
+            mstatus_mpie    <= 1'b0;
+            mie             <= '0;
+            mtvec           <= '0;
+            mscratch        <= '0;
+            mepc            <= '0;
+            mcause          <= '0;
+            phase           <= '0;
+            // a block ram has no reset
+            if (SYNC_READ == 0) begin
+                regs        <= '{default: '0};
+            end
+        end else if (!ram_gnt || wfi_sleep || ecall_wait) begin
+            // another master owns the ram this cycle, we are parked in wfi
+            // or the host is servicing an ecall, hold all state
+            if (resv_snoop_hit) begin
+                resv_valid <= 1'b0;
+            end
+            if (irq_wake) begin
+                wfi_sleep <= 1'b0;
+            end
+            if (ecall_wait && ecall_ack) begin
+                regs[10]   <= ecall_ret;
+                ecall_wait <= 1'b0;
+            end
+        end else if (!sync_ready) begin
+            // the address or decode cycle of a SYNC_READ instruction
+            phase <= phase + 2'd1;
+            if (resv_snoop_hit) begin
+                resv_valid <= 1'b0;
+            end
+        end else if (sb_wait || cfu_wait) begin
+            // hold the instruction while the port writes back the buffer or
+            // the accelerator works
             prev_inst <= instruction;
-            ram_wr_en <= 1'b0;
-            rdcycle   <= rdcycle + 1'b1;
-            rdtime    <= rdtime + 1'b1;
-            if (!core_hault) begin
+            sb_hold   <= 1'b1;
+            if (resv_snoop_hit) begin
+                resv_valid <= 1'b0;
+            end
+        end else begin
+            pc         <= core_hault ? pc : pc + 32'd4;
+            prev_inst  <= instruction;
+            data_wr_en <= 1'b0;
+            sb_hold    <= 1'b0;
+            phase      <= '0;
+            if (!core_hault && !irq_take) begin
                 rdinstret   <= rdinstret + 1'b1;
             end
             case (opcode)
@@ -129,11 +812,13 @@ module rv32_core
                     pc         <= pc;
                     core_fault <= fault_decode_err;
                 end
-                op_lui: begin // load upper immidiate
-                    regs[rd] <= imm_u;
-                end
-                op_auipc: begin
-                    regs[rd] <= pc + imm_u;
+                op_lui, op_auipc, op_arith_i, op_arith: begin
+                    if (alu0[32]) begin
+                        regs[rd] <= alu0[31:0];
+                    end else begin
+                        pc         <= pc;
+                        core_fault <= fault_decode_err;
+                    end
                 end
                 op_jal: begin
                     regs[rd] <= pc + 4;
@@ -144,188 +829,24 @@ module rv32_core
                     pc       <= rs1_data + imm_i;
                 end
                 op_b_x: begin
-                    case (func3)
-                        default:
-                            begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        3'b000:
-                            begin
-                                if (rs1_data == rs2_data) begin
-                                    pc <= pc + imm_b;
-                                end
-                            end
-                        3'b001:
-                            begin
-                                if (rs1_data != rs2_data) begin
-                                    pc <= pc + imm_b;
-                                end
-                            end
-                        3'b100:
-                            begin
-                                if ($signed(rs1_data) < $signed(rs2_data)) begin
-                                    pc <= pc + imm_b;
-                                end
-                            end
-                        3'b101:
-                            begin
-                                if ($signed(rs1_data) >= $signed(rs2_data)) begin
-                                    pc <= pc + imm_b;
-                                end
-                            end
-                        3'b110:
-                            begin
-                                if ($unsigned(rs1_data) < $unsigned(rs2_data)) begin
-                                    pc <= pc + imm_b;
-                                end
-                            end
-                        3'b111:
-                            begin
-                                if ($unsigned(rs1_data) >= $unsigned(rs2_data)) begin
-                                    pc <= pc + imm_b;
-                                end
-                            end
-                    endcase
-                end
-                op_arith_i: begin
-                    case (func3)
-                        default: begin
-                            pc         <= pc;
-                            core_fault <= fault_decode_err;
-                        end
-                        arith_add: begin
-                            regs[rd]   <= rs1_data + imm_i;
-                        end
-                        arith_slt: begin
-                            if ($signed(rs1_data) < $signed(imm_i)) begin
-                                regs[rd]   <= 32'd1;
-                            end else begin
-                                regs[rd]   <= 32'd0;
-                            end
-                        end
-                        arith_sltu: begin
-                            if ($unsigned(rs1_data) < $unsigned(imm_i)) begin
-                                regs[rd]   <= 32'd1;
-                            end else begin
-                                regs[rd]   <= 32'd0;
-                            end
-                        end
-                        arith_xor: begin
-                            regs[rd]   <= rs1_data ^ imm_i;
-                        end
-                        arith_or: begin
-                            regs[rd]   <= rs1_data | imm_i;
-                        end
-                        arith_and: begin
-                            regs[rd]   <= rs1_data & imm_i;
-                        end
-                        arith_sll: begin
-                            if (func7==7'b0000000) begin
-                                regs[rd]   <= rs1_data << imm_i[4:0];
-                            end else begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        end
-                        arith_sr: begin
-                            if (func7==7'b0000000) begin
-                                regs[rd]   <= rs1_data >> imm_i[4:0];
-                            end else if (func7==7'b0100000) begin
-                                regs[rd]   <= $signed(rs1_data) >>> imm_i[4:0];
-                            end else begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        end
-                    endcase
+                    if (!br0[1]) begin
+                        pc         <= pc;
+                        core_fault <= fault_decode_err;
+                    end else if (br0[0]) begin
+                        pc <= pc + imm_b;
+                    end
                 end
-                op_arith: begin
-                    case (func3)
-                        default: begin
-                            pc         <= pc;
-                            core_fault <= fault_decode_err;
-                        end
-                        arith_add: begin
-                            if (func7==7'b0000000) begin
-                                regs[rd]   <= rs1_data + rs2_data;
-                            end else if (func7==7'b0100000) begin
-                                regs[rd]   <= rs1_data - rs2_data;
-                            end else begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        end
-                        arith_sll: begin
-                            if (func7==7'b0000000) begin
-                                regs[rd]   <= rs1_data << rs2_data[4:0];
-                            end else begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        end
-                        arith_slt: begin
-                            if (func7==7'b0000000) begin
-                                if ($signed(rs1_data) < $signed(rs2_data)) begin
-                                    regs[rd]   <= 32'd1;
-                                end else begin
-                                    regs[rd]   <= 32'd0;
-                                end
-                            end else begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        end
-                        arith_sltu: begin
-                            if (func7==7'b0000000) begin
-                                if ($unsigned(rs1_data) < $unsigned(rs2_data)) begin
-                                    regs[rd]   <= 32'd1;
-                                end else begin
-                                    regs[rd]   <= 32'd0;
-                                end
-                            end else begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        end
-                        arith_xor: begin
-                            if (func7==7'b0000000) begin
-                                regs[rd]   <= rs1_data ^ rs2_data;
-                            end else begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        end
-                        arith_sr: begin
-                            if (func7==7'b0000000) begin
-                                regs[rd]   <= rs1_data >> rs2_data[4:0];
-                            end else if (func7==7'b0100000) begin
-                                regs[rd]   <= $signed(rs1_data) >>> rs2_data[4:0];
-                            end else begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        end
-                        arith_or: begin
-                            if (func7==7'b0000000) begin
-                                regs[rd]   <= rs1_data | rs2_data;
-                            end else begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        end
-                        arith_and: begin
-                            if (func7==7'b0000000) begin
-                                regs[rd]   <= rs1_data & rs2_data;
-                            end else begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                            end
-                        end
-                    endcase
+                op_custom0: begin
+                    if (CFU != 0) begin
+                        regs[rd] <= cfu_have ? cfu_data : cfu_result;
+                    end else begin
+                        pc         <= pc;
+                        core_fault <= fault_decode_err;
+                    end
                 end
                 op_fence: begin
-                    // this is a NOP until we have muti-core or caching
+                    // sb_wait held the fence until the store buffer drained,
+                    // past that the harts share a single un-cached ram port
                 end
                 op_esys_csr: begin
                     case (func3)
@@ -335,177 +856,256 @@ module rv32_core
                         end
                         3'b000: begin
                             if (rs1 == 5'b00000 && rd==5'b00000 && func7 == '0 && rs2 == '0) begin 
-                                // ecall
+                                // ecall, pc already points past it
+                                ecall_wait <= 1'b1;
                             end else if (rs1 == 5'b00000 && rd==5'b00000 && func7 == '0 && rs2 == 5'b00001) begin
                                 // ebreak
+                            end else if (rs1 == 5'b00000 && rd==5'b00000 && func7 == 7'b0011000 && rs2 == 5'b00010) begin
+                                // mret
+                                pc           <= mepc;
+                                mstatus_mie  <= mstatus_mpie;
+                                mstatus_mpie <= 1'b1;
+                            end else if (rs1 == 5'b00000 && rd==5'b00000 && func7 == 7'b0001000 && rs2 == 5'b00101) begin
+                                // wfi, park until an enabled interrupt is pending
+                                wfi_sleep    <= !irq_wake;
                             end else begin
                                 pc         <= pc;
                                 core_fault <= fault_decode_err;
                             end
                         end
-                        3'b001, 3'b101: begin // csrrw or csrrwi
-                            core_fault <= fault_illegal_access;
-                            pc         <= pc;
-                        end
-                        3'b010, 3'b011, 3'b110, 3'b111: begin // csrrs or csrrc / csrrsi or csrrci
-                            if (rs1 != 0) begin
+                        // csrrw, csrrs, csrrc / csrrwi, csrrsi, csrrci
+                        3'b001, 3'b010, 3'b011, 3'b101, 3'b110, 3'b111: begin
+                            if (!csr_valid || (csr_wr && !csr_writable)) begin
                                 core_fault <= fault_illegal_access;
                                 pc         <= pc;
                             end else begin
-                                case (imm_i[11:0])
-                                    default: begin
-                                        core_fault <= fault_illegal_access;
-                                        pc         <= pc;
-                                    end
-                                    12'hc00: begin
-                                        regs[rd]      <= rdcycle[31:0];
-                                    end
-                                    12'hc01: begin
-                                        regs[rd]      <= rdtime[31:0];
-                                    end
-                                    12'hc02: begin
-                                        regs[rd]      <= rdinstret[31:0];
-                                    end
-                                    12'hc80: begin
-                                        regs[rd]      <= rdcycle[63:32];
-                                    end
-                                    12'hc81: begin
-                                        regs[rd]      <= rdtime[63:32];
-                                    end
-                                    12'hc82: begin
-                                        regs[rd]      <= rdinstret[63:32];
-                                    end
-                                endcase
+                                regs[rd] <= csr_rdata;
+                                if (csr_wr) begin
+                                    case (imm_i[11:0])
+                                        default: begin
+                                        end
+                                        12'h300: begin
+                                            mstatus_mie  <= csr_wdata[3];
+                                            mstatus_mpie <= csr_wdata[7];
+                                        end
+                                        12'h304: begin
+                                            mie      <= csr_wdata & ((32'd1 << MIP_MEIP) | (32'd1 << MIP_MTIP) | (32'd1 << MIP_MSIP));
+                                        end
+                                        12'h305: begin
+                                            mtvec    <= {csr_wdata[31:2], 2'b00};
+                                        end
+                                        12'h340: begin
+                                            mscratch <= csr_wdata;
+                                        end
+                                        12'h341: begin
+                                            mepc     <= {csr_wdata[31:2], 2'b00};
+                                        end
+                                        12'h342: begin
+                                            mcause   <= csr_wdata;
+                                        end
+                                    endcase
+                                end
                             end
                         end
                     endcase
                 end
                 op_load: begin
-                    if (!core_hault) begin
-                        if (func3 == 3'b010 || func3 == 3'b001 ||
-                                func3 == 3'b000 || func3 == 3'b101 ||
-                                func3 == 3'b100) begin
-                            core_hault      <= 1'b1;
-                            load_store_addr <= rs1_data + imm_i;
-                        end else begin
-                            pc              <= pc;
-                            core_fault      <= fault_decode_err;
-                        end
+                    if (!load_valid) begin
+                        pc         <= pc;
+                        core_fault <= fault_decode_err;
+                    end else if (core_hault) begin
+                        core_hault <= 1'b0;
+                        regs[rd]   <= load_result;
+                    end else if (sb_fwd) begin
+                        regs[rd]   <= load_result;
                     end else begin
-                        core_hault  <= 1'b0;
-                        case (func3)
+                        core_hault      <= 1'b1;
+                        load_store_addr <= load_addr_comb;
+                    end
+                end
+                op_store: begin
+                    if (!store_valid) begin
+                        pc         <= pc;
+                        core_fault <= fault_decode_err;
+                    end else if (core_hault) begin
+                        core_hault <= 1'b0;
+                    end else if (store_direct) begin
+                        // written straight through, the buffer is empty
+                        core_hault      <= 1'b1;
+                        load_store_addr <= store_addr_comb;
+                        data_wr_en      <= 1'b1;
+                        data_wr_strobe  <= store_strobe;
+                        data_wr_data    <= store_data;
+                    end
+                    // stores to ram go into the store buffer
+                end
+                op_amo: begin
+                    if (func3 != 3'b010) begin
+                        pc         <= pc;
+                        core_fault <= fault_decode_err;
+                    end else if (!core_hault) begin
+                        case (amo_func5)
                             default: begin
                                 pc         <= pc;
                                 core_fault <= fault_decode_err;
                             end
-                            3'b010: begin
-                                regs[rd]   <= ram_data_out;
-                            end
-                            3'b001: begin
-                                if (load_store_addr[1]) begin
-                                    regs[rd] <= {{16{ram_data_out[31]}}, ram_data_out[31:16]};
+                            amo_lr: begin
+                                if (rs2 == 5'b00000) begin
+                                    core_hault      <= 1'b1;
+                                    load_store_addr <= rs1_data;
                                 end else begin
-                                    regs[rd] <= {{16{ram_data_out[15]}}, ram_data_out[15:0]};
+                                    pc         <= pc;
+                                    core_fault <= fault_decode_err;
                                 end
                             end
-                            3'b000: begin
-                                case (load_store_addr[1:0])
-                                    2'b00: begin
-                                        regs[rd] <= {{24{ram_data_out[7]}}, ram_data_out[7:0]};
-                                    end
-                                    2'b01: begin
-                                        regs[rd] <= {{24{ram_data_out[15]}}, ram_data_out[15:8]};
-                                    end
-                                    2'b10: begin
-                                        regs[rd] <= {{24{ram_data_out[23]}}, ram_data_out[23:16]};
-                                    end
-                                    2'b11: begin
-                                        regs[rd] <= {{24{ram_data_out[31]}}, ram_data_out[31:24]};
-                                    end
-                                endcase
-                            end
-                            3'b101: begin
-                                if (load_store_addr[1]) begin
-                                    regs[rd] <= {16'd0, ram_data_out[31:16]};
+                            amo_sc: begin
+                                resv_valid <= 1'b0;
+                                if (sc_pass) begin
+                                    core_hault      <= 1'b1;
+                                    load_store_addr <= rs1_data;
+                                    data_wr_en      <= 1'b1;
+                                    data_wr_strobe  <= 4'b1111;
+                                    data_wr_data    <= rs2_data;
+                                    regs[rd]        <= 32'd0;
                                 end else begin
-                                    regs[rd] <= {16'd0, ram_data_out[15:0]};
+                                    regs[rd]        <= 32'd1;
                                 end
                             end
-                            3'b100: begin
-                                case (load_store_addr[1:0])
-                                    2'b00: begin
-                                        regs[rd] <= {24'd0, ram_data_out[7:0]};
-                                    end
-                                    2'b01: begin
-                                        regs[rd] <= {24'd0, ram_data_out[15:8]};
-                                    end
-                                    2'b10: begin
-                                        regs[rd] <= {24'd0, ram_data_out[23:16]};
-                                    end
-                                    2'b11: begin
-                                        regs[rd] <= {24'd0, ram_data_out[31:24]};
-                                    end
-                                endcase
-                            end
-                        endcase
-                    end
-                end
-                op_store: begin
-                    if (!core_hault) begin
-                        core_hault      <= 1'b1;
-                        load_store_addr <= store_addr_comb;
-                        ram_wr_en       <= 1'b1;
-                        case (func3)
-                            3'b010: begin
-                                ram_wr_strobe <= 4'b1111;
-                                ram_data_in   <= rs2_data;
-                            end
-                            3'b001: begin
-                                case (store_addr_comb[1])
-                                    0: begin
-                                        ram_wr_strobe <= 4'b0011;
-                                        ram_data_in   <= rs2_data;
-                                    end
-                                    1: begin
-                                        ram_wr_strobe      <= 4'b1100;
-                                        ram_data_in[31:16] <= rs2_data[15:0];
-                                    end
-                                endcase
-                            end
-                            3'b000: begin
-                                case (store_addr_comb[1:0])
-                                    2'b00: begin
-                                        ram_wr_strobe <= 4'b0001;
-                                        ram_data_in   <= rs2_data;
-                                    end
-                                    2'b01: begin
-                                        ram_wr_strobe     <= 4'b0010;
-                                        ram_data_in[15:8] <= rs2_data[7:0];
-                                    end
-                                    2'b10: begin
-                                        ram_wr_strobe      <= 4'b0100;
-                                        ram_data_in[23:16] <= rs2_data[7:0];
-                                    end
-                                    2'b11: begin
-                                        ram_wr_strobe      <= 4'b1000;
-                                        ram_data_in[31:24] <= rs2_data[7:0];
-                                    end
-                                endcase
-                            end
-                            default: begin
-                                pc         <= pc;
-                                core_fault <= fault_decode_err;
-                                core_hault <= 1'b0;
-                                ram_wr_en  <= 1'b0;
+                            amo_swap, amo_add, amo_xor, amo_or, amo_and,
+                            amo_min, amo_max, amo_minu, amo_maxu: begin
+                                core_hault      <= 1'b1;
+                                load_store_addr <= rs1_data;
                             end
                         endcase
+                    end else if (amo_is_rmw && !amo_wr) begin
+                        // read half of the read-modify-write, ram_lock keeps
+                        // the grant for the write half next cycle
+                        regs[rd]       <= ram_data_out;
+                        data_wr_en     <= 1'b1;
+                        data_wr_strobe <= 4'b1111;
+                        data_wr_data   <= amo_result;
+                        amo_wr         <= 1'b1;
                     end else begin
-                        core_hault  <= 1'b0;
+                        core_hault <= 1'b0;
+                        amo_wr     <= 1'b0;
+                        if (amo_func5 == amo_lr) begin
+                            regs[rd]   <= ram_data_out;
+                            resv_valid <= 1'b1;
+                            resv_addr  <= load_store_addr[ADDR_WIDTH-1+2:2];
+                        end
                     end
                 end
             endcase
+            // slot 0 already wrote its result above, the fused half
+            // overrides it where the pair leaves a different value in rd
+            if (fuse) begin
+                pc        <= pc + 32'd8;
+                rdinstret <= rdinstret + 64'd2;
+                if (fuse_kind[FUSE_AUIPC_JALR]) begin
+                    if (rd1 == rd) begin
+                        regs[rd] <= pc + 32'd8;
+                    end
+                    pc <= rs1_data1 + imm_i1;
+                end else if (fuse_kind[FUSE_ADDI_BRANCH]) begin
+                    if (br1[0]) begin
+                        pc <= pc + 32'd4 + imm_b1;
+                    end
+                end else begin
+                    regs[rd] <= alu1[31:0];
+                end
+                for (int i = 0; i < 4; i++) begin
+                    if (fuse_kind[i]) begin
+                        fuse_count[i] <= fuse_count[i] + 32'd1;
+                    end
+                end
+            end
+            if (dual) begin
+                pc        <= pc + 32'd8;
+                rdinstret <= rdinstret + 64'd2;
+                case (opcode_val'(inst1[6:0]))
+                    default: begin
+                        regs[rd1] <= alu1[31:0];
+                    end
+                    op_b_x: begin
+                        if (br1[0]) begin
+                            pc <= pc + 32'd4 + imm_b1;
+                        end
+                    end
+                    op_jal: begin
+                        regs[rd1] <= pc + 32'd8;
+                        pc        <= pc + 32'd4 + imm_j1;
+                    end
+                    op_jalr: begin
+                        regs[rd1] <= pc + 32'd8;
+                        pc        <= rs1_data1 + imm_i1;
+                    end
+                endcase
+            end
+            // the fetched instruction ran as a nop, redirect to the handler
+            if (irq_take) begin
+                pc           <= mtvec;
+                mepc         <= pc;
+                mcause       <= {1'b1, 26'd0, irq_cause};
+                mstatus_mpie <= mstatus_mie;
+                mstatus_mie  <= 1'b0;
+            end
+            if (resv_snoop_hit) begin
+                resv_valid <= 1'b0;
+            end
+        end
+    end
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            cfu_busy <= 1'b0;
+            cfu_have <= 1'b0;
+            cfu_data <= '0;
+        end else if (cfu_retire) begin
+            cfu_busy <= 1'b0;
+            cfu_have <= 1'b0;
+        end else if ((cfu_start || cfu_busy) && cfu_done) begin
+            cfu_busy <= 1'b0;
+            cfu_have <= 1'b1;
+            cfu_data <= cfu_result;
+        end else if (cfu_start) begin
+            cfu_busy <= 1'b1;
         end
     end
 
+    wire sb_push;
+
+    assign sb_push = sync_ready && !core_hault && !irq_take && !sb_wait && opcode == op_store &&
+                     store_valid && !store_direct;
+
+    // shift out the entry written back this cycle, then merge or append
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            sb_count <= '0;
+            sb_age   <= '0;
+        end else if (ram_gnt && !wfi_sleep && !ecall_wait) begin
+            if (sb_drain) begin
+                for (int i = 0; i < SB_DEPTH - 1; i++) begin
+                    sb_addr[i]   <= sb_addr[i + 1];
+                    sb_data[i]   <= sb_data[i + 1];
+                    sb_strobe[i] <= sb_strobe[i + 1];
+                end
+            end
+            if (sb_push && store_merge) begin
+                sb_data[SB_IDX'(sb_live - 1'b1)]   <= (store_data & store_mask) |
+                                                      (sb_data[SB_IDX'(sb_count - 1'b1)] & ~store_mask);
+                sb_strobe[SB_IDX'(sb_live - 1'b1)] <= sb_strobe[SB_IDX'(sb_count - 1'b1)] | store_strobe;
+            end else if (sb_push) begin
+                sb_addr[SB_IDX'(sb_live)]   <= store_addr_comb[ADDR_WIDTH-1+2:2];
+                sb_data[SB_IDX'(sb_live)]   <= store_data;
+                sb_strobe[SB_IDX'(sb_live)] <= store_strobe;
+            end
+            sb_count <= sb_live + SB_BITS'(sb_push && !store_merge);
+            if (sb_drain || sb_count == '0) begin
+                sb_age <= '0;
+            end else if (!sb_stale) begin
+                sb_age <= sb_age + 1'b1;
+            end
+        end
+    end
 
 endmodule
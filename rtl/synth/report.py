@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+
+import argparse
+import json
+
+from pathlib import Path
+
+# left out of the area, see synth_wrap.sv
+HARNESS = 'synth_wrap'
+
+
+# ECP5 cells after synth_ecp5 summed over the modules below the harness, a
+# CCU2C carry cell is two LUT4s
+def area(stat):
+    cells = {}
+    for name, module in stat['modules'].items():
+        if name.lstrip('\\') == HARNESS:
+            continue
+        for cell, count in module.get('num_cells_by_type', {}).items():
+            cells[cell] = cells.get(cell, 0) + count
+    return {
+        'luts': cells.get('LUT4', 0) + 2 * cells.get('CCU2C', 0),
+        'ffs': cells.get('TRELLIS_FF', 0),
+        'brams': cells.get('DP16KD', 0),
+        'lutram': cells.get('TRELLIS_DPR16X4', 0),
+        'dsps': cells.get('MULT18X18D', 0),
+    }
+
+
+# the lowest fmax of any clock and the longest of the critical paths
+def timing(report):
+    fmax = min(clock['achieved'] for clock in report['fmax'].values())
+    worst = None
+    for path in report.get('critical_paths', []):
+        delay = sum(step.get('delay', 0) for step in path['path'])
+        if worst is None or delay > worst[0]:
+            worst = (delay, path['path'])
+    if worst is None:
+        return fmax, '', 0, 0.0
+    delay, steps = worst
+    start = steps[0].get('from', {}).get('cell', '?')
+    end = steps[-1].get('to', {}).get('cell', '?')
+    levels = sum(1 for step in steps if step.get('type') == 'logic')
+    return fmax, f'{start} -> {end}', levels, delay
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description='area and fmax per configuration, from build/<config>.stat.json and .report.json')
+    parser.add_argument('configs', nargs='+', help='build/<config> prefixes')
+    args = parser.parse_args()
+
+    rows = []
+    paths = []
+    for prefix in args.configs:
+        name = Path(prefix).name
+        with Path(prefix + '.stat.json').open() as f:
+            a = area(json.load(f))
+        with Path(prefix + '.report.json').open() as f:
+            fmax, path, levels, delay = timing(json.load(f))
+        rows.append((name, a, fmax, levels, delay))
+        paths.append((name, path))
+
+    print(f"{'config':<10} {'LUT4':>7} {'FF':>7} {'BRAM':>5} {'LUTRAM':>7} {'DSP':>4} "
+          f"{'fmax MHz':>9} {'levels':>7} {'path ns':>8} {'MHz/kLUT':>9}")
+    for name, a, fmax, levels, delay in rows:
+        print(f"{name:<10} {a['luts']:>7} {a['ffs']:>7} {a['brams']:>5} {a['lutram']:>7} {a['dsps']:>4} "
+              f"{fmax:>9.2f} {levels:>7} {delay:>8.2f} {1000 * fmax / max(a['luts'], 1):>9.2f}")
+    print()
+    print('critical paths:')
+    for name, path in paths:
+        print(f'  {name:<10} {path}')
@@ -0,0 +1,138 @@
+// Out of context harness for synthesising one rv32_core, see the Makefile.
+// The core has far more ports than the part has pins, so the inputs come out
+// of a shift register fed from one pin and the outputs are registered and
+// folded into another. Every path into and out of the core starts or ends at
+// a flop, ram_data_out arrives at the start of the cycle like from the
+// output register of a block ram. The harness cells are left out of the
+// area report, which only counts the modules below it.
+module synth_wrap
+    # (
+        parameter ADDR_WIDTH = 16,
+        // see rv32_core
+        parameter DUAL_ISSUE = 0,
+        parameter FUSION     = 0,
+        parameter SYNC_READ  = 0,
+        // a cfu_mac on the custom-0 port instead of harness inputs
+        parameter CFU        = 0
+    )
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        input  wire                     din,
+        output reg                      dout
+    );
+
+    localparam IN_BITS  = 32 + 32 + 1 + 1 + ADDR_WIDTH + 3 + 1 + 32 + 1 + 32;
+    localparam OUT_BITS = 1 + 4 + ADDR_WIDTH + 32 + 1 + 1 + 1 + 1 + 1 + 1 + 10 + 32 + 32 + 2 + 6 + 32 + 4;
+
+    reg  [IN_BITS-1:0]      in_q;
+    reg  [OUT_BITS-1:0]     out_q;
+    wire [OUT_BITS-1:0]     out;
+
+    wire [32-1:0]           ram_data_out;
+    wire [32-1:0]           ram_fetch_hi;
+    wire                    ram_gnt;
+    wire                    snoop_wr_en;
+    wire [ADDR_WIDTH-1:0]   snoop_addr;
+    wire                    timer_irq;
+    wire                    soft_irq;
+    wire                    ext_irq;
+    wire                    ecall_ack;
+    wire [32-1:0]           ecall_ret;
+    wire                    in_cfu_done;
+    wire [32-1:0]           in_cfu_result;
+
+    wire                    ram_wr_en;
+    wire [4-1:0]            ram_wr_strobe;
+    wire [ADDR_WIDTH-1:0]   ram_addr;
+    wire [32-1:0]           ram_data_in;
+    wire                    ram_req;
+    wire                    ram_lock;
+    wire                    ram_fetch;
+    wire                    sleep;
+    wire                    ecall_req;
+    wire                    cfu_start;
+    wire [10-1:0]           cfu_func;
+    wire [32-1:0]           cfu_rs1;
+    wire [32-1:0]           cfu_rs2;
+    wire                    cfu_done;
+    wire [32-1:0]           cfu_result;
+    wire [1:0]              trace_iretire;
+    wire [2*3-1:0]          trace_itype;
+    wire [32-1:0]           trace_iaddr;
+    wire [3:0]              core_fault;
+
+    assign {ram_data_out, ram_fetch_hi, ram_gnt, snoop_wr_en, snoop_addr, timer_irq, soft_irq, ext_irq,
+            ecall_ack, ecall_ret, in_cfu_done, in_cfu_result} = in_q;
+    assign out = {ram_wr_en, ram_wr_strobe, ram_addr, ram_data_in, ram_req, ram_lock, ram_fetch, sleep, ecall_req,
+                  cfu_start, cfu_func, cfu_rs1, cfu_rs2, trace_iretire, trace_itype, trace_iaddr, core_fault};
+
+    always_ff @(posedge(clk)) begin
+        in_q  <= {in_q[IN_BITS-2:0], din};
+        out_q <= out;
+        dout  <= ^out_q;
+    end
+
+    rv32_core
+    #(
+        .ADDR_WIDTH ( ADDR_WIDTH ),
+        .DUAL_ISSUE ( DUAL_ISSUE ),
+        .FUSION     ( FUSION     ),
+        .CFU        ( CFU        ),
+        .SYNC_READ  ( SYNC_READ  )
+    )
+    rv32_inst
+    (
+        .clk           ( clk           ),
+        .reset_n       ( reset_n       ),
+        .ram_wr_en     ( ram_wr_en     ),
+        .ram_wr_strobe ( ram_wr_strobe ),
+        .ram_addr      ( ram_addr      ),
+        .ram_data_in   ( ram_data_in   ),
+        .ram_data_out  ( ram_data_out  ),
+        .ram_fetch_hi  ( ram_fetch_hi  ),
+        .ram_req       ( ram_req       ),
+        .ram_lock      ( ram_lock      ),
+        .ram_gnt       ( ram_gnt       ),
+        .ram_fetch     ( ram_fetch     ),
+        .snoop_wr_en   ( snoop_wr_en   ),
+        .snoop_addr    ( snoop_addr    ),
+        .timer_irq     ( timer_irq     ),
+        .soft_irq      ( soft_irq      ),
+        .ext_irq       ( ext_irq       ),
+        // the testbench only, see rv32_core
+        .time_skip     ( 32'd0         ),
+        .sleep         ( sleep         ),
+        .ecall_req     ( ecall_req     ),
+        .ecall_ack     ( ecall_ack     ),
+        .ecall_ret     ( ecall_ret     ),
+        .cfu_start     ( cfu_start     ),
+        .cfu_func      ( cfu_func      ),
+        .cfu_rs1       ( cfu_rs1       ),
+        .cfu_rs2       ( cfu_rs2       ),
+        .cfu_done      ( cfu_done      ),
+        .cfu_result    ( cfu_result    ),
+        .trace_iretire ( trace_iretire ),
+        .trace_itype   ( trace_itype   ),
+        .trace_iaddr   ( trace_iaddr   ),
+        .core_fault    ( core_fault    )
+    );
+
+    if (CFU != 0) begin : gen_cfu
+        cfu_mac cfu_inst
+        (
+            .clk     ( clk        ),
+            .reset_n ( reset_n    ),
+            .start   ( cfu_start  ),
+            .func    ( cfu_func   ),
+            .rs1     ( cfu_rs1    ),
+            .rs2     ( cfu_rs2    ),
+            .done    ( cfu_done   ),
+            .result  ( cfu_result )
+        );
+    end else begin : gen_no_cfu
+        assign cfu_done   = in_cfu_done;
+        assign cfu_result = in_cfu_result;
+    end
+
+endmodule
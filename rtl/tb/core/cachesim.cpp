@@ -0,0 +1,321 @@
+// Offline cache simulator for the traces of `Vtop trace`, see mem_trace.h.
+// Every combination of the given sizes, ways, line sizes and prefetchers is
+// replayed against split instruction and data caches per hart, one
+// combination per worker thread, and reported as a miss rate and AMAT
+// table. Caches are LRU, write back and write allocate.
+//
+//   cachesim [-s sizes] [-w ways] [-l lines] [-p prefetchers]
+//            [-t hit cycles] [-m miss cycles] [-j threads] trace...
+//
+// Lists are comma separated. The miss latency is for the first word, every
+// further word of the line costs one more cycle. Prefetches are filled off
+// the critical path and only show up in the miss rate.
+#include "mem_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum prefetch_policy {
+    PF_NONE,
+    PF_NEXT,        // tagged next line, on a miss or the first hit to a prefetched line
+    PF_STRIDE       // the same trigger, by the stride of the last two misses
+};
+
+static const char *policy_names[] = {"none", "next", "stride"};
+
+struct cache_config {
+    uint32_t size;
+    uint32_t ways;
+    uint32_t line;
+    prefetch_policy prefetch;
+};
+
+struct cache_stats {
+    uint64_t accesses;
+    uint64_t misses;
+    uint64_t writebacks;
+    uint64_t prefetches;
+    uint64_t useful;        // prefetched lines hit before being evicted
+
+    void add(const cache_stats &o)
+    {
+        accesses += o.accesses;
+        misses += o.misses;
+        writebacks += o.writebacks;
+        prefetches += o.prefetches;
+        useful += o.useful;
+    }
+};
+
+class cache {
+public:
+    cache_stats stats = {};
+
+    explicit cache(const cache_config &cfg)
+        : cfg(cfg), sets(cfg.size / cfg.line / cfg.ways), slots(cfg.size / cfg.line)
+    {
+    }
+
+    void access(uint32_t addr, bool write)
+    {
+        uint32_t line = addr / cfg.line;
+        way *w = find(line);
+
+        stats.accesses++;
+        if (w) {
+            w->stamp = ++clock;
+            w->dirty |= write;
+            if (w->prefetched) {
+                w->prefetched = false;
+                stats.useful++;
+                prefetch(line);
+            }
+            return;
+        }
+        stats.misses++;
+        fill(line)->dirty = write;
+        if (last_miss_valid)
+            stride = (int32_t)(line - last_miss);
+        last_miss = line;
+        last_miss_valid = true;
+        prefetch(line);
+    }
+
+private:
+    struct way {
+        uint32_t line;
+        uint64_t stamp;     // 0 while the way is empty
+        bool     dirty;
+        bool     prefetched;
+    };
+
+    cache_config cfg;
+    uint32_t sets;
+    vector<way> slots;
+    uint64_t clock = 0;
+    uint32_t last_miss = 0;
+    bool last_miss_valid = false;
+    int32_t stride = 0;
+
+    way *find(uint32_t line)
+    {
+        way *set = &slots[(line % sets) * cfg.ways];
+
+        for (uint32_t i = 0; i < cfg.ways; i++) {
+            if (set[i].stamp && set[i].line == line)
+                return &set[i];
+        }
+        return nullptr;
+    }
+
+    // evict the least recently used way of the set
+    way *fill(uint32_t line)
+    {
+        way *set = &slots[(line % sets) * cfg.ways];
+        way *victim = &set[0];
+
+        for (uint32_t i = 1; i < cfg.ways; i++) {
+            if (set[i].stamp < victim->stamp)
+                victim = &set[i];
+        }
+        if (victim->stamp && victim->dirty)
+            stats.writebacks++;
+        *victim = {line, ++clock, false, false};
+        return victim;
+    }
+
+    void prefetch(uint32_t line)
+    {
+        int32_t step = cfg.prefetch == PF_NEXT ? 1 : stride;
+
+        if (cfg.prefetch == PF_NONE || step == 0 || find(line + step))
+            return;
+        fill(line + step)->prefetched = true;
+        stats.prefetches++;
+    }
+};
+
+struct run_result {
+    cache_stats inst;
+    cache_stats data;
+};
+
+static run_result simulate(const char *path, const cache_config &cfg)
+{
+    mem_trace_reader reader;
+    mem_access a;
+    vector<cache> icache(mem_trace_writer::MAX_HARTS, cache(cfg));
+    vector<cache> dcache(mem_trace_writer::MAX_HARTS, cache(cfg));
+    run_result r = {};
+
+    if (!reader.open(path))
+        return r;
+    while (reader.next(a)) {
+        if (a.kind == MEM_FETCH)
+            icache[a.hart].access(a.addr, false);
+        else
+            dcache[a.hart].access(a.addr, a.kind == MEM_STORE);
+    }
+    reader.close();
+    for (int h = 0; h < mem_trace_writer::MAX_HARTS; h++) {
+        r.inst.add(icache[h].stats);
+        r.data.add(dcache[h].stats);
+    }
+    return r;
+}
+
+static vector<uint32_t> parse_list(const char *arg)
+{
+    vector<uint32_t> values;
+    string s = arg;
+    size_t pos = 0;
+
+    while (pos <= s.size()) {
+        size_t end = s.find(',', pos);
+        if (end == string::npos)
+            end = s.size();
+        values.push_back(strtoul(s.substr(pos, end - pos).c_str(), nullptr, 0));
+        pos = end + 1;
+    }
+    return values;
+}
+
+static vector<prefetch_policy> parse_policies(const char *arg)
+{
+    vector<prefetch_policy> policies;
+    string s = arg;
+    size_t pos = 0;
+
+    while (pos <= s.size()) {
+        size_t end = s.find(',', pos);
+        if (end == string::npos)
+            end = s.size();
+        string name = s.substr(pos, end - pos);
+        for (int p = PF_NONE; p <= PF_STRIDE; p++) {
+            if (name == policy_names[p])
+                policies.push_back((prefetch_policy)p);
+        }
+        pos = end + 1;
+    }
+    return policies;
+}
+
+static bool is_pow2(uint32_t v)
+{
+    return v && !(v & (v - 1));
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: cachesim [-s sizes] [-w ways] [-l lines] [-p none,next,stride]\n"
+                    "                [-t hit cycles] [-m miss cycles] [-j threads] trace...\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    vector<uint32_t> sizes = {1024, 4096, 16384};
+    vector<uint32_t> assoc = {1, 2, 4};
+    vector<uint32_t> lines = {16, 32};
+    vector<prefetch_policy> policies = {PF_NONE, PF_NEXT, PF_STRIDE};
+    double hit_cycles = 1;
+    double miss_cycles = 10;
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    vector<const char *> traces;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+
+        if (arg[0] != '-') {
+            traces.push_back(argv[i]);
+            continue;
+        }
+        if (i + 1 == argc)
+            usage();
+        const char *value = argv[++i];
+        if (arg == "-s")
+            sizes = parse_list(value);
+        else if (arg == "-w")
+            assoc = parse_list(value);
+        else if (arg == "-l")
+            lines = parse_list(value);
+        else if (arg == "-p")
+            policies = parse_policies(value);
+        else if (arg == "-t")
+            hit_cycles = atof(value);
+        else if (arg == "-m")
+            miss_cycles = atof(value);
+        else if (arg == "-j")
+            threads = max(1, atoi(value));
+        else
+            usage();
+    }
+    if (traces.empty())
+        usage();
+
+    // geometries the set index can not be taken from the line address of
+    // are left out
+    vector<cache_config> configs;
+    for (uint32_t size : sizes) {
+        for (uint32_t ways : assoc) {
+            for (uint32_t line : lines) {
+                if (!is_pow2(line) || line < 4 || !ways || size < line * ways ||
+                    !is_pow2(size / line / ways) || size % (line * ways))
+                    continue;
+                for (prefetch_policy p : policies)
+                    configs.push_back({size, ways, line, p});
+            }
+        }
+    }
+    if (configs.empty())
+        usage();
+
+    for (const char *path : traces) {
+        mem_trace_reader check;
+        vector<run_result> results(configs.size());
+        vector<thread> workers;
+        atomic<size_t> next(0);
+
+        if (!check.open(path)) {
+            fprintf(stderr, "%s: not a memory trace\n", path);
+            return 1;
+        }
+        check.close();
+        for (unsigned t = 0; t < min<size_t>(threads, configs.size()); t++) {
+            workers.emplace_back([&](){
+                for (size_t c; (c = next++) < configs.size();)
+                    results[c] = simulate(path, configs[c]);
+            });
+        }
+        for (thread &w : workers)
+            w.join();
+
+        printf("%s\n", path);
+        printf("%8s %4s %4s %-6s %8s %8s %10s %8s %8s\n", "size", "ways", "line", "pf",
+               "I miss%", "D miss%", "writebacks", "pf use%", "AMAT");
+        for (size_t c = 0; c < configs.size(); c++) {
+            const cache_config &cfg = configs[c];
+            const run_result &r = results[c];
+            double penalty = miss_cycles + cfg.line / 4 - 1;
+            uint64_t accesses = r.inst.accesses + r.data.accesses;
+            uint64_t misses = r.inst.misses + r.data.misses;
+            uint64_t prefetches = r.inst.prefetches + r.data.prefetches;
+            uint64_t useful = r.inst.useful + r.data.useful;
+
+            printf("%8u %4u %4u %-6s %8.3f %8.3f %10lu %8.1f %8.3f\n", cfg.size, cfg.ways,
+                   cfg.line, policy_names[cfg.prefetch],
+                   r.inst.accesses ? 100.0 * r.inst.misses / r.inst.accesses : 0.0,
+                   r.data.accesses ? 100.0 * r.data.misses / r.data.accesses : 0.0,
+                   r.data.writebacks,
+                   prefetches ? 100.0 * useful / prefetches : 0.0,
+                   accesses ? hit_cycles + penalty * misses / accesses : 0.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Shared memory bridge between `Vtop cosim <name>` and a system model in
+// another process, plain C so the model can be written in anything that
+// links against it.
+//
+// The model pushes requests into one single producer, single consumer ring
+// and the simulator answers every request, in order, in the other. Both
+// sides publish a whole batch with one store to their head index, so a batch
+// costs a cache line handoff and no system call. Each index has a single
+// writer and runs freely, the slot is the index modulo COSIM_ENTRIES.
+//
+// Simulated time only moves on requests. A port A access is one cycle like
+// the testbench accessors, so a run does not depend on how fast either side
+// is scheduled.
+#define COSIM_MAGIC     0x534f4344
+#define COSIM_ENTRIES   1024
+// polls of an empty ring before giving up the cpu
+#define COSIM_SPINS     1000
+
+enum cosim_op {
+    COSIM_READ,         // port A word at addr, answered with it
+    COSIM_WRITE,        // port A write of data with the byte strobe
+    COSIM_IRQ,          // drive the ext_irq doorbell line of top.sv to data
+    COSIM_RUN,          // clock data cycles
+    COSIM_WAIT_SLEEP,   // clock until every hart sleeps in wfi, at most data
+                        // cycles, answered with the cycles it took
+    COSIM_STOP          // the simulator answers and exits
+};
+
+struct cosim_req {
+    uint32_t op;
+    uint32_t addr;      // byte address
+    uint32_t data;
+    uint32_t strobe;
+};
+
+struct cosim_resp {
+    uint32_t op;
+    uint32_t data;
+    uint64_t cycle;     // simulated cycle the request completed on
+};
+
+// the indices sit on cache lines of their own
+struct cosim_shm {
+    uint32_t magic;     // set by the simulator once the region is ready
+    uint32_t fault;     // core_fault of the model
+    uint32_t pad0[14];
+    uint32_t req_head;  // written by the model
+    uint32_t pad1[15];
+    uint32_t req_tail;  // written by the simulator
+    uint32_t pad2[15];
+    uint32_t resp_head; // written by the simulator
+    uint32_t pad3[15];
+    uint32_t resp_tail; // written by the model
+    uint32_t pad4[15];
+    struct cosim_req  req[COSIM_ENTRIES];
+    struct cosim_resp resp[COSIM_ENTRIES];
+};
+
+// Model side
+struct cosim {
+    struct cosim_shm *shm;
+    uint32_t head;      // requests pushed
+    uint32_t tail;      // answers popped
+};
+
+// Attach to the region of a running simulator, 0 on success
+static inline int cosim_open(struct cosim *c, const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    void *p;
+
+    if (fd < 0)
+        return -1;
+    p = mmap(NULL, sizeof(struct cosim_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return -1;
+    c->shm = (struct cosim_shm *) p;
+    if (__atomic_load_n(&c->shm->magic, __ATOMIC_ACQUIRE) != COSIM_MAGIC) {
+        munmap(p, sizeof(struct cosim_shm));
+        return -1;
+    }
+    c->head = c->shm->req_head;
+    c->tail = c->shm->resp_tail;
+    return 0;
+}
+
+static inline void cosim_close(struct cosim *c)
+{
+    munmap(c->shm, sizeof(struct cosim_shm));
+}
+
+// Queue a request, 0 while COSIM_ENTRIES are waiting to be popped. The
+// simulator sees it after the next cosim_submit().
+static inline int cosim_push(struct cosim *c, uint32_t op, uint32_t addr, uint32_t data,
+                             uint32_t strobe)
+{
+    struct cosim_req *r;
+
+    if (c->head - c->tail == COSIM_ENTRIES)
+        return 0;
+    r = &c->shm->req[c->head % COSIM_ENTRIES];
+    r->op = op;
+    r->addr = addr;
+    r->data = data;
+    r->strobe = strobe;
+    c->head++;
+    return 1;
+}
+
+// Publish every pushed request with one store
+static inline void cosim_submit(struct cosim *c)
+{
+    __atomic_store_n(&c->shm->req_head, c->head, __ATOMIC_RELEASE);
+}
+
+// Pop the oldest answer if there is one
+static inline int cosim_poll(struct cosim *c, struct cosim_resp *r)
+{
+    if (__atomic_load_n(&c->shm->resp_head, __ATOMIC_ACQUIRE) == c->tail)
+        return 0;
+    *r = c->shm->resp[c->tail % COSIM_ENTRIES];
+    c->tail++;
+    __atomic_store_n(&c->shm->resp_tail, c->tail, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static inline void cosim_wait(struct cosim *c, struct cosim_resp *r)
+{
+    for (unsigned spins = 0; !cosim_poll(c, r); spins++) {
+        if (spins >= COSIM_SPINS)
+            sched_yield();
+    }
+}
+
+// One request at a time, for when nothing else is outstanding
+static inline uint32_t cosim_call(struct cosim *c, uint32_t op, uint32_t addr, uint32_t data)
+{
+    struct cosim_resp r;
+
+    cosim_push(c, op, addr, data, 0xf);
+    cosim_submit(c);
+    cosim_wait(c, &r);
+    return r.data;
+}
+
+static inline uint32_t cosim_read(struct cosim *c, uint32_t addr)
+{
+    return cosim_call(c, COSIM_READ, addr, 0);
+}
+
+static inline void cosim_write(struct cosim *c, uint32_t addr, uint32_t data)
+{
+    cosim_call(c, COSIM_WRITE, addr, data);
+}
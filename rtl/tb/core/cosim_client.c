@@ -0,0 +1,49 @@
+#include "cosim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Stand-in system model for `Vtop cosim wfi <shm name>`, a separate process
+// that only knows cosim.h. Rings the doorbell of wfi.cpp with a + b requests
+// one at a time and checks the sums, then stops the simulator.
+#define REQUESTS        100
+#define WAKE_CYCLES     4
+#define SLEEP_TIMEOUT   10000
+// the simulator loads the image before it creates the region
+#define OPEN_TRIES      1000
+
+int main(int argc, char **argv)
+{
+    struct cosim c;
+    int errors = 0;
+    int tries = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <shm name>\n", argv[0]);
+        return 2;
+    }
+    while (cosim_open(&c, argv[1]) != 0) {
+        if (++tries == OPEN_TRIES) {
+            fprintf(stderr, "no simulator on %s\n", argv[1]);
+            return 2;
+        }
+        usleep(10000);
+    }
+
+    cosim_call(&c, COSIM_WAIT_SLEEP, 0, SLEEP_TIMEOUT);
+    for (uint32_t i = 0; i < REQUESTS; i++) {
+        cosim_write(&c, 0x1f000, i);
+        cosim_write(&c, 0x1f004, 2 * i);
+        cosim_call(&c, COSIM_IRQ, 0, 1);
+        cosim_call(&c, COSIM_RUN, 0, 1);
+        cosim_call(&c, COSIM_IRQ, 0, 0);
+        cosim_call(&c, COSIM_RUN, 0, WAKE_CYCLES);
+        cosim_call(&c, COSIM_WAIT_SLEEP, 0, SLEEP_TIMEOUT);
+        if (cosim_read(&c, 0x1f008) != 3 * i)
+            errors++;
+    }
+    cosim_call(&c, COSIM_STOP, 0, 0);
+    printf("%d requests, %d wrong, core fault %u\n", REQUESTS, errors, c.shm->fault);
+    cosim_close(&c);
+    return errors != 0;
+}
@@ -0,0 +1,487 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Functional model of one rv32_core hart, RV32IA plus the machine mode CSRs,
+// used to fast-forward sampled runs. It has no timing and no interrupt
+// sources, so it stops instead of executing anything whose outcome depends
+// on the rest of the system: wfi, enabling an interrupt and touching the
+// peripherals. Corner cases follow rv32_core.sv rather than the spec, e.g.
+// jalr keeps bit 0 and misaligned accesses land in the containing word.
+//
+// Mem provides load(word) and store(word, data, mask) over the ram word
+// address space of ADDR_BITS bits, addresses wrap at RAM_WORDS like on the
+// ram port.
+struct iss_state {
+    uint32_t pc;
+    uint32_t regs[32];
+    bool     mstatus_mie;
+    bool     mstatus_mpie;
+    uint32_t mie;
+    uint32_t mtvec;
+    uint32_t mscratch;
+    uint32_t mepc;
+    uint32_t mcause;
+    // without timing a cycle is an instruction
+    uint64_t cycle;
+    uint64_t instret;
+    bool     resv_valid;
+    uint32_t resv_addr;
+};
+
+enum class iss_stop {
+    count,          // ran the requested number of instructions
+    ecall,          // pc is past the ecall, the result goes in a0
+    fault,          // rv32_core would raise core_fault, pc on the culprit
+    unsupported     // needs the RTL, pc on the instruction
+};
+
+template <typename Mem, unsigned ADDR_BITS = 16>
+class iss {
+public:
+    static const uint32_t RAM_WORDS = 1u << ADDR_BITS;
+    // the 64 words of clint, dma and cfu_mmio registers below 0x40000,
+    // whatever the width
+    static const uint32_t PERIPH_WORD = 0x3ff00 >> 2;
+    static const uint32_t PERIPH_WORDS = 64;
+    // external, timer and software interrupt enables in mie
+    static const uint32_t IRQ_MASK = (1 << 11) | (1 << 7) | (1 << 3);
+
+    iss_state s;
+
+    explicit iss(Mem &mem) : mem(mem) { reset(0x10000); }
+
+    void reset(uint32_t start)
+    {
+        s = {};
+        s.pc = start;
+        block_pc = start;
+        block_len = 0;
+    }
+
+    // Continue from a state read out of the RTL
+    void load(const iss_state &state)
+    {
+        s = state;
+        s.regs[0] = 0;
+        block_pc = s.pc;
+        block_len = 0;
+    }
+
+    iss_stop run(uint64_t count)
+    {
+        return run(count, [](uint32_t, uint32_t){});
+    }
+
+    // on_block(pc, n) gets the instructions executed in the basic block
+    // starting at pc, a block that straddles the end of the run is split
+    template <typename Hook>
+    iss_stop run(uint64_t count, Hook &&on_block)
+    {
+        iss_stop stop = iss_stop::count;
+        uint64_t end = s.instret + count;
+
+        while (s.instret < end) {
+            uint32_t pc = s.pc;
+
+            stop = step();
+            if (stop == iss_stop::fault || stop == iss_stop::unsupported)
+                break;
+            block_len++;
+            if (s.pc != pc + 4 || ends_block) {
+                on_block(block_pc, block_len);
+                block_pc = s.pc;
+                block_len = 0;
+            }
+            if (stop == iss_stop::ecall)
+                break;
+            stop = iss_stop::count;
+        }
+        if (block_len) {
+            on_block(block_pc, block_len);
+            block_len = 0;
+        }
+        return stop;
+    }
+
+private:
+    Mem &mem;
+    uint32_t block_pc;
+    uint32_t block_len;
+    bool ends_block;
+
+    static uint32_t word(uint32_t addr)
+    {
+        return (addr >> 2) & (RAM_WORDS - 1);
+    }
+
+    static bool periph(uint32_t w)
+    {
+        return w - PERIPH_WORD < PERIPH_WORDS;
+    }
+
+    void set(uint32_t rd, uint32_t value)
+    {
+        if (rd)
+            s.regs[rd] = value;
+    }
+
+    void write(uint32_t addr, uint32_t data, uint32_t mask)
+    {
+        // every write on the ram port breaks a reservation, ours included
+        if (s.resv_valid && s.resv_addr == addr)
+            s.resv_valid = false;
+        mem.store(addr, data, mask);
+    }
+
+    bool csr_read(uint32_t csr, uint32_t &value, bool &writable)
+    {
+        writable = false;
+        switch (csr) {
+        case 0xc00: case 0xc01: value = s.cycle; break;
+        case 0xc80: case 0xc81: value = s.cycle >> 32; break;
+        case 0xc02: value = s.instret; break;
+        case 0xc82: value = s.instret >> 32; break;
+        case 0xf14: value = 0; break;
+        case 0x300:
+            value = (3 << 11) | (s.mstatus_mpie << 7) | (s.mstatus_mie << 3);
+            writable = true;
+            break;
+        case 0x304: value = s.mie; writable = true; break;
+        case 0x305: value = s.mtvec; writable = true; break;
+        case 0x340: value = s.mscratch; writable = true; break;
+        case 0x341: value = s.mepc; writable = true; break;
+        case 0x342: value = s.mcause; writable = true; break;
+        // nothing is ever pending here
+        case 0x344: value = 0; writable = true; break;
+        default: return false;
+        }
+        return true;
+    }
+
+    void csr_write(uint32_t csr, uint32_t value)
+    {
+        switch (csr) {
+        case 0x300:
+            s.mstatus_mie = value >> 3 & 1;
+            s.mstatus_mpie = value >> 7 & 1;
+            break;
+        case 0x304: s.mie = value & IRQ_MASK; break;
+        case 0x305: s.mtvec = value & ~3u; break;
+        case 0x340: s.mscratch = value; break;
+        case 0x341: s.mepc = value & ~3u; break;
+        case 0x342: s.mcause = value; break;
+        default: break;
+        }
+    }
+
+    iss_stop step()
+    {
+        uint32_t pc = s.pc;
+        uint32_t inst;
+        uint32_t opcode, rd, func3, rs1, rs2, func7;
+        uint32_t a, b;
+        int32_t imm_i, imm_s, imm_b, imm_j;
+        uint32_t next = pc + 4;
+
+        if (periph(word(pc)))
+            return iss_stop::unsupported;
+        inst = mem.load(word(pc));
+        opcode = inst & 0x7f;
+        rd = inst >> 7 & 0x1f;
+        func3 = inst >> 12 & 7;
+        rs1 = inst >> 15 & 0x1f;
+        rs2 = inst >> 20 & 0x1f;
+        func7 = inst >> 25;
+        a = s.regs[rs1];
+        b = s.regs[rs2];
+        imm_i = (int32_t)inst >> 20;
+        imm_s = ((int32_t)inst >> 25 << 5) | rd;
+        imm_b = ((int32_t)inst >> 31 << 12) | (inst << 4 & 0x800) |
+                (inst >> 20 & 0x7e0) | (inst >> 7 & 0x1e);
+        imm_j = ((int32_t)inst >> 31 << 20) | (inst & 0xff000) |
+                (inst >> 9 & 0x800) | (inst >> 20 & 0x7fe);
+        ends_block = false;
+
+        switch (opcode) {
+        case 0x37: // lui
+            set(rd, inst & 0xfffff000);
+            break;
+        case 0x17: // auipc
+            set(rd, pc + (inst & 0xfffff000));
+            break;
+        case 0x6f: // jal
+            set(rd, pc + 4);
+            next = pc + imm_j;
+            ends_block = true;
+            break;
+        case 0x67: // jalr
+            next = a + imm_i;
+            set(rd, pc + 4);
+            ends_block = true;
+            break;
+        case 0x63: { // branches
+            bool taken;
+
+            switch (func3) {
+            case 0: taken = a == b; break;
+            case 1: taken = a != b; break;
+            case 4: taken = (int32_t)a < (int32_t)b; break;
+            case 5: taken = (int32_t)a >= (int32_t)b; break;
+            case 6: taken = a < b; break;
+            case 7: taken = a >= b; break;
+            default: return iss_stop::fault;
+            }
+            if (taken)
+                next = pc + imm_b;
+            ends_block = true;
+            break;
+        }
+        case 0x13: // arith with immediate
+            switch (func3) {
+            case 0: set(rd, a + imm_i); break;
+            case 2: set(rd, (int32_t)a < imm_i); break;
+            case 3: set(rd, a < (uint32_t)imm_i); break;
+            case 4: set(rd, a ^ imm_i); break;
+            case 6: set(rd, a | imm_i); break;
+            case 7: set(rd, a & imm_i); break;
+            case 1:
+                if (func7 != 0)
+                    return iss_stop::fault;
+                set(rd, a << rs2);
+                break;
+            case 5:
+                if (func7 == 0)
+                    set(rd, a >> rs2);
+                else if (func7 == 0x20)
+                    set(rd, (int32_t)a >> rs2);
+                else
+                    return iss_stop::fault;
+                break;
+            }
+            break;
+        case 0x33: // arith
+            if (func7 == 0x20 && func3 == 0)
+                set(rd, a - b);
+            else if (func7 == 0x20 && func3 == 5)
+                set(rd, (int32_t)a >> (b & 0x1f));
+            else if (func7 != 0)
+                return iss_stop::fault;
+            else {
+                switch (func3) {
+                case 0: set(rd, a + b); break;
+                case 1: set(rd, a << (b & 0x1f)); break;
+                case 2: set(rd, (int32_t)a < (int32_t)b); break;
+                case 3: set(rd, a < b); break;
+                case 4: set(rd, a ^ b); break;
+                case 5: set(rd, a >> (b & 0x1f)); break;
+                case 6: set(rd, a | b); break;
+                case 7: set(rd, a & b); break;
+                }
+            }
+            break;
+        case 0x0f: // fence, memory is already ordered
+            break;
+        case 0x73:
+            if (func3 == 0) {
+                if (rs1 != 0 || rd != 0)
+                    return iss_stop::fault;
+                if (func7 == 0 && rs2 == 0) {
+                    s.pc = next;
+                    retire();
+                    return iss_stop::ecall;
+                } else if (func7 == 0 && rs2 == 1) {
+                    // ebreak does nothing on the core
+                } else if (func7 == 0x18 && rs2 == 2) {
+                    if (s.mstatus_mpie && (s.mie & IRQ_MASK))
+                        return iss_stop::unsupported;
+                    next = s.mepc;
+                    s.mstatus_mie = s.mstatus_mpie;
+                    s.mstatus_mpie = true;
+                    ends_block = true;
+                } else if (func7 == 0x08 && rs2 == 5) {
+                    return iss_stop::unsupported;
+                } else {
+                    return iss_stop::fault;
+                }
+            } else if (func3 != 4) {
+                uint32_t csr = inst >> 20;
+                uint32_t src = func3 & 4 ? rs1 : a;
+                bool wr = (func3 & 3) == 1 || rs1 != 0;
+                bool writable;
+                uint32_t old;
+
+                if (!csr_read(csr, old, writable) || (wr && !writable))
+                    return iss_stop::fault;
+                if (wr) {
+                    uint32_t value = (func3 & 3) == 1 ? src :
+                                     (func3 & 3) == 2 ? old | src : old & ~src;
+                    uint32_t mie = csr == 0x304 ? value : s.mie;
+                    bool mstatus_mie = csr == 0x300 ? value >> 3 & 1 : s.mstatus_mie;
+
+                    // from here on a timer or the host could interrupt
+                    if (mstatus_mie && (mie & IRQ_MASK))
+                        return iss_stop::unsupported;
+                    csr_write(csr, value);
+                }
+                set(rd, old);
+            } else {
+                return iss_stop::fault;
+            }
+            break;
+        case 0x03: { // loads
+            uint32_t addr = a + imm_i;
+            uint32_t shift = (addr & 3) * 8;
+            uint32_t data;
+
+            if (func3 == 3 || func3 > 5)
+                return iss_stop::fault;
+            if (periph(word(addr)))
+                return iss_stop::unsupported;
+            data = mem.load(word(addr));
+            switch (func3) {
+            case 0: set(rd, (int32_t)(data << (24 - shift)) >> 24); break;
+            case 1: set(rd, (int32_t)(data << (16 - (shift & 16))) >> 16); break;
+            case 2: set(rd, data); break;
+            case 4: set(rd, data >> shift & 0xff); break;
+            case 5: set(rd, data >> (shift & 16) & 0xffff); break;
+            }
+            break;
+        }
+        case 0x23: { // stores
+            uint32_t addr = a + imm_s;
+            uint32_t shift = (addr & 3) * 8;
+
+            if (func3 > 2)
+                return iss_stop::fault;
+            if (periph(word(addr)))
+                return iss_stop::unsupported;
+            switch (func3) {
+            case 0: write(word(addr), b << shift, 0xffu << shift); break;
+            case 1: write(word(addr), b << (shift & 16), 0xffffu << (shift & 16)); break;
+            case 2: write(word(addr), b, ~0u); break;
+            }
+            break;
+        }
+        case 0x2f: { // atomics, word only
+            uint32_t func5 = inst >> 27;
+            uint32_t addr = word(a);
+            uint32_t old, value;
+
+            if (func3 != 2)
+                return iss_stop::fault;
+            if (periph(addr))
+                return iss_stop::unsupported;
+            if (func5 == 0x02) { // lr
+                if (rs2 != 0)
+                    return iss_stop::fault;
+                set(rd, mem.load(addr));
+                s.resv_valid = true;
+                s.resv_addr = addr;
+                break;
+            }
+            if (func5 == 0x03) { // sc
+                bool pass = s.resv_valid && s.resv_addr == addr;
+
+                s.resv_valid = false;
+                if (pass)
+                    write(addr, b, ~0u);
+                set(rd, !pass);
+                break;
+            }
+            old = mem.load(addr);
+            switch (func5) {
+            case 0x00: value = old + b; break;
+            case 0x01: value = b; break;
+            case 0x04: value = old ^ b; break;
+            case 0x08: value = old | b; break;
+            case 0x0c: value = old & b; break;
+            case 0x10: value = (int32_t)old < (int32_t)b ? old : b; break;
+            case 0x14: value = (int32_t)old > (int32_t)b ? old : b; break;
+            case 0x18: value = old < b ? old : b; break;
+            case 0x1c: value = old > b ? old : b; break;
+            default: return iss_stop::fault;
+            }
+            set(rd, old);
+            write(addr, value, ~0u);
+            break;
+        }
+        default:
+            return iss_stop::fault;
+        }
+        s.pc = next;
+        retire();
+        return iss_stop::count;
+    }
+
+    void retire()
+    {
+        s.cycle++;
+        s.instret++;
+    }
+};
+
+// Encoders for the handful of instructions the restore stub needs
+static inline uint32_t rv_i(uint32_t op, uint32_t rd, uint32_t func3, uint32_t rs1, uint32_t imm)
+{
+    return imm << 20 | rs1 << 15 | func3 << 12 | rd << 7 | op;
+}
+
+static inline uint32_t rv_b(uint32_t func3, uint32_t rs1, uint32_t rs2, int32_t off)
+{
+    uint32_t o = off;
+
+    return (o >> 12 & 1) << 31 | (o >> 5 & 0x3f) << 25 | rs2 << 20 | rs1 << 15 |
+           func3 << 12 | (o >> 1 & 0xf) << 8 | (o >> 11 & 1) << 7 | 0x63;
+}
+
+static inline uint32_t rv_jal(uint32_t rd, int32_t off)
+{
+    uint32_t o = off;
+
+    return (o >> 20 & 1) << 31 | (o >> 1 & 0x3ff) << 21 | (o >> 11 & 1) << 20 |
+           (o >> 12 & 0xff) << 12 | rd << 7 | 0x6f;
+}
+
+static inline void rv_li(std::vector<uint32_t> &code, uint32_t rd, uint32_t value)
+{
+    uint32_t hi = (value + 0x800) & 0xfffff000;
+
+    code.push_back(hi | rd << 7 | 0x37);
+    code.push_back(rv_i(0x13, rd, 0, rd, (value - hi) & 0xfff));
+}
+
+// Code that puts a hart into state s, to be placed at stub with a jump to it
+// at the reset pc. The counters are not writable and stay with the caller.
+// Hart 0 runs all but the last two words, the others park in wfi at the end.
+static inline std::vector<uint32_t> iss_restore_stub(const iss_state &s, uint32_t stub,
+                                                     uint32_t reset_pc, uint32_t reset_word)
+{
+    static const uint32_t csrs[] = {0x304, 0x305, 0x340, 0x341, 0x342, 0x300};
+    uint32_t values[] = {s.mie, s.mtvec, s.mscratch, s.mepc, s.mcause,
+                         (uint32_t)s.mstatus_mpie << 7 | (uint32_t)s.mstatus_mie << 3};
+    std::vector<uint32_t> code;
+    size_t branch;
+
+    code.push_back(rv_i(0x73, 1, 2, 0, 0xf14));        // csrr x1, mhartid
+    branch = code.size();
+    code.push_back(0);
+    // put back the word the jump to here replaced
+    rv_li(code, 1, reset_word);
+    rv_li(code, 2, reset_pc);
+    code.push_back(1 << 20 | 2 << 15 | 2 << 12 | 0x23); // sw x1, 0(x2)
+    // mstatus last, it may turn interrupts on
+    for (int i = 0; i < 6; i++) {
+        rv_li(code, 1, values[i]);
+        code.push_back(rv_i(0x73, 0, 1, 1, csrs[i]));   // csrw
+    }
+    for (uint32_t r = 1; r < 32; r++)
+        rv_li(code, r, s.regs[r]);
+    code.push_back(rv_jal(0, s.pc - (stub + code.size() * 4)));
+    code[branch] = rv_b(1, 1, 0, (code.size() - branch) * 4);
+    code.push_back(0x10500073);                         // wfi
+    code.push_back(rv_jal(0, -4));
+    return code;
+}
@@ -1,22 +1,198 @@
 #include "Vtop.h"
+#include "Vtop___024root.h"
 #include "verilated.h"
 #include "verilated_vcd_c.h"
+#include "ring_host.h"
+#include "iss.h"
+#include "simpoint.h"
+#include "mem_trace.h"
+#include "cosim.h"
+#include "trace_decode.h"
+#ifdef RAM_DPI
+#include "ram_dpi.h"
+#endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <deque>
 #include <functional>
 #include <queue>
+#include <random>
 #include <system_error>
 #include <fstream>
 #include <string>
+#include <thread>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #define FG_RED "\033[31m"
 #define FG_GREEN "\033[32m"
 #define FG_RESET "\033[0m"
 
+#ifndef NUM_HARTS
+#define NUM_HARTS 1
+#endif
+
+// the DUAL_ISSUE parameter of top.sv
+#ifndef DUAL_ISSUE
+#define DUAL_ISSUE 0
+#endif
+
+// percent of the hello run that has to issue as the second instruction of
+// a pair with DUAL_ISSUE, see trace_check()
+#define DUAL_MIN_PAIRED 10
+
+// the FUSION parameter of top.sv
+#ifndef FUSION
+#define FUSION 0
+#endif
+
+// the SYNC_READ parameter of top.sv, port A answers a clock after a_addr
+#ifndef SYNC_READ
+#define SYNC_READ 0
+#endif
+
+// the BUS parameter of top.sv, 0 without a bus master
+#ifndef BUS
+#define BUS 0
+#endif
+
+// the ADDR_WIDTH parameter of top.sv, word address bits of the ram
+#ifndef ADDR_WIDTH
+#define ADDR_WIDTH 16
+#endif
+
+// SB_DEPTH of rv32_core.sv, sizes the store buffer arrays in hart_view
+#define STORE_BUFFER 4
+
+// cycles for every hart to go around the firmware loop after an input change,
+// a SYNC_READ core takes three cycles an instruction
+#define SETTLE_CYCLES (20 * NUM_HARTS * (1 + 2 * SYNC_READ))
+
+// mailbox shared with src/parallel.cpp
+#define PAR_NUM_HARTS  0x1f100
+#define PAR_TOTAL      0x1f104
+#define PAR_DONE       0x1f108
+#define PAR_ITEMS      0x1f10c
+#define PAR_WORK       0x1f200
+#define PAR_WORK_ITEMS 256
+#define PAR_ROUNDS     8
+#define PAR_TIMEOUT    200000
+// the same run behind the bus masters, up to 40 cycles a memory access
+#define BUS_PAR_TIMEOUT 4000000
+
+// mailbox shared with src/wfi.cpp, on top of the test.cpp a/b/y words
+#define WFI_TICKS       0x1f00c
+#define WFI_TICK_CYCLES 1000
+#define WFI_RUN_CYCLES  50000
+#define WFI_REQ_CYCLE   20000
+
+// mailbox and buffers shared with src/dma.cpp
+#define DMA_RESULTS     0x1f300
+#define DMA_SRC         0x30000
+#define DMA_DST_CPU     0x31000
+#define DMA_DST_DMA     0x32000
+#define DMA_DST_ODD     0x33000
+#define DMA_WORDS       1024
+#define DMA_TIMEOUT     100000
+
+// mailbox shared with src/cfu.cpp
+#define CFU_RESULTS       0x1f500
+#define CFU_OPERANDS      256
+#define CFU_TIMEOUT       200000
+#define CFU_SCALE_HARTS   0x1f514
+#define CFU_SCALE_TOTAL   0x1f518
+#define CFU_SCALE_DONE    0x1f51c
+#define CFU_SCALE_ITEMS   256
+#define CFU_SCALE_ROUNDS  8
+#define CFU_SCALE_MIX     0x9e3779b1u
+#define CFU_SCALE_TIMEOUT 400000
+
+// a + b requests through the ring of src/ring.cpp, per doorbell batch size
+#define RING_REQUESTS   4096
+#define RING_TIMEOUT    1000000
+
+// ecall proxy, call numbers from src/lib/syscalls.h
+#define SYS_READ            63
+#define SYS_WRITE           64
+#define SYS_EXIT            93
+#define SYS_CLOCK           1024
+#define SEMIHOST_TIMEOUT    100000
+#define STRBENCH_TIMEOUT    50000000
+
+// Sampled simulation, see run_sampled(). The core has no caches or
+// predictors to warm, the warmup only has to cover the handoff. The restore
+// stub takes the last kilobyte below the data section, which src/link.txt
+// keeps free.
+#define RESET_PC            0x10000
+#define SAMPLE_INTERVAL     100000
+#define SAMPLE_WARMUP       1000
+#define SAMPLE_STUB         0x1fc00
+#define SAMPLE_STUB_END     0x20000
+#define SAMPLE_MAX_CPI      20
+
+// memory traces for the offline cache simulator, see cachesim.cpp
+#define TRACE_TIMEOUT       BENCH_TIMEOUT
+
+// branch trace buffer of top.sv, 2**TRACE_LOG2 words, read back once it is
+// half full
+#define ETRACE_WORDS        (1 << 12)
+#define ETRACE_DRAIN        (ETRACE_WORDS / 2)
+
+// Fork-server fuzzing of the a/b mailbox inputs, see run_fuzz(). A child
+// runs until hart 0 went around its polling loop twice with the new input.
+#define FUZZ_A              0x1f000
+#define FUZZ_B              0x1f004
+#define FUZZ_MAP            (1 << 16)
+#define FUZZ_BOOT_TIMEOUT   10000
+#define FUZZ_MAX_CYCLES     10000
+#define FUZZ_REGRESSION     2000
+
+// batch runner defaults, see run_batch()
+#define BATCH_CYCLES        100000000
+#define BATCH_RESET_CYCLES  4
+
+// region of interest counters written by src/lib/bench.h
+#define BENCH_RESULTS       0x1f400
+#define BENCH_TIMEOUT       1000000000
+
+// request/response run against the test.cpp polling loop
+#define IDLE_REQUESTS   10
+#define IDLE_REQ_GAP    20000
+
+// Open-loop load on the test.cpp mailbox, see run_latency(). The regression
+// run offers Poisson arrivals well below what the polling loop sustains.
+#define LATENCY_REQUESTS    1000
+#define LATENCY_GAP         50
+#define LATENCY_SEED        1
+#define LATENCY_MAX_WAIT    1000
+
+// Doorbell requests to wfi.cpp from a forked process over the co-simulation
+// bridge, see run_cosim(). A request is COSIM_STEPS ring entries, the
+// doorbell takes COSIM_WAKE_CYCLES to wake the harts.
+#define COSIM_REQUESTS      1024
+#define COSIM_BATCH         32
+#define COSIM_STEPS         8
+#define COSIM_WAKE_CYCLES   4
+#define COSIM_SLEEP_TIMEOUT 10000
+
+// idle loop detection, snapshots kept per anchor pc and the longest loop
+// looked for before picking a new anchor
+#define IDLE_HISTORY    8
+#define IDLE_MAX_PERIOD 512
+
 using namespace std;
 
-queue<function<void()>> pending_ops;
+// The state of a model run is per thread, so the workers of run_batch()
+// each drive their own Vtop with the same code as everything else
+thread_local queue<function<void()>> pending_ops;
 
-char assert_msg[1024];
+thread_local char assert_msg[1024];
 
 static void _ut_assert(bool eq, const char *expr, const char *file, int lineno) {
     if (eq)
@@ -29,12 +205,212 @@ static void _ut_assert(bool eq, const char *expr, const char *file, int lineno)
 
 #define ut_assert(eq) _ut_assert(eq, #eq, __FILE__, __LINE__)
 
-VerilatedContext *ctx;
-Vtop *top;
-VerilatedVcdC *tfp;
+thread_local VerilatedContext *ctx;
+thread_local Vtop *top;
+thread_local VerilatedVcdC *tfp;
+
+thread_local uint64_t sim_cycle;
+thread_local uint64_t eval_count;
+#ifdef RAM_DPI
+// the ram_dpi instance of top, which owns its page table
+thread_local svScope ram_scope;
+#endif
+
+// Word backdoor into whichever ram model the build picked
+static uint32_t ram_peek(uint32_t addr)
+{
+#ifdef RAM_DPI
+    return ram_dpi_peek(ram_scope, addr);
+#else
+    return top->rootp->top__DOT__ram_inst__DOT__mem[addr & ((1u << ADDR_WIDTH) - 1)];
+#endif
+}
+
+static void ram_poke(uint32_t addr, uint32_t value)
+{
+#ifdef RAM_DPI
+    ram_dpi_poke(ram_scope, addr, value);
+#else
+    top->rootp->top__DOT__ram_inst__DOT__mem[addr & ((1u << ADDR_WIDTH) - 1)] = value;
+#endif
+}
+
+// Verilator keeps a word address in the narrowest type that holds it
+#if ADDR_WIDTH > 16
+typedef IData addr_data;
+#else
+typedef SData addr_data;
+#endif
+
+// Verilator flattens the generate loop in top.sv, so the per hart core
+// internals are looked up once by name and used through this table
+struct hart_view {
+    IData *pc;
+    VlUnpacked<IData, 32> *regs;
+    CData *core_hault;
+    CData *data_wr_en;
+    CData *ecall_wait;
+    IData *prev_inst;
+    IData *load_store_addr;
+    CData *amo_wr;
+    CData *resv_valid;
+    addr_data *resv_addr;
+    CData *wfi_sleep;
+    CData *mstatus_mie;
+    CData *mstatus_mpie;
+    IData *mie;
+    IData *mtvec;
+    IData *mscratch;
+    IData *mepc;
+    IData *mcause;
+    QData *rdcycle;
+    QData *rdinstret;
+    CData *sb_hold;
+    CData *sb_count;
+    CData *sb_age;
+    VlUnpacked<addr_data, STORE_BUFFER> *sb_addr;
+    VlUnpacked<IData, STORE_BUFFER> *sb_data;
+    VlUnpacked<CData, STORE_BUFFER> *sb_strobe;
+    VlUnpacked<IData, 4> *fuse_count;
+    CData *phase;
+};
+
+thread_local hart_view harts[NUM_HARTS];
+
+#define HART_SIG(h, sig) \
+    top->rootp->top__DOT__gen_hart__BRA__##h##__KET____DOT__rv32_inst__DOT__##sig
+#define BIND_HART(h) harts[h] = { \
+    &HART_SIG(h, pc), &HART_SIG(h, regs), &HART_SIG(h, core_hault), \
+    &HART_SIG(h, data_wr_en), &HART_SIG(h, ecall_wait), &HART_SIG(h, prev_inst), &HART_SIG(h, load_store_addr), \
+    &HART_SIG(h, amo_wr), &HART_SIG(h, resv_valid), &HART_SIG(h, resv_addr), \
+    &HART_SIG(h, wfi_sleep), &HART_SIG(h, mstatus_mie), \
+    &HART_SIG(h, mstatus_mpie), &HART_SIG(h, mie), &HART_SIG(h, mtvec), \
+    &HART_SIG(h, mscratch), &HART_SIG(h, mepc), &HART_SIG(h, mcause), \
+    &HART_SIG(h, rdcycle), &HART_SIG(h, rdinstret), &HART_SIG(h, sb_hold), \
+    &HART_SIG(h, sb_count), &HART_SIG(h, sb_age), &HART_SIG(h, sb_addr), \
+    &HART_SIG(h, sb_data), &HART_SIG(h, sb_strobe), &HART_SIG(h, fuse_count), \
+    &HART_SIG(h, phase) \
+}
+
+// one BIND_HART below per hart
+static_assert(NUM_HARTS >= 1 && NUM_HARTS <= 8, "bind_harts() binds up to 8 harts");
+
+static void bind_harts()
+{
+    BIND_HART(0);
+#if NUM_HARTS > 1
+    BIND_HART(1);
+#endif
+#if NUM_HARTS > 2
+    BIND_HART(2);
+#endif
+#if NUM_HARTS > 3
+    BIND_HART(3);
+#endif
+#if NUM_HARTS > 4
+    BIND_HART(4);
+#endif
+#if NUM_HARTS > 5
+    BIND_HART(5);
+#endif
+#if NUM_HARTS > 6
+    BIND_HART(6);
+#endif
+#if NUM_HARTS > 7
+    BIND_HART(7);
+#endif
+#ifdef RAM_DPI
+    Verilated::threadContextp(ctx);
+    ram_scope = svGetScopeFromName("TOP.top.ram_inst");
+#endif
+}
+
+// tear down what the thread built with new Vtop and bind_harts()
+static void delete_model()
+{
+#ifdef RAM_DPI
+    ram_dpi_release(ram_scope);
+#endif
+    delete top;
+    delete ctx;
+    top = nullptr;
+    ctx = nullptr;
+}
+
+thread_local mem_trace_writer mem_trace;
+thread_local uint64_t trace_start;
+
+// Record the accesses the coming edge performs, what the granted hart
+// drives on the shared port on a cycle it is not stalled. Writes are stores,
+// store buffer write backs included, reads are loads on core_hault cycles
+// and fetches otherwise. The peripherals are left out, they are never cached.
+static void trace_accesses()
+{
+    if (!top->reset_n)
+        return;
+    for (int h = 0; h < NUM_HARTS; h++) {
+        hart_view &hv = harts[h];
+        mem_access a;
+
+        if (!(top->rootp->top__DOT__hart_gnt >> h & 1) || *hv.wfi_sleep || *hv.ecall_wait)
+            continue;
+        // a SYNC_READ read is the address cycle, the core keeps it on the
+        // port for two more
+        if (SYNC_READ && !top->rootp->top__DOT__b_wr_en && *hv.phase != 0)
+            continue;
+        if (top->rootp->top__DOT__periph_sel)
+            continue;
+        a.addr = top->rootp->top__DOT__b_addr << 2;
+        a.cycle = sim_cycle - trace_start;
+        a.hart = h;
+        a.kind = top->rootp->top__DOT__b_wr_en ? MEM_STORE : *hv.core_hault ? MEM_LOAD : MEM_FETCH;
+        mem_trace.add(a);
+    }
+}
+
+// Branch trace of hart 0 from the trace_encoder in top.sv, next to the
+// addresses the model retires as the reference, see etrace_begin()
+struct etrace_capture {
+    bool active;
+    uint32_t read;              // buffer words read so far
+    vector<uint32_t> packets;
+    vector<uint32_t> flow;
+};
+
+thread_local etrace_capture etrace;
+
+static void etrace_drain()
+{
+    while (etrace.read != top->trace_count) {
+        top->trace_rd_addr = etrace.read % ETRACE_WORDS;
+        top->eval();
+        etrace.packets.push_back(top->trace_rd_data);
+        etrace.read++;
+    }
+}
+
+// a pair retires pc and pc + 4
+static void etrace_step(uint32_t pc, uint64_t instret)
+{
+    for (uint64_t i = 0; i < *harts[0].rdinstret - instret; i++)
+        etrace.flow.push_back(pc + 4 * i);
+    if (top->trace_count - etrace.read >= ETRACE_DRAIN)
+        etrace_drain();
+}
 
 static void eval()
 {
+    uint32_t etrace_pc = 0;
+    uint64_t etrace_instret = 0;
+
+    if (mem_trace.is_open())
+        trace_accesses();
+    if (etrace.active) {
+        etrace_pc = *harts[0].pc;
+        etrace_instret = *harts[0].rdinstret;
+    }
+    sim_cycle++;
+    eval_count++;
     top->clk = 1;
     top->eval();
     while (pending_ops.size() > 0) {
@@ -43,11 +419,62 @@ static void eval()
     }
     ctx->timeInc(1);
     top->eval();
-    tfp->dump(ctx->time());
+    if (tfp)
+        tfp->dump(ctx->time());
     top->clk = 0;
     ctx->timeInc(1);
     top->eval();
-    tfp->dump(ctx->time());
+    if (tfp)
+        tfp->dump(ctx->time());
+    if (etrace.active)
+        etrace_step(etrace_pc, etrace_instret);
+}
+
+// Finish simx.vcd, eval() dumps nothing after this
+static void vcd_close()
+{
+    if (tfp) {
+        tfp->close();
+        delete tfp;
+        tfp = nullptr;
+    }
+}
+
+// Start capturing the branch trace of the image load_file() just reset
+static void etrace_begin()
+{
+    etrace.active = true;
+    etrace.read = 0;
+    etrace.packets.clear();
+    etrace.flow.clear();
+}
+
+// Flush the encoder on a cycle hart 0 retires nothing, then decode the
+// packets against the ELF image and compare with what the model retired
+static void etrace_check(const string &elf)
+{
+    hart_view &h = harts[0];
+    trace_decoder decoder;
+    vector<uint32_t> flow;
+
+    while (!*h.wfi_sleep && !*h.ecall_wait)
+        eval();
+    top->trace_flush = 1;
+    eval();
+    top->trace_flush = 0;
+    etrace_drain();
+    etrace.active = false;
+
+    ut_assert(decoder.load_elf(elf.c_str()));
+    bool decoded = decoder.decode(etrace.packets, flow);
+    if (!decoded)
+        printf("  %s\n", decoder.error().c_str());
+    ut_assert(decoded);
+    ut_assert(flow == etrace.flow);
+    // a commit log is an address per instruction
+    printf("%s branch trace: %zu instructions in %zu words, %.3f bits per instruction, %.1f%% of a commit log\n",
+           elf.substr(elf.rfind('/') + 1).c_str(), flow.size(), etrace.packets.size(),
+           32.0 * etrace.packets.size() / flow.size(), 100.0 * etrace.packets.size() / flow.size());
 }
 
 void run_sim()
@@ -73,13 +500,16 @@ void run_sim()
     pending_ops.push([](){
         top->a_wr_en = 0;
     });
-    for (int i=0; i<10; i++) {
+    for (int i=0; i<SETTLE_CYCLES; i++) {
         eval();
     }
     pending_ops.push([](){
         top->a_addr = 0x1f008 >> 2;
     });
     eval();
+#if SYNC_READ
+    eval();
+#endif
     ut_assert(top->a_data_out == 5);
     pending_ops.push([](){
         top->a_wr_en = 1;
@@ -96,23 +526,944 @@ void run_sim()
     pending_ops.push([](){
         top->a_wr_en = 0;
     });
-    for (int i=0; i<10; i++) {
+    for (int i=0; i<SETTLE_CYCLES; i++) {
         eval();
     }
     pending_ops.push([](){
         top->a_addr = 0x1f008 >> 2;
     });
     eval();
+#if SYNC_READ
+    eval();
+#endif
     ut_assert(top->a_data_out == 0x51);
 }
 
+static void write_word(uint32_t addr, uint32_t value)
+{
+    pending_ops.push([addr, value](){
+        top->a_wr_en = 1;
+        top->a_addr = addr >> 2;
+        top->a_data_in = value;
+    });
+    eval();
+}
+
+static uint32_t read_word(uint32_t addr)
+{
+    pending_ops.push([addr](){
+        top->a_wr_en = 0;
+        top->a_addr = addr >> 2;
+    });
+    eval();
+#if SYNC_READ
+    eval();
+#endif
+    return top->a_data_out;
+}
+
+static uint32_t xorshift(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    return x ^ x << 5;
+}
+
+// Take the cores out of the reset load_file() left them in, with port A
+// done writing
+static void release_cores()
+{
+    pending_ops.push([](){
+        top->a_wr_en = 0;
+        top->reset_n = 1;
+    });
+}
+
+// Release the cores and poll the word at addr over port A until it reads
+// value, for at most timeout polls. No core may fault on the way.
+static void release_and_wait(uint32_t addr, uint32_t value, int timeout)
+{
+    int polls;
+
+    release_cores();
+    for (polls = 0; polls < timeout; polls++) {
+        if (read_word(addr) == value)
+            break;
+        ut_assert(top->core_fault == 0);
+    }
+    ut_assert(polls < timeout);
+}
+
+#if ADDR_WIDTH > 16
+// Port A and the backdoor past the peripheral window, up to the last word.
+// The sparse model only backs the pages written on the way.
+static void run_high_ram()
+{
+    uint32_t last = ((1u << ADDR_WIDTH) - 1) << 2;
+
+    for (uint32_t addr : {0x40000u, last / 2 & ~3u, last}) {
+        write_word(addr, addr ^ 0x5a5a5a5a);
+        ut_assert(read_word(addr) == (addr ^ 0x5a5a5a5a));
+        ut_assert(ram_peek(addr >> 2) == (addr ^ 0x5a5a5a5a));
+    }
+#ifdef RAM_DPI
+    ut_assert(ram_dpi_pages(ram_scope) < 256);
+#endif
+    printf("ram of %u MiB past the peripherals at 0x3ff00\n", 1u << (ADDR_WIDTH + 2 - 20));
+}
+#endif
+
+// The first harts of the image from load_file() share the work and add
+// their sums up with LR/SC, the others park
+void run_parallel(uint32_t harts, int timeout = PAR_TIMEOUT)
+{
+    uint32_t expected = 0;
+
+    // the cores are still in reset from load_file()
+    write_word(PAR_NUM_HARTS, harts);
+    write_word(PAR_TOTAL, 0);
+    write_word(PAR_DONE, 0);
+    write_word(PAR_ITEMS, 0);
+    for (uint32_t i = 0; i < PAR_WORK_ITEMS; i++) {
+        uint32_t value = i * 0x9e3779b9u;
+        write_word(PAR_WORK + i * 4, value);
+        for (int r = 0; r < PAR_ROUNDS; r++)
+            value = xorshift(value);
+        expected += value;
+    }
+    release_and_wait(PAR_DONE, harts, timeout);
+    ut_assert(read_word(PAR_TOTAL) == expected);
+    ut_assert(read_word(PAR_ITEMS) == PAR_WORK_ITEMS);
+    printf("parallel hash of %d items on %u of %d harts\n", PAR_WORK_ITEMS, harts, NUM_HARTS);
+}
+
+// Same copy done by a load/store loop and by the dma engine, plus a strided
+// gather, timed by the firmware with rdcycle
+void run_dma()
+{
+    // the cores are still in reset from load_file()
+    for (uint32_t i = 0; i < DMA_WORDS; i++)
+        write_word(DMA_SRC + i * 4, i * 0x9e3779b9u);
+    write_word(DMA_RESULTS + 12, 0);
+    release_and_wait(DMA_RESULTS + 12, 1, DMA_TIMEOUT);
+    for (uint32_t i = 0; i < DMA_WORDS; i++) {
+        ut_assert(read_word(DMA_DST_CPU + i * 4) == i * 0x9e3779b9u);
+        ut_assert(read_word(DMA_DST_DMA + i * 4) == i * 0x9e3779b9u);
+    }
+    for (uint32_t i = 0; i < DMA_WORDS / 2; i++)
+        ut_assert(read_word(DMA_DST_ODD + i * 4) == (2 * i + 1) * 0x9e3779b9u);
+
+    uint32_t cpu = read_word(DMA_RESULTS);
+    uint32_t dma = read_word(DMA_RESULTS + 4);
+    uint32_t odd = read_word(DMA_RESULTS + 8);
+    printf("copy of %d words: load/store loop %u cycles (%.2f bytes/cycle), dma %u cycles (%.2f bytes/cycle)\n",
+           DMA_WORDS, cpu, DMA_WORDS * 4.0 / cpu, dma, DMA_WORDS * 4.0 / dma);
+    printf("strided gather of %d words: dma %u cycles\n", DMA_WORDS / 2, odd);
+    ut_assert(dma < cpu);
+}
+
+// The kernel of src/cfu.cpp through the custom-0 instructions and through
+// the cfu_mmio register window, timed by the firmware with rdcycle
+void run_cfu()
+{
+    uint32_t x = 1;
+    uint32_t sum = 0;
+
+    for (int i = 0; i < CFU_OPERANDS; i++) {
+        uint32_t y = xorshift(x);
+        uint64_t product = (uint64_t)x * y;
+        uint32_t sad = 0;
+
+        for (int b = 0; b < 32; b += 8)
+            sad += abs((int)(x >> b & 0xff) - (int)(y >> b & 0xff));
+        sum += ((uint32_t)product ^ (uint32_t)(product >> 32)) + sad;
+        x = xorshift(y);
+    }
+
+    // the cores are still in reset from load_file()
+    write_word(CFU_SCALE_HARTS, 0);
+    write_word(CFU_RESULTS + 16, 0);
+    release_and_wait(CFU_RESULTS + 16, 1, CFU_TIMEOUT);
+    ut_assert(read_word(CFU_RESULTS + 8) == sum);
+    ut_assert(read_word(CFU_RESULTS + 12) == sum);
+
+    uint32_t custom = read_word(CFU_RESULTS);
+    uint32_t mmio = read_word(CFU_RESULTS + 4);
+    printf("%d x mul, mulhu, sad: custom-0 %u cycles (%.2f per op), mmio %u cycles (%.2f per op)\n",
+           CFU_OPERANDS, custom, custom / (3.0 * CFU_OPERANDS), mmio, mmio / (3.0 * CFU_OPERANDS));
+    ut_assert(custom < mmio);
+}
+
+// The multiply kernel of src/cfu.cpp on the first harts of the image from
+// load_file(). Returns the cycles from reset to the last one done.
+uint64_t run_cfu_scaling(uint32_t harts)
+{
+    uint32_t expected = 0;
+    uint64_t start;
+
+    for (uint32_t i = 0; i < CFU_SCALE_ITEMS; i++) {
+        uint32_t x = xorshift(i + 1);
+
+        for (int r = 0; r < CFU_SCALE_ROUNDS; r++) {
+            uint64_t product = (uint64_t)x * CFU_SCALE_MIX;
+            x = (uint32_t)product + (uint32_t)(product >> 32);
+        }
+        expected += x;
+    }
+
+    // the cores are still in reset from load_file()
+    write_word(CFU_SCALE_HARTS, harts);
+    write_word(CFU_SCALE_TOTAL, 0);
+    write_word(CFU_SCALE_DONE, 0);
+    start = sim_cycle;
+    release_and_wait(CFU_SCALE_DONE, harts, CFU_SCALE_TIMEOUT);
+    ut_assert(read_word(CFU_SCALE_TOTAL) == expected);
+    printf("cfu hash of %d items on %u of %d harts: %lu cycles\n",
+           CFU_SCALE_ITEMS, harts, NUM_HARTS, sim_cycle - start);
+    return sim_cycle - start;
+}
+
+// Streams requests through the ring, keeping it as full as the batch size
+// allows, and times every request from its doorbell write to the poll that
+// sees it answered
+void run_ring()
+{
+    ring_host ring(read_word, write_word);
+    vector<uint64_t> submitted(RING_REQUESTS);
+
+    // the cores are still in reset from load_file()
+    ring.reset();
+    release_cores();
+    for (uint32_t batch : {1u, 8u, 32u}) {
+        uint64_t start = sim_cycle;
+        uint64_t total_latency = 0;
+        uint64_t max_latency = 0;
+        uint32_t sent = 0;
+        uint32_t answered = 0;
+
+        while (answered < RING_REQUESTS) {
+            uint32_t n = min(batch, RING_REQUESTS - sent);
+            if (n > 0 && ring.space() >= n) {
+                for (uint32_t i = 0; i < n; i++)
+                    ring.push(sent + i, 3 * (sent + i));
+                ring.submit();
+                for (uint32_t i = 0; i < n; i++)
+                    submitted[sent + i] = sim_cycle;
+                sent += n;
+            }
+            uint32_t ready = ring.poll();
+            uint64_t now = sim_cycle;
+            for (; ready > 0; ready--) {
+                uint64_t latency = now - submitted[answered];
+                total_latency += latency;
+                max_latency = max(max_latency, latency);
+                ut_assert(ring.pop() == 4 * answered);
+                answered++;
+            }
+            ut_assert(top->core_fault == 0);
+            ut_assert(sim_cycle - start < RING_TIMEOUT);
+        }
+        uint64_t cycles = sim_cycle - start;
+        printf("ring batch %2u: %d requests in %lu cycles, %.3f requests/cycle, latency avg %.1f max %lu cycles\n",
+               batch, RING_REQUESTS, cycles, (double)RING_REQUESTS / cycles,
+               (double)total_latency / RING_REQUESTS, max_latency);
+    }
+}
+
+// Host side of the ecall proxy. Buffers are moved through the ram backdoor,
+// so a call costs the firmware only the ack round trip.
+thread_local string semihost_in;
+thread_local size_t semihost_in_pos;
+thread_local string semihost_out[3];
+thread_local string semihost_stdout;
+thread_local bool semihost_exited;
+thread_local int semihost_exit_code;
+thread_local int semihost_hold;
+// keeps repeated runs of the same image quiet
+thread_local bool semihost_mute;
+// what clock() adds to sim_cycle, the functional model of sampled runs
+// retires instructions without clocking the RTL
+thread_local uint64_t clock_skew;
+
+static uint8_t mem_byte(uint32_t addr)
+{
+    return ram_peek(addr >> 2) >> ((addr & 3) * 8);
+}
+
+static void set_mem_byte(uint32_t addr, uint8_t value)
+{
+    uint32_t word = ram_peek(addr >> 2);
+    int shift = (addr & 3) * 8;
+
+    ram_poke(addr >> 2, (word & ~(0xffu << shift)) | ((uint32_t)value << shift));
+}
+
+static void semihost_flush(int fd)
+{
+    if (!semihost_mute)
+        fwrite(semihost_out[fd].data(), 1, semihost_out[fd].size(), fd == 2 ? stderr : stdout);
+    if (fd == 1)
+        semihost_stdout += semihost_out[fd];
+    semihost_out[fd].clear();
+}
+
+static void semihost_reset(string input)
+{
+    semihost_in = input;
+    semihost_in_pos = 0;
+    semihost_stdout.clear();
+    semihost_exited = false;
+    semihost_exit_code = 0;
+    semihost_hold = 0;
+    semihost_mute = false;
+    clock_skew = 0;
+}
+
+static uint32_t semihost_call(uint32_t n, uint32_t a0, uint32_t a1, uint32_t a2)
+{
+    switch (n) {
+    case SYS_WRITE:
+        if (a0 != 1 && a0 != 2)
+            return -EBADF;
+        // line buffered like a terminal
+        for (uint32_t i = 0; i < a2; i++) {
+            char c = mem_byte(a1 + i);
+            semihost_out[a0] += c;
+            if (c == '\n')
+                semihost_flush(a0);
+        }
+        return a2;
+    case SYS_READ: {
+        if (a0 != 0)
+            return -EBADF;
+        uint32_t len = min((size_t)a2, semihost_in.size() - semihost_in_pos);
+        for (uint32_t i = 0; i < len; i++)
+            set_mem_byte(a1 + i, semihost_in[semihost_in_pos++]);
+        return len;
+    }
+    case SYS_EXIT:
+        semihost_flush(1);
+        semihost_flush(2);
+        semihost_exited = true;
+        semihost_exit_code = a0;
+        return 0;
+    case SYS_CLOCK:
+        return sim_cycle + clock_skew;
+    default:
+        return -ENOSYS;
+    }
+}
+
+// Called after every clock. The ack is raised for exactly one posedge and
+// the hart drops its request on that same edge.
+static void semihost_step()
+{
+    if (semihost_hold > 0) {
+        if (--semihost_hold == 1) {
+            pending_ops.push([](){
+                top->ecall_ack = 0;
+            });
+        }
+        return;
+    }
+    for (int h = 0; h < NUM_HARTS; h++) {
+        if (!(top->ecall_req & (1 << h)))
+            continue;
+        VlUnpacked<IData, 32> &regs = *harts[h].regs;
+        uint32_t ret = semihost_call(regs[17], regs[10], regs[11], regs[12]);
+        // exit is never acked, the hart stays parked
+        if (semihost_exited)
+            return;
+        pending_ops.push([h, ret](){
+            top->ecall_ack = 1 << h;
+            top->ecall_ret = ret;
+        });
+        semihost_hold = 2;
+        return;
+    }
+}
+
+// Run the loaded image until it calls exit, returns the cycles it took
+static uint64_t run_to_exit(uint64_t timeout)
+{
+    uint64_t start = sim_cycle;
+
+    release_cores();
+    while (!semihost_exited) {
+        eval();
+        ut_assert(top->core_fault == 0);
+        ut_assert(sim_cycle - start < timeout);
+        semihost_step();
+    }
+    return sim_cycle - start;
+}
+
+void run_semihost()
+{
+    semihost_reset("dabble\n");
+    uint64_t cycles = run_to_exit(SEMIHOST_TIMEOUT);
+    ut_assert(semihost_exit_code == 0);
+    ut_assert(semihost_stdout.rfind("hello from the dabble core\nDABBLE\ncycles: ", 0) == 0);
+    printf("semihosted hello exited with %d after %lu cycles\n", semihost_exit_code, cycles);
+}
+
+// cycles per byte strbench reported for one function and variant
+static double strbench_rate(const string &name)
+{
+    size_t pos = semihost_stdout.find(name);
+
+    ut_assert(pos != string::npos);
+    return strtod(semihost_stdout.c_str() + pos + name.size(), nullptr);
+}
+
+// lib/string.S against byte loops, the firmware checks and times both and
+// exits with the number of mismatches, returns the CPI of the whole run.
+// The word wide memset and memcpy have to stay ahead of the byte loops,
+// which the store buffer merges into word writes.
+double run_strbench()
+{
+    semihost_reset("");
+    uint64_t cycles = run_to_exit(STRBENCH_TIMEOUT);
+    ut_assert(semihost_exit_code == 0);
+    printf("string benchmark exited after %lu cycles\n", cycles);
+
+    double memset_word = strbench_rate("word memset aligned");
+    double memset_byte = strbench_rate("byte memset aligned");
+    double memcpy_word = strbench_rate("word memcpy aligned");
+    double memcpy_byte = strbench_rate("byte memcpy aligned");
+    printf("memset %.2f cycles/byte (bytes %.2f), memcpy %.2f cycles/byte (bytes %.2f)\n",
+           memset_word, memset_byte, memcpy_word, memcpy_byte);
+    ut_assert(memset_word > 0 && memset_word < memset_byte);
+    ut_assert(memcpy_word > 0 && memcpy_word < memcpy_byte);
+#if DUAL_ISSUE
+    printf("string benchmark IPC %.3f\n", (double)*harts[0].rdinstret / cycles);
+#endif
+    return (double)cycles / *harts[0].rdinstret;
+}
+
+// Cycles until the earliest timer compare of any hart hits, the only thing
+// besides host stimulus that can wake a parked core
+static uint64_t next_timer_event()
+{
+    uint64_t mtime = top->rootp->top__DOT__clint_inst__DOT__mtime;
+    uint64_t next = UINT64_MAX;
+
+    for (int h = 0; h < NUM_HARTS; h++) {
+        uint64_t cmp = top->rootp->top__DOT__clint_inst__DOT__mtimecmp[h];
+        if (cmp > mtime && cmp - mtime < next)
+            next = cmp - mtime;
+    }
+    return next;
+}
+
+// Advance 1 + n cycles in a single clock. Only valid while every hart is
+// parked in wfi, then nothing but the counters can tell the difference.
+static void eval_skip(uint32_t n)
+{
+    top->time_skip = n;
+    pending_ops.push([](){
+        top->time_skip = 0;
+    });
+    eval();
+    ctx->timeInc(2 * (uint64_t)n);
+    sim_cycle += n;
+}
+
+// A hart spinning on its inputs comes back to the same pc with the same
+// architectural state. Once the state of every hart repeats with no memory
+// change in between, only the counters move until the host pokes the system
+// again, so whole loop periods can be skipped in a single clock.
+struct idle_point {
+    vector<uint32_t> state;
+    uint64_t cycle;
+    uint64_t instret[NUM_HARTS];
+};
+
+thread_local deque<idle_point> idle_history;
+thread_local uint32_t idle_anchor_pc;
+thread_local uint64_t idle_anchor_cycle;
+thread_local uint64_t idle_dirty_cycle;
+
+static void idle_snapshot(vector<uint32_t> &state)
+{
+    state.clear();
+    for (int h = 0; h < NUM_HARTS; h++) {
+        hart_view &hv = harts[h];
+        state.push_back(*hv.pc);
+        for (int r = 1; r < 32; r++)
+            state.push_back((*hv.regs)[r]);
+        state.push_back(*hv.core_hault);
+        state.push_back(*hv.prev_inst);
+        state.push_back(*hv.load_store_addr);
+        state.push_back(*hv.amo_wr);
+        state.push_back(*hv.resv_valid);
+        state.push_back(*hv.resv_addr);
+        state.push_back(*hv.wfi_sleep);
+        state.push_back(*hv.mstatus_mie);
+        state.push_back(*hv.mstatus_mpie);
+        state.push_back(*hv.mie);
+        state.push_back(*hv.mtvec);
+        state.push_back(*hv.mscratch);
+        state.push_back(*hv.mepc);
+        state.push_back(*hv.mcause);
+        state.push_back(*hv.sb_hold);
+        state.push_back(*hv.sb_count);
+        state.push_back(*hv.sb_age);
+        state.push_back(*hv.phase);
+        for (int i = 0; i < *hv.sb_count; i++) {
+            state.push_back((*hv.sb_addr)[i]);
+            state.push_back((*hv.sb_data)[i]);
+            state.push_back((*hv.sb_strobe)[i]);
+        }
+        state.push_back(top->rootp->top__DOT__clint_inst__DOT__mtimecmp[h]);
+        state.push_back(top->rootp->top__DOT__clint_inst__DOT__mtimecmp[h] >> 32);
+    }
+    state.push_back(top->rootp->top__DOT__arbiter_inst__DOT__last);
+    state.push_back(top->rootp->top__DOT__arbiter_inst__DOT__locked);
+    state.push_back(top->rootp->top__DOT__clint_inst__DOT__msip);
+    state.push_back(top->rootp->top__DOT__clint_inst__DOT__doorbell);
+    // a running transfer counts down, so an idle system has it stopped
+    state.push_back(top->rootp->top__DOT__dma_inst__DOT__busy);
+    state.push_back(top->rootp->top__DOT__dma_inst__DOT__done);
+    state.push_back(top->rootp->top__DOT__dma_inst__DOT__irq_en);
+    state.push_back(top->rootp->top__DOT__dma_inst__DOT__remaining);
+}
+
+static void idle_reset()
+{
+    idle_history.clear();
+    idle_anchor_pc = *harts[0].pc;
+    idle_anchor_cycle = sim_cycle;
+    idle_dirty_cycle = sim_cycle;
+}
+
+// Note a write landing on the next clock that changes memory. Rewriting the
+// value already there, like test.cpp does with y, keeps the loop idle.
+static void idle_track_writes()
+{
+    uint32_t mask = 0;
+    uint32_t addr = top->rootp->top__DOT__b_addr;
+    uint32_t data = top->rootp->top__DOT__b_data_in;
+    uint32_t old;
+
+    if (!top->rootp->top__DOT__b_wr_en)
+        return;
+    if (top->rootp->top__DOT__periph_sel) {
+        idle_dirty_cycle = sim_cycle;
+        return;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (top->rootp->top__DOT__b_wr_strobe & (1 << i))
+            mask |= 0xffu << (i * 8);
+    }
+    old = ram_peek(addr);
+    if (((data & mask) | (old & ~mask)) != old)
+        idle_dirty_cycle = sim_cycle;
+}
+
+// Called after every clock, skips ahead when the current state repeats an
+// earlier one without landing past target
+static void idle_check(uint64_t target)
+{
+    hart_view &h0 = harts[0];
+
+    if (*h0.pc != idle_anchor_pc && sim_cycle - idle_anchor_cycle > IDLE_MAX_PERIOD) {
+        idle_history.clear();
+        idle_anchor_pc = *h0.pc;
+    }
+    // a SYNC_READ instruction keeps its pc for three cycles, only the
+    // address cycle is a point of the loop. The read registers of the ram
+    // and of rs1_q and rs2_q are loaded again before they are used, so
+    // they are not state there.
+    if (*h0.pc == idle_anchor_pc && *h0.phase == 0) {
+        idle_point point;
+
+        idle_snapshot(point.state);
+        point.cycle = sim_cycle;
+        for (int h = 0; h < NUM_HARTS; h++)
+            point.instret[h] = *harts[h].rdinstret;
+        idle_anchor_cycle = sim_cycle;
+
+        for (const idle_point &prev : idle_history) {
+            if (prev.cycle <= idle_dirty_cycle || prev.state != point.state)
+                continue;
+
+            // the skip clock runs one real cycle on top of whole periods,
+            // and must not let a timer compare hit inside the skipped time
+            uint64_t period = sim_cycle - prev.cycle;
+            uint64_t room = sim_cycle < target ? min(target - sim_cycle - 1, next_timer_event() - 1) : 0;
+            uint64_t periods = min(room, (uint64_t)UINT32_MAX) / period;
+            if (periods == 0)
+                break;
+
+            for (int h = 0; h < NUM_HARTS; h++)
+                *harts[h].rdinstret += periods * (point.instret[h] - prev.instret[h]);
+            eval_skip(periods * period);
+            idle_reset();
+            return;
+        }
+        idle_history.push_back(point);
+        if (idle_history.size() > IDLE_HISTORY)
+            idle_history.pop_front();
+    }
+    idle_track_writes();
+}
+
+// Run to the absolute cycle target, optionally skipping idle loop periods
+static void run_until(uint64_t target, bool fast_forward)
+{
+    pending_ops.push([](){
+        top->a_wr_en = 0;
+    });
+    idle_reset();
+    while (sim_cycle < target) {
+        eval();
+        ut_assert(top->core_fault == 0);
+        if (fast_forward)
+            idle_check(target);
+    }
+}
+
+uint32_t run_wfi(bool fast_forward)
+{
+    uint64_t cycle = 0;
+    uint64_t evaluated = 0;
+    uint32_t ticks;
+
+    write_word(WFI_TICKS, 0);
+    write_word(0x1f008, 0);
+    release_cores();
+    while (cycle < WFI_RUN_CYCLES) {
+        if (cycle == WFI_REQ_CYCLE) {
+            write_word(0x1f000, 0x7);
+            write_word(0x1f004, 0x9);
+            pending_ops.push([](){
+                top->a_wr_en = 0;
+                top->ext_irq = 1;
+            });
+            eval();
+            pending_ops.push([](){
+                top->ext_irq = 0;
+            });
+            eval();
+            cycle += 4;
+            evaluated += 4;
+            continue;
+        }
+        if (fast_forward && top->core_sleep) {
+            uint64_t stimulus = (cycle < WFI_REQ_CYCLE ? WFI_REQ_CYCLE : WFI_RUN_CYCLES) - cycle;
+            uint64_t idle = min(next_timer_event(), stimulus);
+            if (idle > 1) {
+                eval_skip(idle - 1);
+                cycle += idle;
+                evaluated++;
+                continue;
+            }
+        }
+        eval();
+        cycle++;
+        evaluated++;
+        ut_assert(top->core_fault == 0);
+    }
+    ut_assert(read_word(0x1f008) == 0x10);
+    ticks = read_word(WFI_TICKS);
+    ut_assert(ticks >= NUM_HARTS * (WFI_RUN_CYCLES / WFI_TICK_CYCLES - 1));
+    printf("wfi%s: %lu cycles simulated, %lu evaluated, %u timer ticks\n",
+           fast_forward ? " with fast-forward" : "", cycle, evaluated, ticks);
+    return ticks;
+}
+
+struct idle_result {
+    uint64_t rdcycle;
+    uint64_t rdinstret;
+    uint32_t y;
+};
+
+// Spaced out a + b requests to test.cpp, the firmware polls in between
+idle_result run_idle_requests(bool fast_forward)
+{
+    uint64_t first_cycle = sim_cycle;
+    uint64_t first_eval = eval_count;
+    auto start = chrono::steady_clock::now();
+    idle_result res;
+
+    pending_ops.push([](){
+        top->reset_n = 1;
+    });
+    eval();
+    for (uint32_t r = 0; r < IDLE_REQUESTS; r++) {
+        write_word(0x1f000, 3 * r + 1);
+        write_word(0x1f004, 7 * r + 2);
+        run_until(sim_cycle + IDLE_REQ_GAP, fast_forward);
+        res.y = read_word(0x1f008);
+        ut_assert(res.y == 10 * r + 3);
+    }
+    res.rdcycle = *harts[0].rdcycle;
+    res.rdinstret = *harts[0].rdinstret;
+
+    chrono::duration<double> wall = chrono::steady_clock::now() - start;
+    printf("%d requests%s: %lu cycles simulated, %lu evaluated, %.3fs\n",
+           IDLE_REQUESTS, fast_forward ? " with fast-forward" : "",
+           sim_cycle - first_cycle, eval_count - first_eval, wall.count());
+    return res;
+}
+
+struct latency_result {
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+    double throughput;      // answered requests per 1000 cycles
+};
+
+// nearest rank of an ascending list
+static uint64_t percentile(const vector<uint64_t> &sorted, double p)
+{
+    size_t rank = (size_t)ceil(p / 100 * sorted.size());
+
+    return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+}
+
+// Open-loop a + b requests to test.cpp. Arrivals follow a schedule fixed up
+// front, every gap cycles or Poisson with that mean, whether or not the
+// earlier requests were answered. Latency runs from the scheduled arrival,
+// so the time a request waits behind a slow answer counts against it
+// instead of delaying the next arrival. The mailbox holds one request, the
+// ones that arrived meanwhile wait on the host. A request is answered on the
+// first poll of y that reads its sum, every request has a different a, b
+// and sum so a half written pair never matches.
+latency_result run_latency(uint32_t requests, double gap, bool poisson)
+{
+    mt19937_64 rng(LATENCY_SEED);
+    exponential_distribution<double> next_gap(1.0 / gap);
+    vector<uint64_t> arrival(requests);
+    vector<uint64_t> latency;
+    uint32_t next = 0;
+    bool in_flight = false;
+    double t = 0;
+
+    release_cores();
+    eval();
+    uint64_t start = sim_cycle;
+    for (uint32_t r = 0; r < requests; r++) {
+        t += poisson ? next_gap(rng) : gap;
+        arrival[r] = start + (uint64_t)t;
+    }
+    uint64_t timeout = arrival.back() + (uint64_t)requests * LATENCY_MAX_WAIT;
+
+    while (next < requests) {
+        if (in_flight) {
+            if (read_word(0x1f008) == 10 * next + 3) {
+                latency.push_back(sim_cycle - arrival[next]);
+                next++;
+                in_flight = false;
+            }
+        } else if (sim_cycle >= arrival[next]) {
+            write_word(0x1f000, 3 * next + 1);
+            write_word(0x1f004, 7 * next + 2);
+            in_flight = true;
+        } else {
+            eval();
+        }
+        ut_assert(top->core_fault == 0);
+        ut_assert(sim_cycle < timeout);
+    }
+
+    latency_result res;
+    sort(latency.begin(), latency.end());
+    res.p50 = percentile(latency, 50);
+    res.p99 = percentile(latency, 99);
+    res.max = latency.back();
+    res.throughput = 1000.0 * requests / (sim_cycle - start);
+    printf("%u %s requests, offered %.2f/kcycle: latency p50 %lu p99 %lu max %lu cycles, %.2f requests/kcycle\n",
+           requests, poisson ? "poisson" : "fixed", 1000.0 / gap, res.p50, res.p99, res.max, res.throughput);
+    return res;
+}
+
+// Region of the co-simulation bridge, see cosim.h. The model side can attach
+// once the magic is set.
+static cosim_shm *cosim_create(const string &name)
+{
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    ut_assert(fd >= 0);
+    ut_assert(ftruncate(fd, sizeof(cosim_shm)) == 0);
+    void *p = mmap(nullptr, sizeof(cosim_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ut_assert(p != MAP_FAILED);
+    cosim_shm *shm = (cosim_shm *)p;
+    __atomic_store_n(&shm->magic, COSIM_MAGIC, __ATOMIC_RELEASE);
+    return shm;
+}
+
+static void cosim_destroy(cosim_shm *shm, const string &name)
+{
+    munmap(shm, sizeof(cosim_shm));
+    shm_unlink(name.c_str());
+}
+
+// Apply one request to the model. Port A writes land on the next cycle like
+// write_word(), the strobe is back to all bytes after them.
+static cosim_resp cosim_apply(const cosim_req &req, bool &stop)
+{
+    cosim_resp resp = {req.op, 0, 0};
+    uint64_t start = sim_cycle;
+
+    switch (req.op) {
+    case COSIM_READ:
+        resp.data = read_word(req.addr);
+        break;
+    case COSIM_WRITE:
+        pending_ops.push([req](){
+            top->a_wr_en = 1;
+            top->a_wr_strobe = req.strobe;
+            top->a_addr = req.addr >> 2;
+            top->a_data_in = req.data;
+        });
+        eval();
+        pending_ops.push([](){
+            top->a_wr_en = 0;
+            top->a_wr_strobe = 0xf;
+        });
+        break;
+    case COSIM_IRQ:
+        pending_ops.push([level = req.data != 0](){
+            top->ext_irq = level;
+        });
+        break;
+    case COSIM_RUN:
+        for (uint32_t i = 0; i < req.data; i++)
+            eval();
+        break;
+    case COSIM_WAIT_SLEEP:
+        while (!top->core_sleep && sim_cycle - start < req.data)
+            eval();
+        resp.data = sim_cycle - start;
+        break;
+    case COSIM_STOP:
+        stop = true;
+        break;
+    default:
+        ut_assert(false);
+    }
+    ut_assert(top->core_fault == 0);
+    resp.cycle = sim_cycle;
+    return resp;
+}
+
+// Answer requests until COSIM_STOP. Everything the model has submitted is
+// taken as one batch and its answers are published together. Model time
+// stands still while the ring is empty. A client process that is given has
+// to stay alive until it sends the stop.
+static void cosim_serve(cosim_shm *shm, pid_t client)
+{
+    uint32_t tail = shm->req_tail;
+    uint32_t head = shm->resp_head;
+    unsigned spins = 0;
+    bool stop = false;
+
+    release_cores();
+    while (!stop) {
+        uint32_t avail = __atomic_load_n(&shm->req_head, __ATOMIC_ACQUIRE);
+        uint32_t room = COSIM_ENTRIES - (head - __atomic_load_n(&shm->resp_tail, __ATOMIC_ACQUIRE));
+
+        if (avail == tail || room == 0) {
+            if (++spins >= COSIM_SPINS) {
+                sched_yield();
+                ut_assert(client == 0 || waitpid(client, nullptr, WNOHANG) == 0);
+            }
+            continue;
+        }
+        spins = 0;
+        for (; tail != avail && room > 0 && !stop; room--) {
+            shm->resp[head % COSIM_ENTRIES] = cosim_apply(shm->req[tail % COSIM_ENTRIES], stop);
+            tail++;
+            head++;
+        }
+        __atomic_store_n(&shm->fault, top->core_fault, __ATOMIC_RELAXED);
+        __atomic_store_n(&shm->req_tail, tail, __ATOMIC_RELEASE);
+        __atomic_store_n(&shm->resp_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+// The system model of run_cosim(), only through the C API. Each request
+// rings the doorbell of wfi.cpp and reads the sum once the harts are back
+// asleep. Exits non-zero on a wrong sum.
+static int cosim_client(const string &name)
+{
+    struct cosim c;
+    struct cosim_resp r;
+    int errors = 0;
+
+    if (cosim_open(&c, name.c_str()) != 0)
+        return 2;
+    // boot to the first wfi
+    cosim_call(&c, COSIM_WAIT_SLEEP, 0, COSIM_SLEEP_TIMEOUT);
+    for (uint32_t n = 0; n < COSIM_REQUESTS; n += COSIM_BATCH) {
+        for (uint32_t i = n; i < n + COSIM_BATCH; i++) {
+            cosim_push(&c, COSIM_WRITE, 0x1f000, 3 * i + 1, 0xf);
+            cosim_push(&c, COSIM_WRITE, 0x1f004, 7 * i + 2, 0xf);
+            cosim_push(&c, COSIM_IRQ, 0, 1, 0);
+            cosim_push(&c, COSIM_RUN, 0, 1, 0);
+            cosim_push(&c, COSIM_IRQ, 0, 0, 0);
+            cosim_push(&c, COSIM_RUN, 0, COSIM_WAKE_CYCLES, 0);
+            cosim_push(&c, COSIM_WAIT_SLEEP, 0, COSIM_SLEEP_TIMEOUT, 0);
+            cosim_push(&c, COSIM_READ, 0x1f008, 0, 0);
+        }
+        cosim_submit(&c);
+        for (uint32_t i = n; i < n + COSIM_BATCH; i++) {
+            for (int step = 0; step < COSIM_STEPS; step++) {
+                cosim_wait(&c, &r);
+                if (r.op == COSIM_WAIT_SLEEP && r.data >= COSIM_SLEEP_TIMEOUT)
+                    errors++;
+            }
+            if (r.data != 10 * i + 3)
+                errors++;
+        }
+    }
+    cosim_call(&c, COSIM_STOP, 0, 0);
+    cosim_close(&c);
+    return errors != 0;
+}
+
+// The bridge end to end, with a forked process as the system model
+void run_cosim()
+{
+    string name = "/dabble-cosim-" + to_string(getpid());
+    cosim_shm *shm = cosim_create(name);
+    uint64_t first_cycle = sim_cycle;
+    int status;
+
+    // the child inherits stdio buffers, nothing may be pending
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    ut_assert(pid >= 0);
+    if (pid == 0)
+        _exit(cosim_client(name));
+
+    auto begin = chrono::steady_clock::now();
+    cosim_serve(shm, pid);
+    chrono::duration<double> wall = chrono::steady_clock::now() - begin;
+    uint32_t transactions = shm->resp_head;
+    cosim_destroy(shm, name);
+    ut_assert(waitpid(pid, &status, 0) == pid);
+    ut_assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    printf("cosim: %u requests, %u transactions in batches of %u, %lu cycles, %.0f transactions/s\n",
+           COSIM_REQUESTS, transactions, COSIM_BATCH * COSIM_STEPS, sim_cycle - first_cycle,
+           transactions / wall.count());
+}
+
 void load_file(string f_name) {
     string line;
     ifstream infile;
     infile.open(f_name, ios::in);
+    ut_assert(infile.is_open());
     pending_ops.push([](){
         top->a_wr_en = 0;
         top->a_wr_strobe = 0xf;
+        top->ext_irq = 0;
+        top->time_skip = 0;
+        top->ecall_ack = 0;
+        top->trace_flush = 0;
         top->reset_n = 0;
     });
     eval();
@@ -133,30 +1484,1135 @@ void load_file(string f_name) {
     });
     eval();
 }
+
+struct bench_result {
+    uint64_t cycles;
+    uint64_t instret;
+    uint64_t total;
+};
+
+// Run one image from src/build/bench/ to exit, the counters of its timed
+// region and the cycles of the whole run
+static bench_result bench_run(const string &name)
+{
+    bench_result r;
+
+    load_file("../../../src/build/bench/" + name + ".dhex");
+    write_word(BENCH_RESULTS + 16, 0);
+    semihost_reset("");
+    r.total = run_to_exit(BENCH_TIMEOUT);
+    ut_assert(semihost_exit_code == 0);
+    // CoreMark reports failed self checks but still returns 0
+    ut_assert(semihost_stdout.find("Errors detected") == string::npos);
+    ut_assert(read_word(BENCH_RESULTS + 16) == 1);
+
+    r.cycles = read_word(BENCH_RESULTS) | (uint64_t)read_word(BENCH_RESULTS + 4) << 32;
+    r.instret = read_word(BENCH_RESULTS + 8) | (uint64_t)read_word(BENCH_RESULTS + 12) << 32;
+    return r;
+}
+
+static void run_bench(const string &name)
+{
+    bench_result r = bench_run(name);
+    uint64_t total = r.total;
+
+    printf("%-12s %14lu %14lu %8.3f %8.3f %14lu\n", name.c_str(), r.cycles, r.instret,
+           (double)r.cycles / r.instret, (double)r.instret / r.cycles, total);
+#if FUSION
+    // every fused pair is a cycle the separate instructions would have taken
+    VlUnpacked<IData, 4> &fused = *harts[0].fuse_count;
+    uint64_t saved = (uint64_t)fused[0] + fused[1] + fused[2] + fused[3];
+    printf("%-12s lui+addi %u, auipc+jalr %u, shifts %u, addi+branch %u, %lu cycles saved (%.2f%%)\n",
+           "  fused", fused[0], fused[1], fused[2], fused[3], saved, 100.0 * saved / (total + saved));
+#endif
+}
+
+static void run_benchmarks(int count, const char **names)
+{
+    printf("%-12s %14s %14s %8s %8s %14s\n", "benchmark", "cycles", "instret", "CPI", "IPC",
+           "total cycles");
+    for (int i = 0; i < count; i++) {
+        // plusargs are for the model, like +ram_image with RAM=sparse
+        if (names[i][0] != '+')
+            run_bench(names[i]);
+    }
+}
+
+// The same images once per latency range of the BUS memories, given as
+// min:max[,min:max...] cycles on top of the bus round trip, see bus_delay
+static void run_bus_latencies(const string &ranges, int count, const char **names)
+{
+    vector<pair<unsigned, unsigned>> lat;
+    size_t pos = 0;
+
+    ut_assert(BUS != 0);
+    while (pos < ranges.size()) {
+        unsigned lo, hi;
+        ut_assert(sscanf(ranges.c_str() + pos, "%u:%u", &lo, &hi) == 2);
+        ut_assert(lo <= hi && hi < 256);
+        lat.push_back({lo, hi});
+        pos = ranges.find(',', pos);
+        if (pos == string::npos)
+            break;
+        pos++;
+    }
+    printf("%-12s %9s %14s %14s %8s %8s\n", "benchmark", "latency", "cycles", "instret", "CPI", "IPC");
+    for (int i = 0; i < count; i++) {
+        if (names[i][0] == '+')
+            continue;
+        for (auto [lo, hi] : lat) {
+            top->bus_lat_min = lo;
+            top->bus_lat_max = hi;
+            bench_result r = bench_run(names[i]);
+            string range = to_string(lo) + ":" + to_string(hi);
+            printf("%-12s %9s %14lu %14lu %8.3f %8.3f\n", names[i], range.c_str(), r.cycles, r.instret,
+                   (double)r.cycles / r.instret, (double)r.instret / r.cycles);
+        }
+    }
+    top->bus_lat_min = 0;
+    top->bus_lat_max = 0;
+}
+
+#if BUS
+// run_parallel() behind the bus masters, once per latency range of the BUS
+// memories. An AMO or SC whose lock does not hold the ram across its read
+// and write loses an update, so the counts only come out exact if it does.
+static void run_bus_atomics()
+{
+    vector<pair<unsigned, unsigned>> lat = {{0, 0}, {0, 6}, {3, 40}, {10, 10}};
+
+    for (auto [lo, hi] : lat) {
+        load_file("../../../src/build/parallel.dhex");
+        top->bus_lat_min = lo;
+        top->bus_lat_max = hi;
+        printf("bus latency %u:%u: ", lo, hi);
+        run_parallel(NUM_HARTS, BUS_PAR_TIMEOUT);
+    }
+    top->bus_lat_min = 0;
+    top->bus_lat_max = 0;
+}
+#endif
+
+// The functional model works on the ram of the Verilated model, so handing
+// over between the two never copies memory
+struct tb_ram {
+    uint32_t load(uint32_t addr)
+    {
+        return ram_peek(addr);
+    }
+
+    void store(uint32_t addr, uint32_t data, uint32_t mask)
+    {
+        ram_poke(addr, (data & mask) | (ram_peek(addr) & ~mask));
+    }
+};
+
+typedef iss<tb_ram, ADDR_WIDTH> sample_model;
+
+// Service what stopped the functional model, anything but an ecall needs
+// the rest of the system and sampled runs do not support it
+static void sample_service(sample_model &model, iss_stop stop)
+{
+    ut_assert(stop != iss_stop::fault);
+    ut_assert(stop != iss_stop::unsupported);
+    if (stop == iss_stop::ecall) {
+        uint32_t *regs = model.s.regs;
+
+        clock_skew = model.s.cycle - sim_cycle;
+        uint32_t ret = semihost_call(regs[17], regs[10], regs[11], regs[12]);
+        if (!semihost_exited)
+            regs[10] = ret;
+    }
+}
+
+// Hart 0 takes over from the functional model. The reset pc jumps to a stub
+// that loads the registers and CSRs, the counters are set once it is done.
+static void sample_to_rtl(sample_model &model)
+{
+    hart_view &h = harts[0];
+    vector<uint32_t> stub = iss_restore_stub(model.s, SAMPLE_STUB, RESET_PC,
+                                             ram_peek(RESET_PC >> 2));
+    uint64_t stub_insts = 1 + stub.size() - 2;
+    uint64_t start = sim_cycle;
+
+    ut_assert(SAMPLE_STUB + 4 * stub.size() <= SAMPLE_STUB_END);
+    for (size_t i = 0; i < stub.size(); i++)
+        ram_poke((SAMPLE_STUB >> 2) + i, stub[i]);
+    ram_poke(RESET_PC >> 2, rv_jal(0, SAMPLE_STUB - RESET_PC));
+    // one edge in reset so the ram outputs show the stub
+    top->reset_n = 0;
+    eval();
+    pending_ops.push([](){
+        top->reset_n = 1;
+    });
+    while (*h.rdinstret != stub_insts) {
+        eval();
+        ut_assert(top->core_fault == 0);
+        ut_assert(sim_cycle - start < stub_insts * SAMPLE_MAX_CPI);
+    }
+    ut_assert(*h.pc == model.s.pc);
+    *h.rdinstret = model.s.instret;
+    *h.rdcycle = model.s.cycle;
+    clock_skew = model.s.cycle - sim_cycle;
+}
+
+// Run hart 0 until it retired up to instret or the program exited
+static void sample_rtl_run(uint64_t instret)
+{
+    hart_view &h = harts[0];
+    uint64_t start = sim_cycle;
+    uint64_t count = instret - *h.rdinstret;
+
+    while (*h.rdinstret < instret && !semihost_exited) {
+        eval();
+        ut_assert(top->core_fault == 0);
+        ut_assert(sim_cycle - start < count * SAMPLE_MAX_CPI);
+        semihost_step();
+    }
+}
+
+// Write what is left in the store buffers to ram through the backdoor, in
+// order, the reset that follows drops them
+static void flush_store_buffers()
+{
+    for (int h = 0; h < NUM_HARTS; h++) {
+        hart_view &hv = harts[h];
+
+        for (int i = 0; i < *hv.sb_count; i++) {
+            uint32_t addr = (*hv.sb_addr)[i];
+            uint32_t mask = 0;
+
+            for (int b = 0; b < 4; b++) {
+                if ((*hv.sb_strobe)[i] & (1 << b))
+                    mask |= 0xffu << (b * 8);
+            }
+            ram_poke(addr, ((*hv.sb_data)[i] & mask) | (ram_peek(addr) & ~mask));
+        }
+    }
+}
+
+// Finish the instruction in flight and any ecall, then read hart 0 back
+// into the functional model and hold the harts in reset. An instruction
+// held for the store buffer has not executed yet and runs again from pc.
+static void sample_from_rtl(sample_model &model)
+{
+    hart_view &h = harts[0];
+    iss_state s = {};
+
+    while (*h.core_hault || top->ecall_req || semihost_hold) {
+        eval();
+        ut_assert(top->core_fault == 0);
+        semihost_step();
+    }
+    flush_store_buffers();
+    s.pc = *h.pc;
+    for (int r = 0; r < 32; r++)
+        s.regs[r] = (*h.regs)[r];
+    s.mstatus_mie = *h.mstatus_mie;
+    s.mstatus_mpie = *h.mstatus_mpie;
+    s.mie = *h.mie;
+    s.mtvec = *h.mtvec;
+    s.mscratch = *h.mscratch;
+    s.mepc = *h.mepc;
+    s.mcause = *h.mcause;
+    s.cycle = *h.rdcycle;
+    s.instret = *h.rdinstret;
+    s.resv_valid = *h.resv_valid;
+    s.resv_addr = *h.resv_addr;
+    model.load(s);
+    // before the next edge, not through pending_ops
+    top->reset_n = 0;
+}
+
+struct sample_result {
+    uint64_t instret;       // whole run, counted by the functional model
+    uint64_t detailed;      // of those run on the RTL
+    double   cpi;           // weighted over the sampled windows
+};
+
+// SimPoint style sampled run of a single hart image. A profile pass on the
+// functional model collects basic block vectors per interval and picks one
+// interval per phase. The second pass fast-forwards to each of them, runs
+// it on the RTL after a short warmup and weights its CPI by the share of
+// instructions of its phase.
+static sample_result run_sampled(const string &image, const string &input, uint64_t interval)
+{
+    tb_ram ram;
+    sample_model model(ram);
+    bbv_profile profile;
+    vector<uint32_t> snapshot(sample_model::RAM_WORDS);
+    sample_result result = {};
+    double weights = 0;
+
+    load_file(image);
+    for (uint32_t i = 0; i < snapshot.size(); i++)
+        snapshot[i] = ram_peek(i);
+
+    semihost_reset(input);
+    model.reset(RESET_PC);
+    while (!semihost_exited) {
+        iss_stop stop = model.run(interval - model.s.instret % interval,
+                                  [&](uint32_t pc, uint32_t n){ profile.add(pc, n); });
+        if (model.s.instret % interval == 0)
+            profile.next();
+        sample_service(model, stop);
+    }
+    result.instret = model.s.instret;
+    vector<simpoint> points = profile.pick();
+    sort(points.begin(), points.end(),
+         [](const simpoint &a, const simpoint &b){ return a.interval < b.interval; });
+    printf("%s: %lu instructions, %lu intervals of %lu, %zu phases\n", image.c_str(),
+           result.instret, profile.intervals(), interval, points.size());
+
+    // only what changed, a sparse ram would back every page otherwise
+    for (uint32_t i = 0; i < snapshot.size(); i++) {
+        if (ram_peek(i) != snapshot[i])
+            ram_poke(i, snapshot[i]);
+    }
+    semihost_reset(input);
+    semihost_mute = true;
+    model.reset(RESET_PC);
+    for (simpoint &p : points) {
+        uint64_t begin = p.interval * interval;
+        uint64_t warm = begin > SAMPLE_WARMUP ? begin - SAMPLE_WARMUP : 0;
+
+        while (!semihost_exited && model.s.instret < warm)
+            sample_service(model, model.run(warm - model.s.instret));
+        if (semihost_exited)
+            break;
+        sample_to_rtl(model);
+        sample_rtl_run(begin);
+
+        uint64_t cycles = sim_cycle;
+        uint64_t insts = *harts[0].rdinstret;
+        sample_rtl_run(begin + interval);
+        cycles = sim_cycle - cycles;
+        insts = *harts[0].rdinstret - insts;
+        result.detailed += insts;
+        if (insts) {
+            printf("  interval %6lu weight %5.3f CPI %6.3f\n", p.interval, p.weight,
+                   (double)cycles / insts);
+            result.cpi += p.weight * cycles / insts;
+            weights += p.weight;
+        }
+        if (semihost_exited)
+            break;
+        sample_from_rtl(model);
+    }
+    top->reset_n = 0;
+    semihost_mute = false;
+    ut_assert(weights > 0);
+    result.cpi /= weights;
+    printf("  estimated CPI %.3f, %.0f cycles, %.1f%% of the instructions on the RTL\n",
+           result.cpi, result.cpi * result.instret, 100.0 * result.detailed / result.instret);
+    return result;
+}
+
+static void trace_begin(const string &path)
+{
+    ut_assert(mem_trace.open(path.c_str()));
+    trace_start = sim_cycle;
+}
+
+// Read a finished trace back, every fetch of hart 0 has to be one of the
+// instructions it retired, or bring up to two of them with dual issue or
+// a fused pair
+static void trace_check(const string &path)
+{
+    mem_trace_reader reader;
+    mem_access a;
+    uint64_t counts[NUM_HARTS][MEM_KINDS] = {};
+    uint64_t records = 0;
+    uint64_t last = 0;
+
+    mem_trace.close();
+    ut_assert(reader.open(path.c_str()));
+    while (reader.next(a)) {
+        ut_assert(a.hart < NUM_HARTS && a.kind < MEM_KINDS);
+        ut_assert(records == 0 || a.cycle > last);
+        counts[a.hart][a.kind]++;
+        last = a.cycle;
+        records++;
+    }
+    reader.close();
+#if DUAL_ISSUE || FUSION
+    ut_assert(counts[0][MEM_FETCH] <= *harts[0].rdinstret);
+    ut_assert(counts[0][MEM_FETCH] * 2 >= *harts[0].rdinstret);
+#endif
+#if DUAL_ISSUE
+    // every instruction past one per fetch issued as the second of a pair
+    uint64_t paired = *harts[0].rdinstret - counts[0][MEM_FETCH];
+    printf("%lu of %lu instructions issued in pairs\n", 2 * paired, (uint64_t)*harts[0].rdinstret);
+    ut_assert(paired * 100 >= *harts[0].rdinstret * DUAL_MIN_PAIRED);
+#elif !FUSION
+    ut_assert(counts[0][MEM_FETCH] == *harts[0].rdinstret);
+#endif
+    ut_assert(counts[0][MEM_STORE] > 0);
+    ut_assert(last < sim_cycle - trace_start);
+    printf("traced %lu accesses, %lu fetches %lu loads %lu stores on hart 0\n", records,
+           counts[0][MEM_FETCH], counts[0][MEM_LOAD], counts[0][MEM_STORE]);
+}
+
+// Trace benchmark images from src/build/bench/ into <name>.trace
+static void run_traces(int count, const char **names)
+{
+    for (int i = 0; i < count; i++) {
+        if (names[i][0] == '+')
+            continue;
+        string name = names[i];
+
+        load_file("../../../src/build/bench/" + name + ".dhex");
+        semihost_reset("");
+        trace_begin(name + ".trace");
+        uint64_t cycles = run_to_exit(TRACE_TIMEOUT);
+        ut_assert(semihost_exit_code == 0);
+        printf("%-12s %14lu cycles %14lu accesses traced\n", name.c_str(), cycles, mem_trace.records());
+        mem_trace.close();
+    }
+}
+
+static void run_samples(int count, const char **names)
+{
+    for (int i = 0; i < count; i++) {
+        if (names[i][0] != '+')
+            run_sampled("../../../src/build/bench/" + string(names[i]) + ".dhex", "", SAMPLE_INTERVAL);
+    }
+}
+
+struct fuzz_input {
+    uint32_t a;
+    uint32_t b;
+};
+
+// what a child hands back, one per child in flight
+struct fuzz_slot {
+    uint8_t  map[FUZZ_MAP];     // edge hit counts in power of two buckets
+    uint32_t fault;
+    // ran out of FUZZ_MAX_CYCLES before hart 0 got back to its loop
+    uint32_t hang;
+    uint64_t cycles;
+};
+
+struct fuzz_result {
+    uint64_t execs;
+    size_t   corpus;
+    size_t   edges;
+    size_t   crashes;
+    size_t   hangs;
+};
+
+static uint64_t fuzz_rng = 0x2545f4914f6cdd1dull;
+
+static uint32_t fuzz_rand()
+{
+    fuzz_rng ^= fuzz_rng << 13;
+    fuzz_rng ^= fuzz_rng >> 7;
+    fuzz_rng ^= fuzz_rng << 17;
+    return fuzz_rng >> 32;
+}
+
+static fuzz_input fuzz_mutate(const vector<fuzz_input> &corpus)
+{
+    static const uint32_t interesting[] = {
+        0, 1, 0x7f, 0x80, 0xff, 0x100, 0xffff, 0x7fffffff, 0x80000000, 0xffffffff
+    };
+    fuzz_input in = corpus[fuzz_rand() % corpus.size()];
+    int rounds = 1 + fuzz_rand() % 4;
+
+    for (int i = 0; i < rounds; i++) {
+        uint32_t &w = fuzz_rand() & 1 ? in.a : in.b;
+        int byte = fuzz_rand() % 4 * 8;
+
+        switch (fuzz_rand() % 6) {
+        case 0:
+            w ^= 1u << (fuzz_rand() % 32);
+            break;
+        case 1:
+            w += 1 + fuzz_rand() % 35;
+            break;
+        case 2:
+            w -= 1 + fuzz_rand() % 35;
+            break;
+        case 3:
+            w = (w & ~(0xffu << byte)) | (fuzz_rand() & 0xff) << byte;
+            break;
+        case 4:
+            w = interesting[fuzz_rand() % (sizeof(interesting) / sizeof(interesting[0]))];
+            break;
+        default:
+            // splice in a word of another corpus entry
+            w = fuzz_rand() & 1 ? corpus[fuzz_rand() % corpus.size()].a
+                                : corpus[fuzz_rand() % corpus.size()].b;
+            break;
+        }
+    }
+    return in;
+}
+
+// The child side: inject the input, record the non sequential pc edges of
+// hart 0 and report back through the shared slot
+static void fuzz_child(fuzz_slot &slot, const fuzz_input &in, uint32_t loop_pc)
+{
+    static uint8_t hits[FUZZ_MAP];
+    hart_view &h = harts[0];
+    uint32_t last_pc = *h.pc;
+    uint64_t start = sim_cycle;
+    int passes = 0;
+
+    // the trace belongs to the parent, every child writing into it at once
+    // would tear it apart
+    tfp = nullptr;
+    ram_poke(FUZZ_A >> 2, in.a);
+    ram_poke(FUZZ_B >> 2, in.b);
+    while (passes < 2 && sim_cycle - start < FUZZ_MAX_CYCLES && !top->core_fault) {
+        eval();
+        uint32_t pc = *h.pc;
+        if (pc != last_pc && pc != last_pc + 4) {
+            uint32_t edge = (last_pc >> 2) * 0x9e3779b1u ^ (pc >> 2);
+            edge = (edge ^ edge >> 16) & (FUZZ_MAP - 1);
+            if (hits[edge] < 255)
+                hits[edge]++;
+        }
+        if (pc == loop_pc && last_pc != loop_pc)
+            passes++;
+        last_pc = pc;
+    }
+    // 1, 2, 3, 4-7, 8-15, 16-31, 32-127 and more hits each get a bit
+    for (int i = 0; i < FUZZ_MAP; i++) {
+        uint8_t n = hits[i];
+        slot.map[i] = n < 3 ? n : n == 3 ? 4 : n < 8 ? 8 : n < 16 ? 16 :
+                      n < 32 ? 32 : n < 128 ? 64 : 128;
+    }
+    slot.fault = top->core_fault;
+    slot.hang = passes < 2 && !slot.fault;
+    slot.cycles = sim_cycle - start;
+}
+
+// Boot the image once, then fork a copy-on-write child of the booted model
+// per input instead of reloading and resetting. Up to one child per cpu is
+// in flight, coverage comes back through shared memory and inputs that hit
+// new edges or hit counts join the corpus.
+static fuzz_result run_fuzz(const string &image, uint64_t execs)
+{
+    hart_view &h = harts[0];
+    vector<fuzz_input> corpus = {{0, 0}, {1, 2}};
+    vector<fuzz_input> crashes;
+    vector<fuzz_input> hangs;
+    vector<uint8_t> seen(FUZZ_MAP);
+    vector<pid_t> running;
+    vector<fuzz_input> inputs;
+    vector<bool> seeded;
+    size_t jobs = max(1l, sysconf(_SC_NPROCESSORS_ONLN));
+    uint64_t started = 0;
+    uint64_t cycles = 0;
+    fuzz_result result = {};
+    auto begin = chrono::steady_clock::now();
+    uint64_t boot;
+
+    load_file(image);
+    pending_ops.push([](){
+        top->reset_n = 1;
+    });
+    // the snapshot sits on hart 0 loading the command
+    boot = sim_cycle;
+    do {
+        eval();
+        ut_assert(top->core_fault == 0);
+        ut_assert(sim_cycle - boot < FUZZ_BOOT_TIMEOUT);
+    } while (!(*h.core_hault && !*h.data_wr_en && (*h.load_store_addr & ~3u) == FUZZ_A));
+    uint32_t loop_pc = *h.pc;
+
+    fuzz_slot *slots = (fuzz_slot *)mmap(nullptr, jobs * sizeof(fuzz_slot), PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ut_assert(slots != MAP_FAILED);
+    running.assign(jobs, 0);
+    inputs.resize(jobs);
+    seeded.resize(jobs);
+    // the children inherit stdio buffers, nothing may be pending
+    fflush(stdout);
+    fflush(stderr);
+
+    while (result.execs < execs) {
+        for (size_t j = 0; j < jobs && started < execs; j++) {
+            if (running[j])
+                continue;
+            seeded[j] = started < corpus.size();
+            inputs[j] = seeded[j] ? corpus[started] : fuzz_mutate(corpus);
+            pid_t pid = fork();
+            ut_assert(pid >= 0);
+            if (pid == 0) {
+                fuzz_child(slots[j], inputs[j], loop_pc);
+                _exit(0);
+            }
+            running[j] = pid;
+            started++;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        ut_assert(pid > 0);
+        size_t j = find(running.begin(), running.end(), pid) - running.begin();
+        ut_assert(j < jobs);
+        running[j] = 0;
+        result.execs++;
+
+        fuzz_slot &slot = slots[j];
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || slot.fault) {
+            printf("  crash: a=0x%08x b=0x%08x fault %u\n", inputs[j].a, inputs[j].b, slot.fault);
+            crashes.push_back(inputs[j]);
+            continue;
+        }
+        if (slot.hang) {
+            printf("  hang: a=0x%08x b=0x%08x after %lu cycles\n", inputs[j].a, inputs[j].b,
+                   slot.cycles);
+            hangs.push_back(inputs[j]);
+            continue;
+        }
+        cycles += slot.cycles;
+        bool fresh = false;
+        for (int i = 0; i < FUZZ_MAP; i++) {
+            if (slot.map[i] & ~seen[i]) {
+                seen[i] |= slot.map[i];
+                fresh = true;
+            }
+        }
+        if (fresh && !seeded[j])
+            corpus.push_back(inputs[j]);
+    }
+    munmap(slots, jobs * sizeof(fuzz_slot));
+    top->reset_n = 0;
+
+    for (uint8_t bits : seen)
+        result.edges += bits != 0;
+    result.corpus = corpus.size();
+    result.crashes = crashes.size();
+    result.hangs = hangs.size();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    printf("fuzzed %lu inputs on %zu jobs: %.0f execs/s, %.1f cycles per input, "
+           "%zu edges, corpus %zu, %zu crashes, %zu hangs\n", result.execs, jobs,
+           result.execs / secs,
+           (double)cycles / max<uint64_t>(1, result.execs - result.crashes - result.hangs),
+           result.edges, result.corpus, result.crashes, result.hangs);
+    return result;
+}
+
+// One image of a batch manifest and what it has to do: exit with the code
+// within the cycle budget, with expect and without reject in its stdout.
+// With a reference signature file, the signature the image hands to exit
+// has to match it word for word.
+struct batch_case {
+    string name;
+    string image;
+    string input;
+    string expect;
+    string reject;
+    string signature;
+    uint64_t cycles;
+    int exit;
+};
+
+struct batch_result {
+    enum { PASS, FAIL, TIMEOUT, ERROR } status;
+    string message;
+    string output;
+    uint64_t cycles;
+    double seconds;
+};
+
+static const char *batch_status[] = {"pass", "fail", "timeout", "error"};
+
+// Next whitespace separated token of a manifest line, double quotes keep
+// spaces and take \n, \t, \" and \\ escapes
+static bool batch_token(const string &line, size_t &pos, string &token)
+{
+    bool quoted = false;
+
+    token.clear();
+    while (pos < line.size() && isspace((unsigned char)line[pos]))
+        pos++;
+    if (pos == line.size() || line[pos] == '#')
+        return false;
+    for (; pos < line.size(); pos++) {
+        char c = line[pos];
+
+        if (!quoted && isspace((unsigned char)c))
+            break;
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (quoted && c == '\\' && pos + 1 < line.size()) {
+            c = line[++pos];
+            token += c == 'n' ? '\n' : c == 't' ? '\t' : c;
+        } else {
+            token += c;
+        }
+    }
+    return true;
+}
+
+// A manifest line is `<name> image=<path> [cycles=<budget>] [exit=<code>]
+// [stdin=<text>] [stdout=<text>] [reject=<text>] [signature=<path>]`,
+// # starts a comment. Relative paths are taken from the directory of the
+// manifest.
+static vector<batch_case> batch_manifest(const string &path)
+{
+    vector<batch_case> cases;
+    string dir = path.find('/') == string::npos ? "" : path.substr(0, path.rfind('/') + 1);
+    ifstream in(path);
+    string line;
+    string token;
+
+    ut_assert(in.is_open());
+    while (getline(in, line)) {
+        size_t pos = 0;
+        batch_case c = {};
+
+        if (!batch_token(line, pos, c.name))
+            continue;
+        c.cycles = BATCH_CYCLES;
+        while (batch_token(line, pos, token)) {
+            size_t eq = token.find('=');
+            ut_assert(eq != string::npos);
+            string key = token.substr(0, eq);
+            string value = token.substr(eq + 1);
+
+            if (key == "image")
+                c.image = value[0] == '/' ? value : dir + value;
+            else if (key == "cycles")
+                c.cycles = strtoull(value.c_str(), nullptr, 0);
+            else if (key == "exit")
+                c.exit = atoi(value.c_str());
+            else if (key == "stdin")
+                c.input = value;
+            else if (key == "stdout")
+                c.expect = value;
+            else if (key == "reject")
+                c.reject = value;
+            else if (key == "signature")
+                c.signature = value[0] == '/' ? value : dir + value;
+            else
+                ut_assert(!"unknown manifest key");
+        }
+        ut_assert(!c.image.empty());
+        cases.push_back(c);
+    }
+    return cases;
+}
+
+// Backdoor load into the model of this thread, without clocking a word in
+// at a time like load_file() does, then reset the harts
+static void batch_load(const string &image)
+{
+    ifstream in(image);
+    string line;
+
+    ut_assert(in.is_open());
+#ifdef RAM_DPI
+    ram_dpi_clear(ram_scope);
+#else
+    for (uint32_t addr = 0; addr < sample_model::RAM_WORDS; addr++)
+        ram_poke(addr, 0);
+#endif
+    while (getline(in, line)) {
+        unsigned long addr;
+        unsigned long value;
+
+        if (sscanf(line.c_str(), "%lx:%lx", &addr, &value) != 2)
+            continue;
+        ut_assert((addr & 0x3) == 0x0);
+        ram_poke(addr >> 2, value);
+    }
+    top->a_wr_en = 0;
+    top->a_wr_strobe = 0xf;
+    top->ext_irq = 0;
+    top->time_skip = 0;
+    top->ecall_ack = 0;
+    top->reset_n = 0;
+    for (int i = 0; i < BATCH_RESET_CYCLES; i++)
+        eval();
+}
+
+// riscv-arch-test images exit with the bounds of their signature in a1 and
+// a2, see src/arch/model_test.h. Compared word by word against the one
+// hex word per line reference, the signature goes into the output of a
+// failing case.
+static bool batch_signature(const batch_case &c, batch_result &r)
+{
+    VlUnpacked<IData, 32> &regs = *harts[0].regs;
+    uint32_t begin = regs[11];
+    uint32_t end = regs[12];
+    ifstream in(c.signature);
+    vector<uint32_t> ref;
+    string line;
+    char msg[128];
+
+    ut_assert(in.is_open());
+    while (getline(in, line)) {
+        if (!line.empty())
+            ref.push_back(strtoul(line.c_str(), nullptr, 16));
+    }
+    ut_assert(begin <= end && (begin & 3) == 0);
+
+    size_t words = (end - begin) / 4;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < words; i++) {
+        uint32_t word = ram_peek((begin >> 2) + i);
+
+        snprintf(msg, sizeof(msg), "%08x\n", word);
+        r.output += msg;
+        if (i < ref.size() && word != ref[i] && mismatches++ == 0) {
+            snprintf(msg, sizeof(msg), "signature word %zu at 0x%x is %08x, expected %08x",
+                     i, begin + (uint32_t)i * 4, word, ref[i]);
+            r.message = msg;
+        }
+    }
+    if (words != ref.size()) {
+        snprintf(msg, sizeof(msg), "signature has %zu words, the reference %zu", words, ref.size());
+        r.message = msg;
+        return false;
+    }
+    if (mismatches) {
+        r.message += ", " + to_string(mismatches) + " words differ";
+        return false;
+    }
+    r.output.clear();
+    return true;
+}
+
+static batch_result batch_run(const batch_case &c)
+{
+    batch_result r = {};
+    auto begin = chrono::steady_clock::now();
+
+    try {
+        batch_load(c.image);
+        semihost_reset(c.input);
+        semihost_mute = true;
+        pending_ops.push([](){
+            top->reset_n = 1;
+        });
+        uint64_t start = sim_cycle;
+        while (!semihost_exited && !top->core_fault && sim_cycle - start < c.cycles) {
+            eval();
+            semihost_step();
+        }
+        r.cycles = sim_cycle - start;
+        r.output = semihost_stdout;
+        if (top->core_fault) {
+            char msg[64];
+
+            snprintf(msg, sizeof(msg), "core_fault %u, hart 0 at pc 0x%x", top->core_fault, *harts[0].pc);
+            r.status = batch_result::FAIL;
+            r.message = msg;
+        } else if (!semihost_exited) {
+            r.status = batch_result::TIMEOUT;
+            r.message = "no exit within " + to_string(c.cycles) + " cycles";
+        } else if (semihost_exit_code != c.exit) {
+            r.status = batch_result::FAIL;
+            r.message = "exit code " + to_string(semihost_exit_code) + ", expected " + to_string(c.exit);
+        } else if (semihost_stdout.find(c.expect) == string::npos) {
+            r.status = batch_result::FAIL;
+            r.message = "expected output missing";
+        } else if (!c.reject.empty() && semihost_stdout.find(c.reject) != string::npos) {
+            r.status = batch_result::FAIL;
+            r.message = "rejected output present";
+        } else if (!c.signature.empty() && !batch_signature(c, r)) {
+            r.status = batch_result::FAIL;
+        } else {
+            r.status = batch_result::PASS;
+        }
+    } catch (system_error &err) {
+        r.status = batch_result::ERROR;
+        r.message = err.what();
+    }
+    top->reset_n = 0;
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    return r;
+}
+
+static string xml_escape(const string &s)
+{
+    string out;
+
+    for (char c : s) {
+        switch (c) {
+        case '<':  out += "&lt;"; break;
+        case '>':  out += "&gt;"; break;
+        case '&':  out += "&amp;"; break;
+        case '"':  out += "&quot;"; break;
+        default:
+            if ((unsigned char)c < 0x20 && c != '\n' && c != '\t')
+                out += '?';
+            else
+                out += c;
+        }
+    }
+    return out;
+}
+
+static string json_escape(const string &s)
+{
+    string out;
+    char buf[8];
+
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+static void batch_report(const string &base, const vector<batch_case> &cases,
+                         const vector<batch_result> &results, double seconds)
+{
+    size_t failures = 0;
+    size_t errors = 0;
+    FILE *f;
+
+    for (const batch_result &r : results) {
+        failures += r.status == batch_result::FAIL || r.status == batch_result::TIMEOUT;
+        errors += r.status == batch_result::ERROR;
+    }
+
+    f = fopen((base + ".xml").c_str(), "w");
+    ut_assert(f);
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(f, "<testsuite name=\"firmware\" tests=\"%zu\" failures=\"%zu\" errors=\"%zu\" time=\"%.3f\">\n",
+            cases.size(), failures, errors, seconds);
+    for (size_t i = 0; i < cases.size(); i++) {
+        const batch_result &r = results[i];
+
+        fprintf(f, "  <testcase classname=\"firmware\" name=\"%s\" time=\"%.3f\">\n",
+                xml_escape(cases[i].name).c_str(), r.seconds);
+        if (r.status == batch_result::ERROR)
+            fprintf(f, "    <error message=\"%s\"/>\n", xml_escape(r.message).c_str());
+        else if (r.status != batch_result::PASS)
+            fprintf(f, "    <failure type=\"%s\" message=\"%s\"/>\n", batch_status[r.status],
+                    xml_escape(r.message).c_str());
+        fprintf(f, "    <system-out>%s</system-out>\n", xml_escape(r.output).c_str());
+        fprintf(f, "  </testcase>\n");
+    }
+    fprintf(f, "</testsuite>\n");
+    fclose(f);
+
+    f = fopen((base + ".json").c_str(), "w");
+    ut_assert(f);
+    fprintf(f, "{\n  \"seconds\": %.3f,\n  \"cases\": [\n", seconds);
+    for (size_t i = 0; i < cases.size(); i++) {
+        const batch_result &r = results[i];
+
+        fprintf(f, "    {\"name\": \"%s\", \"image\": \"%s\", \"status\": \"%s\", "
+                   "\"cycles\": %lu, \"seconds\": %.3f, \"message\": \"%s\"}%s\n",
+                json_escape(cases[i].name).c_str(), json_escape(cases[i].image).c_str(),
+                batch_status[r.status], r.cycles, r.seconds, json_escape(r.message).c_str(),
+                i + 1 < cases.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+// Run every case of a manifest on a pool of workers. Each worker builds one
+// Vtop and reuses it for image after image, reloading the ram through the
+// backdoor and resetting in between. With RAM=sparse every model has a
+// page table of its own, see ram_dpi.h. Returns the number of cases that
+// did not pass, reports go to <report>.xml (JUnit) and <report>.json unless
+// report is empty.
+static size_t run_batch(const vector<batch_case> &cases, unsigned jobs, const string &report)
+{
+    vector<batch_result> results(cases.size());
+    vector<thread> workers;
+    atomic<size_t> next(0);
+    size_t failed = 0;
+    auto begin = chrono::steady_clock::now();
+
+    jobs = max(1u, min<unsigned>(jobs, cases.size()));
+    for (unsigned w = 0; w < jobs; w++) {
+        workers.emplace_back([&](){
+            ctx = new VerilatedContext;
+            top = new Vtop{ctx};
+            bind_harts();
+            for (size_t i; (i = next++) < cases.size();) {
+                results[i] = batch_run(cases[i]);
+                const batch_result &r = results[i];
+                printf("%s%-8s" FG_RESET " %-16s %14lu cycles %8.2f s %s\n",
+                       r.status == batch_result::PASS ? FG_GREEN : FG_RED, batch_status[r.status],
+                       cases[i].name.c_str(), r.cycles, r.seconds, r.message.c_str());
+            }
+            delete_model();
+        });
+    }
+    for (thread &w : workers)
+        w.join();
+
+    for (const batch_result &r : results)
+        failed += r.status != batch_result::PASS;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    printf("%zu of %zu images passed on %u workers in %.1f s\n", cases.size() - failed,
+           cases.size(), jobs, seconds);
+    if (!report.empty())
+        batch_report(report, cases, results, seconds);
+    return failed;
+}
+
 int main(int argc, const char **argv)
 {
+    // `Vtop bench <name>...` runs benchmark images instead, without a trace,
+    // `Vtop buslat <min:max,...> <name>...` runs them per BUS latency range,
+    // `Vtop sample <name>...` estimates them from sampled windows and
+    // `Vtop trace <name>...` records their memory accesses.
+    // `Vtop fuzz <name> <count>` fuzzes the a/b inputs of src/build/<name>
+    // `Vtop latency <requests> <gap> [fixed]` offers test.cpp open-loop load
+    // `Vtop cosim <name> <shm name>` serves src/build/<name> to a system
+    // model in another process, see cosim.h
+    bool bench = argc > 1 && string(argv[1]) == "bench";
+    bool buslat = argc > 2 && string(argv[1]) == "buslat";
+    bool sample = argc > 1 && string(argv[1]) == "sample";
+    bool trace = argc > 1 && string(argv[1]) == "trace";
+    bool fuzz = argc > 3 && string(argv[1]) == "fuzz";
+    bool latency = argc > 3 && string(argv[1]) == "latency";
+    bool cosim = argc > 3 && string(argv[1]) == "cosim";
+    // `Vtop batch <manifest> [jobs]` runs a regression manifest and reports
+    // to <manifest name>.xml and .json, see run_batch()
+    bool batch = argc > 2 && string(argv[1]) == "batch";
+    int status = 0;
+
     ctx = new VerilatedContext;
     ctx->commandArgs(argc, argv);
     top = new Vtop{ctx};
-    Verilated::traceEverOn(true);
-    tfp = new VerilatedVcdC;
-    top->trace(tfp, 99);
-    tfp->open("simx.vcd");
+    bind_harts();
+    if (!bench && !buslat && !sample && !trace && !fuzz && !batch && !latency && !cosim) {
+        Verilated::traceEverOn(true);
+        tfp = new VerilatedVcdC;
+        top->trace(tfp, 99);
+        tfp->open("simx.vcd");
+    }
 
     try {
-        load_file("../../../src/build/test.dhex");
-        run_sim();
-        tfp->close();
-        delete tfp;
-        delete top;
-        delete ctx;
-        printf(FG_GREEN "Simulation Successfull!\n" FG_RESET);
+        if (bench) {
+            run_benchmarks(argc - 2, argv + 2);
+        } else if (buslat) {
+            run_bus_latencies(argv[2], argc - 3, argv + 3);
+        } else if (sample) {
+            run_samples(argc - 2, argv + 2);
+        } else if (trace) {
+            run_traces(argc - 2, argv + 2);
+        } else if (batch) {
+            unsigned jobs = argc > 3 ? atoi(argv[3]) : thread::hardware_concurrency();
+            string report = argv[2];
+            report = report.substr(report.rfind('/') + 1);
+            report = report.substr(0, report.rfind('.'));
+            status = run_batch(batch_manifest(argv[2]), jobs, report) != 0;
+        } else if (fuzz) {
+            run_fuzz("../../../src/build/" + string(argv[2]) + ".dhex", strtoull(argv[3], nullptr, 0));
+        } else if (latency) {
+            load_file("../../../src/build/test.dhex");
+            run_latency(strtoul(argv[2], nullptr, 0), atof(argv[3]),
+                        !(argc > 4 && string(argv[4]) == "fixed"));
+        } else if (cosim) {
+            load_file("../../../src/build/" + string(argv[2]) + ".dhex");
+            cosim_shm *shm = cosim_create(argv[3]);
+            printf("serving %s on %s\n", argv[2], argv[3]);
+            fflush(stdout);
+            cosim_serve(shm, 0);
+            cosim_destroy(shm, argv[3]);
+        } else {
+            load_file("../../../src/build/test.dhex");
+            run_sim();
+#if ADDR_WIDTH > 16
+            run_high_ram();
+#endif
+            load_file("../../../src/build/parallel.dhex");
+            run_parallel(1);
+            load_file("../../../src/build/parallel.dhex");
+            run_parallel(NUM_HARTS);
+#if BUS
+            run_bus_atomics();
+#endif
+            load_file("../../../src/build/dma.dhex");
+            run_dma();
+            load_file("../../../src/build/cfu.dhex");
+            run_cfu();
+            // the harts only overlap in their multipliers, the round robin
+            // port still has to give every extra one a quarter of a hart
+            load_file("../../../src/build/cfu.dhex");
+            uint64_t serial = run_cfu_scaling(1);
+            load_file("../../../src/build/cfu.dhex");
+            double speedup = (double)serial / run_cfu_scaling(NUM_HARTS);
+            printf("cfu speedup on %d harts: %.2f\n", NUM_HARTS, speedup);
+            if (NUM_HARTS > 1)
+                ut_assert(speedup > 0.75 + 0.25 * NUM_HARTS);
+            load_file("../../../src/build/ring.dhex");
+            run_ring();
+            load_file("../../../src/build/hello.dhex");
+            trace_begin("hello.trace");
+            run_semihost();
+            trace_check("hello.trace");
+            // simx.vcd covers the directed tests above, the long runs below
+            // would take it to gigabytes
+            vcd_close();
+            load_file("../../../src/build/strbench.dhex");
+            etrace_begin();
+            double cpi = run_strbench();
+            etrace_check("../../../src/build/strbench.elf");
+            // the sampled estimate has to land close to the full run
+            sample_result sampled = run_sampled("../../../src/build/strbench.dhex", "", SAMPLE_INTERVAL);
+            ut_assert(fabs(sampled.cpi - cpi) < 0.05 * cpi);
+            // idle time must be invisible to the firmware when skipped
+            load_file("../../../src/build/wfi.dhex");
+            etrace_begin();
+            uint32_t ticks = run_wfi(false);
+            etrace_check("../../../src/build/wfi.elf");
+            load_file("../../../src/build/wfi.dhex");
+            ut_assert(run_wfi(true) == ticks);
+            // skipping idle polling must not change what the firmware sees,
+            // including its own counters
+            load_file("../../../src/build/test.dhex");
+            idle_result full = run_idle_requests(false);
+            load_file("../../../src/build/test.dhex");
+            idle_result skipped = run_idle_requests(true);
+            ut_assert(full.y == skipped.y);
+            ut_assert(full.rdcycle == skipped.rdcycle);
+            ut_assert(full.rdinstret == skipped.rdinstret);
+            // below saturation the service has to keep up with the offered
+            // rate
+            load_file("../../../src/build/test.dhex");
+            latency_result lat = run_latency(LATENCY_REQUESTS, LATENCY_GAP, true);
+            ut_assert(lat.p50 > 0 && lat.p50 <= lat.p99 && lat.p99 <= lat.max);
+            ut_assert(lat.throughput > 0.9 * 1000.0 / LATENCY_GAP);
+            // the same service from another process over shared memory
+            load_file("../../../src/build/wfi.dhex");
+            run_cosim();
+            // no input may fault or wedge the command service, and the
+            // children have to find paths the seeds do not take
+            fuzz_result fuzzed = run_fuzz("../../../src/build/fuzz.dhex", FUZZ_REGRESSION);
+            ut_assert(fuzzed.crashes == 0);
+            ut_assert(fuzzed.hangs == 0);
+            ut_assert(fuzzed.corpus > 2);
+            // two workers, each with its own model next to this one
+            vector<batch_case> cases = {
+                {"hello", "../../../src/build/hello.dhex", "dabble\n",
+                 "hello from the dabble core\nDABBLE\n", "", "", SEMIHOST_TIMEOUT, 0},
+                {"strbench", "../../../src/build/strbench.dhex", "", "", "", "", STRBENCH_TIMEOUT, 0},
+            };
+            ut_assert(run_batch(cases, 2, "") == 0);
+        }
+        vcd_close();
+        delete_model();
+        if (status)
+            fprintf(stderr, FG_RED "Batch failed\n" FG_RESET);
+        else
+            printf(FG_GREEN "Simulation Successfull!\n" FG_RESET);
     } catch (system_error &err) {
         fprintf(stderr, FG_RED "%s\n" FG_RESET, err.what());
-        tfp->close();
-        delete tfp;
-        delete top;
-        delete ctx;
+        status = 1;
+        vcd_close();
+        delete_model();
     }
-    return 0;
-}
\ No newline at end of file
+    return status;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Memory access trace of the harts on the shared ram port, one record per
+// granted access. The file is an 8 byte header followed by records of a tag
+// byte and up to two LEB128 varints:
+//
+//   tag[1:0]  kind, fetch, load or store
+//   tag[4:2]  hart
+//   tag[5]    a gap follows, cycles since the previous record minus one
+//   tag[6]    an address delta follows, zigzag coded in words against the
+//             previous address of the same hart and kind, without it the
+//             access is the next word
+//
+// Straight line fetches on consecutive cycles take a single byte.
+#define MEM_TRACE_MAGIC     "DMTRACE1"
+
+enum mem_kind {
+    MEM_FETCH,
+    MEM_LOAD,
+    MEM_STORE,
+    MEM_KINDS
+};
+
+struct mem_access {
+    uint64_t cycle;
+    uint32_t addr;          // byte address of the word
+    uint8_t  hart;
+    uint8_t  kind;
+};
+
+class mem_trace_writer {
+public:
+    static const int MAX_HARTS = 8;
+
+    bool open(const char *path)
+    {
+        f = fopen(path, "wb");
+        if (!f)
+            return false;
+        fwrite(MEM_TRACE_MAGIC, 1, 8, f);
+        memset(last, 0, sizeof(last));
+        last_cycle = 0;
+        count = 0;
+        return true;
+    }
+
+    void close()
+    {
+        if (f)
+            fclose(f);
+        f = nullptr;
+    }
+
+    bool is_open() const { return f != nullptr; }
+    uint64_t records() const { return count; }
+
+    void add(const mem_access &a)
+    {
+        uint32_t &prev = last[a.hart][a.kind];
+        int32_t delta = (int32_t)(a.addr - prev) >> 2;
+        uint64_t gap = count ? a.cycle - last_cycle - 1 : a.cycle;
+        uint8_t tag = a.kind | a.hart << 2;
+
+        if (gap)
+            tag |= 1 << 5;
+        if (delta != 1)
+            tag |= 1 << 6;
+        putc(tag, f);
+        if (gap)
+            put_varint(gap);
+        if (delta != 1)
+            put_varint((uint32_t)delta << 1 ^ (uint32_t)(delta >> 31));
+        prev = a.addr;
+        last_cycle = a.cycle;
+        count++;
+    }
+
+private:
+    FILE *f = nullptr;
+    uint32_t last[MAX_HARTS][MEM_KINDS];
+    uint64_t last_cycle;
+    uint64_t count;
+
+    void put_varint(uint64_t v)
+    {
+        while (v >= 0x80) {
+            putc(0x80 | (v & 0x7f), f);
+            v >>= 7;
+        }
+        putc(v, f);
+    }
+};
+
+class mem_trace_reader {
+public:
+    bool open(const char *path)
+    {
+        char magic[8];
+
+        f = fopen(path, "rb");
+        if (!f)
+            return false;
+        if (fread(magic, 1, 8, f) != 8 || memcmp(magic, MEM_TRACE_MAGIC, 8) != 0) {
+            close();
+            return false;
+        }
+        memset(last, 0, sizeof(last));
+        cycle = 0;
+        first = true;
+        return true;
+    }
+
+    void close()
+    {
+        if (f)
+            fclose(f);
+        f = nullptr;
+    }
+
+    // false at the end of the trace
+    bool next(mem_access &a)
+    {
+        int tag = getc(f);
+        uint64_t gap = 0;
+        uint32_t delta = 1;
+
+        if (tag == EOF)
+            return false;
+        a.kind = tag & 3;
+        a.hart = (tag >> 2) & 7;
+        if (tag & (1 << 5))
+            gap = get_varint();
+        if (tag & (1 << 6)) {
+            uint32_t z = get_varint();
+            delta = (z >> 1) ^ -(z & 1);
+        }
+        cycle = first ? gap : cycle + 1 + gap;
+        first = false;
+        last[a.hart][a.kind] += delta << 2;
+        a.addr = last[a.hart][a.kind];
+        a.cycle = cycle;
+        return true;
+    }
+
+private:
+    FILE *f = nullptr;
+    uint32_t last[mem_trace_writer::MAX_HARTS][MEM_KINDS];
+    uint64_t cycle;
+    bool first;
+
+    uint64_t get_varint()
+    {
+        uint64_t v = 0;
+        int c;
+
+        for (int shift = 0; (c = getc(f)) != EOF; shift += 7) {
+            v |= (uint64_t)(c & 0x7f) << shift;
+            if (!(c & 0x80))
+                break;
+        }
+        return v;
+    }
+};
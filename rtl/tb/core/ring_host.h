@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../../../src/lib/ring.h"
+
+#include <cstdint>
+#include <functional>
+
+// Host side of the request ring in src/lib/ring.h. Every access is a single
+// word over the testbench ram port, so the accessors advance the simulation.
+class ring_host {
+public:
+    ring_host(std::function<uint32_t(uint32_t)> read,
+              std::function<void(uint32_t, uint32_t)> write)
+        : read(read), write(write) {}
+
+    // Only while the firmware is held in reset
+    void reset()
+    {
+        head = done = reaped = 0;
+        write(RING_HEAD, 0);
+        write(RING_DONE, 0);
+    }
+
+    uint32_t space() const
+    {
+        return RING_ENTRIES - (head - reaped);
+    }
+
+    // Fill the next descriptor, the firmware sees it after submit()
+    void push(uint32_t a, uint32_t b)
+    {
+        write(RING_DESC(head) + RING_DESC_A, a);
+        write(RING_DESC(head) + RING_DESC_B, b);
+        head++;
+    }
+
+    // Publish every pushed descriptor with one doorbell write
+    void submit()
+    {
+        write(RING_HEAD, head);
+    }
+
+    // Number of answers ready to pop
+    uint32_t poll()
+    {
+        done = read(RING_DONE);
+        return done - reaped;
+    }
+
+    // Answer of the oldest request, frees its slot
+    uint32_t pop()
+    {
+        uint32_t y = read(RING_DESC(reaped) + RING_DESC_Y);
+        reaped++;
+        return y;
+    }
+
+private:
+    std::function<uint32_t(uint32_t)> read;
+    std::function<void(uint32_t, uint32_t)> write;
+    uint32_t head = 0;
+    uint32_t done = 0;
+    uint32_t reaped = 0;
+};
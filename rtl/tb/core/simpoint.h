@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// SimPoint style phase analysis. The functional model fills one basic block
+// vector per interval of instructions, pick() clusters them and returns one
+// representative interval per phase with the share of all instructions the
+// phase accounts for. Estimates weight each representative's CPI by that.
+struct simpoint {
+    uint64_t interval;      // index of the interval to simulate in detail
+    double   weight;
+};
+
+class bbv_profile {
+public:
+    // vectors are reduced to this many dimensions before clustering
+    static const int DIMS = 15;
+    // k-means runs up to this many phases
+    static const int MAX_K = 10;
+
+    // instructions executed in the basic block starting at pc
+    void add(uint32_t pc, uint32_t count)
+    {
+        if (vectors.empty())
+            next();
+        current[pc] += count;
+        lengths.back() += count;
+    }
+
+    // close the current interval, called every interval of instructions
+    void next()
+    {
+        if (!vectors.empty())
+            project();
+        vectors.emplace_back();
+        lengths.push_back(0);
+        current.clear();
+    }
+
+    uint64_t intervals() const { return vectors.size(); }
+    uint64_t total() const
+    {
+        uint64_t sum = 0;
+
+        for (uint64_t len : lengths)
+            sum += len;
+        return sum;
+    }
+
+    // Smallest k whose clustering leaves at most a tenth of the spread
+    // of a single cluster, nearest interval to each centroid
+    std::vector<simpoint> pick()
+    {
+        std::vector<simpoint> points;
+        std::vector<int> assign;
+        double spread_1 = 0;
+
+        if (!vectors.empty() && lengths.back() == 0) {
+            vectors.pop_back();
+            lengths.pop_back();
+        } else if (!vectors.empty()) {
+            project();
+        }
+        current.clear();
+        if (vectors.empty())
+            return points;
+        for (int k = 1; k <= MAX_K && k <= (int)vectors.size(); k++) {
+            double spread = kmeans(k, assign);
+
+            if (k == 1)
+                spread_1 = spread;
+            if (spread <= 0.1 * spread_1)
+                break;
+        }
+
+        int k = 0;
+        for (int c : assign)
+            k = std::max(k, c + 1);
+        for (int c = 0; c < k; c++) {
+            uint64_t best = 0;
+            double best_dist = INFINITY;
+            uint64_t insts = 0;
+
+            for (uint64_t i = 0; i < vectors.size(); i++) {
+                if (assign[i] != c)
+                    continue;
+                insts += lengths[i];
+                double d = dist(vectors[i], centroids[c]);
+                if (d < best_dist) {
+                    best_dist = d;
+                    best = i;
+                }
+            }
+            if (insts)
+                points.push_back({best, (double)insts / total()});
+        }
+        return points;
+    }
+
+private:
+    typedef std::vector<double> vec;
+
+    std::unordered_map<uint32_t, uint64_t> current;
+    std::vector<vec> vectors;
+    std::vector<uint64_t> lengths;
+    std::vector<vec> centroids;
+
+    // Fixed random projection of the block dimension, the same block start
+    // always maps to the same direction
+    static double proj(uint32_t pc, int dim)
+    {
+        uint64_t x = ((uint64_t)pc << 8 | dim) * 0x9e3779b97f4a7c15ull;
+
+        x ^= x >> 29;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 32;
+        return (double)(x & 0xffffff) / 0x800000 - 1.0;
+    }
+
+    static double dist(const vec &a, const vec &b)
+    {
+        double sum = 0;
+
+        for (int d = 0; d < DIMS; d++)
+            sum += (a[d] - b[d]) * (a[d] - b[d]);
+        return sum;
+    }
+
+    // normalised so short intervals at the end compare by mix, not size
+    void project()
+    {
+        vec &v = vectors.back();
+        double len = lengths.back();
+
+        v.assign(DIMS, 0.0);
+        if (len == 0)
+            return;
+        for (auto &block : current) {
+            for (int d = 0; d < DIMS; d++)
+                v[d] += block.second / len * proj(block.first, d);
+        }
+    }
+
+    // Lloyd iterations from farthest point seeds, returns the summed
+    // squared distance of every interval to its centroid
+    double kmeans(int k, std::vector<int> &assign)
+    {
+        uint64_t n = vectors.size();
+
+        centroids.assign(1, vectors[0]);
+        while ((int)centroids.size() < k) {
+            uint64_t far = 0;
+            double far_dist = -1;
+
+            for (uint64_t i = 0; i < n; i++) {
+                double d = INFINITY;
+                for (vec &c : centroids)
+                    d = std::min(d, dist(vectors[i], c));
+                if (d > far_dist) {
+                    far_dist = d;
+                    far = i;
+                }
+            }
+            centroids.push_back(vectors[far]);
+        }
+
+        assign.assign(n, -1);
+        for (int iter = 0; iter < 100; iter++) {
+            bool moved = false;
+
+            for (uint64_t i = 0; i < n; i++) {
+                int best = 0;
+                for (int c = 1; c < k; c++) {
+                    if (dist(vectors[i], centroids[c]) < dist(vectors[i], centroids[best]))
+                        best = c;
+                }
+                if (assign[i] != best) {
+                    assign[i] = best;
+                    moved = true;
+                }
+            }
+            if (!moved)
+                break;
+            for (int c = 0; c < k; c++) {
+                vec sum(DIMS, 0.0);
+                int members = 0;
+
+                for (uint64_t i = 0; i < n; i++) {
+                    if (assign[i] != c)
+                        continue;
+                    for (int d = 0; d < DIMS; d++)
+                        sum[d] += vectors[i][d];
+                    members++;
+                }
+                if (members) {
+                    for (int d = 0; d < DIMS; d++)
+                        centroids[c][d] = sum[d] / members;
+                }
+            }
+        }
+
+        double spread = 0;
+        for (uint64_t i = 0; i < n; i++)
+            spread += dist(vectors[i], centroids[assign[i]]);
+        return spread;
+    }
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <elf.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Decoder for the branch trace of rtl/trace_encoder.sv. Rebuilds the address
+// of every retired instruction by walking the program of the ELF image: a
+// branch takes the next trace bit, jal goes to its target, jalr and mret
+// take the address of the next jump or stop packet. The bits are only
+// walked once an address packet says where they lead.
+#define TRACE_KIND_BRANCHES 0
+#define TRACE_KIND_JUMP     1
+#define TRACE_KIND_STOP     2
+#define TRACE_KIND_SYNC     3
+
+class trace_decoder {
+public:
+    // the PT_LOAD segments of a RISC-V ELF32 image
+    bool load_elf(const char *path)
+    {
+        std::vector<uint8_t> file;
+        FILE *f = fopen(path, "rb");
+        if (!f)
+            return fail("can not open " + std::string(path));
+        uint8_t buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            file.insert(file.end(), buf, buf + n);
+        fclose(f);
+
+        Elf32_Ehdr eh;
+        if (file.size() < sizeof(eh))
+            return fail("short ELF header");
+        memcpy(&eh, file.data(), sizeof(eh));
+        if (memcmp(eh.e_ident, ELFMAG, SELFMAG) != 0 || eh.e_ident[EI_CLASS] != ELFCLASS32 ||
+            eh.e_machine != EM_RISCV)
+            return fail("not a RISC-V ELF32 image");
+        for (int i = 0; i < eh.e_phnum; i++) {
+            Elf32_Phdr ph;
+            size_t off = eh.e_phoff + (size_t)i * eh.e_phentsize;
+            if (off + sizeof(ph) > file.size())
+                return fail("short program header");
+            memcpy(&ph, file.data() + off, sizeof(ph));
+            if (ph.p_type != PT_LOAD)
+                continue;
+            if ((size_t)ph.p_offset + ph.p_filesz > file.size())
+                return fail("short segment");
+            for (uint32_t b = 0; b + 4 <= ph.p_filesz; b += 4) {
+                uint32_t word;
+                memcpy(&word, file.data() + ph.p_offset + b, 4);
+                code[(ph.p_paddr + b) & ~3u] = word;
+            }
+        }
+        return true;
+    }
+
+    // Append the flow of packets to flow. A trace starts with a sync, a
+    // packet that does not fit the program stops the decode.
+    bool decode(const std::vector<uint32_t> &packets, std::vector<uint32_t> &flow)
+    {
+        for (uint32_t p : packets) {
+            uint32_t addr = p & ~3u;
+
+            switch (p & 3) {
+            case TRACE_KIND_BRANCHES:
+                for (uint32_t i = 0; i < (p >> 2 & 0x1f); i++)
+                    bits.push_back(p >> (7 + i) & 1);
+                break;
+            case TRACE_KIND_JUMP:
+                if (!walk(flow, addr, false))
+                    return false;
+                break;
+            case TRACE_KIND_STOP:
+                if (!walk(flow, addr, true))
+                    return false;
+                synced = false;
+                break;
+            case TRACE_KIND_SYNC:
+                if (!bits.empty())
+                    return fail("sync with branches left");
+                pc = addr;
+                synced = true;
+                break;
+            }
+        }
+        return true;
+    }
+
+    const std::string &error() const { return err; }
+
+private:
+    std::unordered_map<uint32_t, uint32_t> code;
+    std::deque<bool> bits;
+    uint32_t pc = 0;
+    bool synced = false;
+    std::string err;
+
+    bool fail(const std::string &msg)
+    {
+        err = msg;
+        return false;
+    }
+
+    bool fail_at(const char *msg)
+    {
+        char at[64];
+        snprintf(at, sizeof(at), " at 0x%08x", pc);
+        return fail(msg + std::string(at));
+    }
+
+    // Run the program from pc with the pending branch bits. A jump packet
+    // ends on the uninferable jump its target belongs to, a stop packet
+    // once the flow reaches target with no bits left, or on a jump that
+    // goes there.
+    bool walk(std::vector<uint32_t> &flow, uint32_t target, bool stop)
+    {
+        // without a bit to take the walk can not go round a loop, so it
+        // ends within the size of the program
+        size_t straight = 0;
+
+        if (!synced)
+            return fail("packet before a sync");
+        while (!(stop && bits.empty() && pc == target)) {
+            auto it = code.find(pc);
+            if (it == code.end())
+                return fail_at("flow left the image");
+            if (straight++ > code.size())
+                return fail_at("no way to the packet address");
+            uint32_t inst = it->second;
+            uint32_t op = inst & 0x7f;
+            flow.push_back(pc);
+            if (op == 0x63) {
+                if (bits.empty())
+                    return fail_at("out of branch bits");
+                int32_t imm_b = ((int32_t)inst >> 31 << 12) | (inst >> 7 & 1) << 11 |
+                                (inst >> 25 & 0x3f) << 5 | (inst >> 8 & 0xf) << 1;
+                pc = bits.front() ? pc + imm_b : pc + 4;
+                bits.pop_front();
+                straight = 0;
+            } else if (op == 0x6f) {
+                int32_t imm_j = ((int32_t)inst >> 31 << 20) | (inst >> 12 & 0xff) << 12 |
+                                (inst >> 20 & 1) << 11 | (inst >> 21 & 0x3ff) << 1;
+                pc += imm_j;
+            } else if (op == 0x67 || inst == 0x30200073) {
+                if (!bits.empty())
+                    return fail_at("jump with branches left");
+                pc = target;
+                return true;
+            } else {
+                pc += 4;
+            }
+        }
+        return true;
+    }
+};
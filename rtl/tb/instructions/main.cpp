@@ -19,6 +19,21 @@
 #define FG_GREEN "\033[32m"
 #define FG_RESET "\033[0m"
 
+// SB_AGE of rv32_core.sv
+#define SB_AGE 16
+
+// the Makefile builds the core as is, with FUSION=1 CFU=1 and with
+// SYNC_READ=1
+#ifndef FUSION
+#define FUSION 0
+#endif
+#ifndef CFU
+#define CFU 0
+#endif
+#ifndef SYNC_READ
+#define SYNC_READ 0
+#endif
+
 using namespace std;
 
 queue<function<void()>> pending_ops;
@@ -143,6 +158,8 @@ static void _ut_assert(bool eq, const char *expr, const char *file, int lineno)
 #define OPCODE_ESYS_CSR 0b1110011
 #define OPCODE_LOAD     0b0000011
 #define OPCODE_STORE    0b0100011
+#define OPCODE_AMO      0b0101111
+#define OPCODE_CUSTOM0  0b0001011
 
 #define OP_LUI(imm, rd) (U_TYPE_IMM(imm) | U_TYPE_RD(rd) | OPCODE_LUI)
 #define OP_AUIPC(imm, rd) (U_TYPE_IMM(imm) | U_TYPE_RD(rd) | OPCODE_AUIPC)
@@ -233,6 +250,19 @@ static void _ut_assert(bool eq, const char *expr, const char *file, int lineno)
 #define OP_CSRRCI(csr, zimm, rd) (I_TYPE_IMM(csr) | I_TYPE_RS1(zimm) | \
     I_TYPE_FN3(0b111) | I_TYPE_RD(rd) | OPCODE_ESYS_CSR)
 #define OP_NOP() OP_ADDI(0, 0, 0)
+#define OP_MRET() (R_TYPE_FN7(0b0011000) | R_TYPE_RS2(0b00010) | OPCODE_ESYS_CSR)
+#define OP_WFI() (R_TYPE_FN7(0b0001000) | R_TYPE_RS2(0b00101) | OPCODE_ESYS_CSR)
+#define OP_AMO_W(fn5, rs2, rs1, rd) (R_TYPE_FN7((fn5) << 2) | R_TYPE_RS2(rs2) | \
+    R_TYPE_RS1(rs1) | R_TYPE_FN3(0b010) | R_TYPE_RD(rd) | OPCODE_AMO)
+#define OP_LR_W(rs1, rd) OP_AMO_W(0b00010, 0, rs1, rd)
+#define OP_SC_W(rs2, rs1, rd) OP_AMO_W(0b00011, rs2, rs1, rd)
+#define OP_AMOSWAP_W(rs2, rs1, rd) OP_AMO_W(0b00001, rs2, rs1, rd)
+#define OP_AMOADD_W(rs2, rs1, rd) OP_AMO_W(0b00000, rs2, rs1, rd)
+#define OP_AMOAND_W(rs2, rs1, rd) OP_AMO_W(0b01100, rs2, rs1, rd)
+#define OP_AMOMIN_W(rs2, rs1, rd) OP_AMO_W(0b10000, rs2, rs1, rd)
+#define OP_AMOMAXU_W(rs2, rs1, rd) OP_AMO_W(0b11100, rs2, rs1, rd)
+#define OP_CUSTOM0(fn7, fn3, rs2, rs1, rd) (R_TYPE_FN7(fn7) | R_TYPE_RS2(rs2) | \
+    R_TYPE_RS1(rs1) | R_TYPE_FN3(fn3) | R_TYPE_RD(rd) | OPCODE_CUSTOM0)
 
 #define CSR_RDCYCLE    0xC00
 #define CSR_RDTIME     0xC01
@@ -240,6 +270,14 @@ static void _ut_assert(bool eq, const char *expr, const char *file, int lineno)
 #define CSR_RDCYCLEH   0xC80
 #define CSR_RDTIMEH    0xC81
 #define CSR_RDINSTRETH 0xC82
+#define CSR_MHARTID    0xF14
+#define CSR_MSTATUS    0x300
+#define CSR_MIE        0x304
+#define CSR_MTVEC      0x305
+#define CSR_MSCRATCH   0x340
+#define CSR_MEPC       0x341
+#define CSR_MCAUSE     0x342
+#define CSR_MIP        0x344
 
 static void grab_regs(struct registers &regs_val)
 {
@@ -278,6 +316,10 @@ static bool check_regs(const struct registers regs_val) {
 static void run_reset() {
     pending_ops.push([](){
         top->reset_n = 0;
+        top->ram_gnt = 1;
+        top->snoop_wr_en = 0;
+        top->ecall_ack = 0;
+        top->cfu_done = 0;
     });
 
     eval();
@@ -297,6 +339,22 @@ static void run_op(uint32_t val) {
     ut_assert(top->core_fault == 0);
 }
 
+// Run a pair from an aligned fetch, the second word comes in ram_fetch_hi
+static void run_op_pair(uint32_t val, uint32_t hi) {
+    pending_ops.push([val, hi](){
+        top->ram_data_out = val;
+        top->ram_fetch_hi = hi;
+    });
+
+    eval();
+    pending_ops.push([](){
+        top->ram_fetch_hi = 0;
+    });
+    ut_assert(!top->rootp->rv32_core__DOT__core_hault);
+    ut_assert(!top->ram_wr_en);
+    ut_assert(top->core_fault == 0);
+}
+
 static void run_op_w_read(uint32_t val, uint32_t exp_addr, uint32_t mem_val) {
     pending_ops.push([val](){
         top->ram_data_out = val;
@@ -321,13 +379,7 @@ static void run_op_w_read(uint32_t val, uint32_t exp_addr, uint32_t mem_val) {
     ut_assert(top->core_fault == 0);
 }
 
-static void run_op_w_write(uint32_t val, uint32_t exp_addr, uint8_t exp_wr_strobe, uint32_t exp_mem_val) {
-    pending_ops.push([val](){
-        top->ram_data_out = val;
-    });
-
-    eval();
-    ut_assert(top->rootp->rv32_core__DOT__core_hault);
+static void check_write(uint32_t exp_addr, uint8_t exp_wr_strobe, uint32_t exp_mem_val) {
     ut_assert(top->ram_wr_en);
 
     if (top->ram_wr_strobe != exp_wr_strobe) {
@@ -353,6 +405,16 @@ static void run_op_w_write(uint32_t val, uint32_t exp_addr, uint8_t exp_wr_strob
     }
     ut_assert(top->ram_addr << 2 == exp_addr);
     ut_assert(top->core_fault == 0);
+}
+
+static void run_op_w_write(uint32_t val, uint32_t exp_addr, uint8_t exp_wr_strobe, uint32_t exp_mem_val) {
+    pending_ops.push([val](){
+        top->ram_data_out = val;
+    });
+
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__core_hault);
+    check_write(exp_addr, exp_wr_strobe, exp_mem_val);
 
     eval();
     ut_assert(!top->rootp->rv32_core__DOT__core_hault);
@@ -360,6 +422,61 @@ static void run_op_w_write(uint32_t val, uint32_t exp_addr, uint8_t exp_wr_strob
     ut_assert(top->core_fault == 0);
 }
 
+// A store to ram retires into the store buffer, the fence after it is held
+// for one cycle while the buffer is written back
+static void run_op_w_buffered_write(uint32_t val, uint32_t exp_addr, uint8_t exp_wr_strobe, uint32_t exp_mem_val) {
+    run_op(val);
+    ut_assert(top->rootp->rv32_core__DOT__sb_count == 1);
+    pending_ops.push([](){
+        top->ram_data_out = OP_FENCE(0xf, 0xf);
+    });
+
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__sb_hold);
+    check_write(exp_addr, exp_wr_strobe, exp_mem_val);
+
+    eval();
+    ut_assert(!top->rootp->rv32_core__DOT__sb_hold);
+    ut_assert(top->rootp->rv32_core__DOT__sb_count == 0);
+    ut_assert(!top->ram_wr_en);
+    ut_assert(top->core_fault == 0);
+}
+
+static void run_op_w_amo(uint32_t val, uint32_t exp_addr, uint32_t mem_val, uint32_t exp_mem_val) {
+    pending_ops.push([val](){
+        top->ram_data_out = val;
+    });
+
+    // address phase
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__core_hault);
+    ut_assert(!top->ram_wr_en);
+    ut_assert(top->ram_addr << 2 == exp_addr);
+    ut_assert(top->ram_lock);
+    pending_ops.push([mem_val](){
+        top->ram_data_out = mem_val;
+    });
+
+    // read phase
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__core_hault);
+    ut_assert(top->ram_wr_en);
+    ut_assert(top->ram_wr_strobe == 0xf);
+    ut_assert(top->ram_addr << 2 == exp_addr);
+    if (top->ram_data_in != exp_mem_val) {
+        fprintf(stderr, "ram data 0x%x != expected 0x%x\n",
+                top->ram_data_in, exp_mem_val);
+    }
+    ut_assert(top->ram_data_in == exp_mem_val);
+    ut_assert(!top->ram_lock);
+
+    // write phase
+    eval();
+    ut_assert(!top->rootp->rv32_core__DOT__core_hault);
+    ut_assert(!top->ram_wr_en);
+    ut_assert(top->core_fault == 0);
+}
+
 static void test_lui() {
     struct registers regs;
 
@@ -705,6 +822,7 @@ static void test_arith_i() {
 
 static void test_fence_esys() {
     struct registers regs;
+    uint32_t pc;
 
     run_reset();
     grab_regs(regs);
@@ -715,8 +833,30 @@ static void test_fence_esys() {
     run_op(OP_FENCE_I());
     ut_assert(check_regs(regs));
 
+    // ecall waits off the bus until the host acks it with the a0 result
     run_op(OP_ECALL());
     ut_assert(check_regs(regs));
+    ut_assert(top->ecall_req);
+    ut_assert(!top->ram_req);
+    pc = top->rootp->rv32_core__DOT__pc;
+    run_op(OP_ADDI(1, 3, 3));
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc);
+    pending_ops.push([](){
+        top->ecall_ack = 1;
+        top->ecall_ret = 0xcafe;
+    });
+    run_op(OP_NOP());
+    pending_ops.push([](){
+        top->ecall_ack = 0;
+    });
+    ut_assert(!top->ecall_req);
+    regs.r10 = 0xcafe;
+    ut_assert(check_regs(regs));
+    run_op(OP_ADDI(1, 3, 3));
+    regs.r3 += 1;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 4);
 
     run_op(OP_EBREAK());
     ut_assert(check_regs(regs));
@@ -794,6 +934,238 @@ static void test_csr() {
     ut_assert(regs.r2  == 0);
 
     fprintf(stderr, FG_GREEN "RDINSTRET tests passed!\n" FG_RESET);
+
+    run_op(OP_CSRRS(CSR_MHARTID, 0, 2));
+    grab_regs(regs);
+    ut_assert(regs.r2 == 0);
+
+    fprintf(stderr, FG_GREEN "MHARTID tests passed!\n" FG_RESET);
+}
+
+static void test_irq() {
+    struct registers regs;
+    uint32_t pc;
+    uint64_t cycle;
+
+    run_reset();
+    grab_regs(regs);
+
+    regs.r1 = 0x12345678;
+    set_regs(regs);
+    run_op(OP_CSRRW(CSR_MSCRATCH, 1, 0));
+    run_op(OP_CSRRS(CSR_MSCRATCH, 0, 2));
+    regs.r2 = 0x12345678;
+    ut_assert(check_regs(regs));
+
+    // only direct mode, the mode bits read back as zero
+    regs.r1 = 0x1003;
+    set_regs(regs);
+    run_op(OP_CSRRW(CSR_MTVEC, 1, 2));
+    regs.r2 = 0;
+    ut_assert(check_regs(regs));
+    run_op(OP_CSRRS(CSR_MTVEC, 0, 2));
+    regs.r2 = 0x1000;
+    ut_assert(check_regs(regs));
+
+    // only the implemented enables stick
+    regs.r1 = 0xffffffff;
+    set_regs(regs);
+    run_op(OP_CSRRS(CSR_MIE, 1, 0));
+    run_op(OP_CSRRC(CSR_MIE, 0, 2));
+    regs.r2 = 0x888;
+    ut_assert(check_regs(regs));
+    run_op(OP_CSRRCI(CSR_MIE, 0x8, 0));
+    run_op(OP_CSRRS(CSR_MIE, 0, 2));
+    regs.r2 = 0x880;
+    ut_assert(check_regs(regs));
+
+    fprintf(stderr, FG_GREEN "machine csr tests passed!\n" FG_RESET);
+
+    // pending but globally disabled interrupts are not taken
+    pending_ops.push([](){
+        top->timer_irq = 1;
+    });
+    pc = top->rootp->rv32_core__DOT__pc;
+    run_op(OP_ADDI(1, 3, 3));
+    regs.r3 += 1;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 4);
+    run_op(OP_CSRRS(CSR_MIP, 0, 2));
+    regs.r2 = 0x80;
+    ut_assert(check_regs(regs));
+
+    // enabling them traps in place of the next instruction
+    run_op(OP_CSRRSI(CSR_MSTATUS, 0x8, 0));
+    pc = top->rootp->rv32_core__DOT__pc;
+    run_op(OP_ADDI(1, 3, 3));
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == 0x1000);
+    pending_ops.push([](){
+        top->timer_irq = 0;
+    });
+    run_op(OP_CSRRS(CSR_MEPC, 0, 2));
+    run_op(OP_CSRRS(CSR_MCAUSE, 0, 4));
+    run_op(OP_CSRRS(CSR_MSTATUS, 0, 5));
+    regs.r2 = pc;
+    regs.r4 = 0x80000007;
+    regs.r5 = 0x1880;
+    ut_assert(check_regs(regs));
+
+    run_op(OP_MRET());
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc);
+    run_op(OP_CSRRS(CSR_MSTATUS, 0, 5));
+    regs.r5 = 0x1888;
+    ut_assert(check_regs(regs));
+
+    fprintf(stderr, FG_GREEN "trap tests passed!\n" FG_RESET);
+
+    // wfi parks the core until an enabled interrupt is pending
+    run_op(OP_WFI());
+    pc = top->rootp->rv32_core__DOT__pc;
+    ut_assert(top->sleep);
+    ut_assert(!top->ram_req);
+    for (int i = 0; i < 4; i++) {
+        run_op(OP_ADDI(1, 3, 3));
+    }
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc);
+
+    // skipped idle cycles still count
+    cycle = top->rootp->rv32_core__DOT__rdcycle;
+    pending_ops.push([](){
+        top->time_skip = 100;
+    });
+    run_op(OP_NOP());
+    pending_ops.push([](){
+        top->time_skip = 0;
+    });
+    ut_assert(top->rootp->rv32_core__DOT__rdcycle == cycle + 101);
+
+    // the external interrupt wins over the timer
+    pending_ops.push([](){
+        top->ext_irq = 1;
+        top->timer_irq = 1;
+    });
+    run_op(OP_NOP());
+    ut_assert(!top->sleep);
+    run_op(OP_ADDI(1, 3, 3));
+    ut_assert(top->rootp->rv32_core__DOT__pc == 0x1000);
+    pending_ops.push([](){
+        top->ext_irq = 0;
+        top->timer_irq = 0;
+    });
+    run_op(OP_CSRRS(CSR_MEPC, 0, 2));
+    run_op(OP_CSRRS(CSR_MCAUSE, 0, 4));
+    regs.r2 = pc;
+    regs.r4 = 0x8000000b;
+    ut_assert(check_regs(regs));
+
+    // with something already pending wfi falls straight through
+    pending_ops.push([](){
+        top->soft_irq = 1;
+    });
+    run_op(OP_CSRRSI(CSR_MIE, 0x8, 0));
+    run_op(OP_WFI());
+    ut_assert(!top->sleep);
+    pending_ops.push([](){
+        top->soft_irq = 0;
+    });
+    run_op(OP_NOP());
+
+    fprintf(stderr, FG_GREEN "wfi tests passed!\n" FG_RESET);
+}
+
+static void test_amo() {
+    struct registers regs;
+
+    run_reset();
+    grab_regs(regs);
+
+    // LR/SC pair succeeds
+    regs.r1 = 0x70000e10;
+    regs.r3 = 0xcafef00d;
+    set_regs(regs);
+    run_op_w_read(OP_LR_W(1, 2), 0xe10, 0x12345678);
+    regs.r2 = 0x12345678;
+    ut_assert(check_regs(regs));
+    run_op_w_write(OP_SC_W(3, 1, 4), 0xe10, 0xf, 0xcafef00d);
+    regs.r4 = 0;
+    ut_assert(check_regs(regs));
+
+    // the SC consumed the reservation
+    run_op(OP_SC_W(3, 1, 4));
+    regs.r4 = 1;
+    ut_assert(check_regs(regs));
+
+    // SC to a different address than the reservation fails
+    run_op_w_read(OP_LR_W(1, 2), 0xe10, 0x12345678);
+    regs.r5 = 0x70000e14;
+    set_regs(regs);
+    run_op(OP_SC_W(3, 5, 4));
+    ut_assert(check_regs(regs));
+
+    // a write from another hart breaks the reservation
+    run_op_w_read(OP_LR_W(1, 2), 0xe10, 0x12345678);
+    pending_ops.push([](){
+        top->snoop_wr_en = 1;
+        top->snoop_addr = 0xe10 >> 2;
+    });
+    run_op(OP_NOP());
+    pending_ops.push([](){
+        top->snoop_wr_en = 0;
+    });
+    run_op(OP_SC_W(3, 1, 4));
+    regs.r4 = 1;
+    ut_assert(check_regs(regs));
+
+    // ... but a write elsewhere does not
+    run_op_w_read(OP_LR_W(1, 2), 0xe10, 0x12345678);
+    pending_ops.push([](){
+        top->snoop_wr_en = 1;
+        top->snoop_addr = 0xe14 >> 2;
+    });
+    run_op(OP_NOP());
+    pending_ops.push([](){
+        top->snoop_wr_en = 0;
+    });
+    run_op_w_write(OP_SC_W(3, 1, 4), 0xe10, 0xf, 0xcafef00d);
+    regs.r4 = 0;
+    ut_assert(check_regs(regs));
+
+    fprintf(stderr, FG_GREEN "lr/sc tests passed!\n" FG_RESET);
+
+    regs.r3 = 5;
+    set_regs(regs);
+    run_op_w_amo(OP_AMOADD_W(3, 1, 2), 0xe10, 0x10, 0x15);
+    regs.r2 = 0x10;
+    ut_assert(check_regs(regs));
+
+    run_op_w_amo(OP_AMOSWAP_W(3, 1, 2), 0xe10, 0x10, 0x5);
+    ut_assert(check_regs(regs));
+
+    regs.r3 = 0xf0f0;
+    set_regs(regs);
+    run_op_w_amo(OP_AMOAND_W(3, 1, 2), 0xe10, 0xff00, 0xf000);
+    regs.r2 = 0xff00;
+    ut_assert(check_regs(regs));
+
+    regs.r3 = -5;
+    set_regs(regs);
+    run_op_w_amo(OP_AMOMIN_W(3, 1, 2), 0xe10, 3, -5);
+    regs.r2 = 3;
+    ut_assert(check_regs(regs));
+
+    run_op_w_amo(OP_AMOMAXU_W(3, 1, 2), 0xe10, 3, -5);
+    ut_assert(check_regs(regs));
+
+    // rd and rs2 the same register, the old rs2 value is used for the write
+    regs.r3 = 7;
+    set_regs(regs);
+    run_op_w_amo(OP_AMOADD_W(3, 1, 3), 0xe10, 0x20, 0x27);
+    regs.r3 = 0x20;
+    ut_assert(check_regs(regs));
+
+    fprintf(stderr, FG_GREEN "amo tests passed!\n" FG_RESET);
 }
 
 static void test_load() {
@@ -934,50 +1306,255 @@ static void test_store() {
     regs.r1 = 0x70000e00;
     regs.r2 = 0x1234abcd;
     set_regs(regs);
-    run_op_w_write(OP_SW(0x10, 2, 1), 0xe10, 0xf, 0x1234abcd);
+    run_op_w_buffered_write(OP_SW(0x10, 2, 1), 0xe10, 0xf, 0x1234abcd);
     ut_assert(check_regs(regs));
 
     // 16-bit store
     regs.r1 = 0x70000e00;
     regs.r2 = 0x1234abcd;
     set_regs(regs);
-    run_op_w_write(OP_SH(0x10, 2, 1), 0xe10, 0x3, 0xabcd);
+    run_op_w_buffered_write(OP_SH(0x10, 2, 1), 0xe10, 0x3, 0xabcd);
     ut_assert(check_regs(regs));
 
     regs.r1 = 0x70000e00;
     regs.r2 = 0x1234abcd;
     set_regs(regs);
-    run_op_w_write(OP_SH(0x12, 2, 1), 0xe10, 0xc, 0xabcd0000);
+    run_op_w_buffered_write(OP_SH(0x12, 2, 1), 0xe10, 0xc, 0xabcd0000);
     ut_assert(check_regs(regs));
 
     // 8-bit store
     regs.r1 = 0x70000e00;
     regs.r2 = 0x1234abcd;
     set_regs(regs);
-    run_op_w_write(OP_SB(0x10, 2, 1), 0xe10, 0x1, 0xcd);
+    run_op_w_buffered_write(OP_SB(0x10, 2, 1), 0xe10, 0x1, 0xcd);
     ut_assert(check_regs(regs));
 
     regs.r1 = 0x70000e00;
     regs.r2 = 0x1234abcd;
     set_regs(regs);
-    run_op_w_write(OP_SB(0x11, 2, 1), 0xe10, 0x2, 0xcd00);
+    run_op_w_buffered_write(OP_SB(0x11, 2, 1), 0xe10, 0x2, 0xcd00);
     ut_assert(check_regs(regs));
 
     regs.r1 = 0x70000e00;
     regs.r2 = 0x1234abcd;
     set_regs(regs);
-    run_op_w_write(OP_SB(0x12, 2, 1), 0xe10, 0x4, 0xcd0000);
+    run_op_w_buffered_write(OP_SB(0x12, 2, 1), 0xe10, 0x4, 0xcd0000);
     ut_assert(check_regs(regs));
 
     regs.r1 = 0x70000e00;
     regs.r2 = 0x1234abcd;
     set_regs(regs);
-    run_op_w_write(OP_SB(0x13, 2, 1), 0xe10, 0x8, 0xcd000000);
+    run_op_w_buffered_write(OP_SB(0x13, 2, 1), 0xe10, 0x8, 0xcd000000);
     ut_assert(check_regs(regs));
 
     fprintf(stderr, FG_GREEN "store tests passed!\n" FG_RESET);
 }
 
+static void test_store_buffer() {
+    struct registers regs;
+    uint32_t pc;
+
+    run_reset();
+    grab_regs(regs);
+
+    // loads the buffer covers are forwarded without a data cycle
+    regs.r1 = 0x70000e00;
+    regs.r2 = 0x1234abcd;
+    regs.r3 = 0x55;
+    set_regs(regs);
+    run_op(OP_SW(0x10, 2, 1));
+    run_op(OP_LW(0x10, 1, 4));
+    regs.r4 = 0x1234abcd;
+    ut_assert(check_regs(regs));
+    run_op(OP_LB(0x11, 1, 5));
+    regs.r5 = 0xffffffab;
+    ut_assert(check_regs(regs));
+
+    // a store to the word of the youngest entry merges into it
+    run_op(OP_SB(0x11, 3, 1));
+    ut_assert(top->rootp->rv32_core__DOT__sb_count == 1);
+    run_op(OP_LW(0x10, 1, 4));
+    regs.r4 = 0x123455cd;
+    ut_assert(check_regs(regs));
+
+    // a load the buffer only partly covers waits for the entries to drain in
+    // order, then reads the ram
+    run_op(OP_SB(0x14, 3, 1));
+    ut_assert(top->rootp->rv32_core__DOT__sb_count == 2);
+    pc = top->rootp->rv32_core__DOT__pc;
+    pending_ops.push([](){
+        top->ram_data_out = OP_LW(0x14, 1, 6);
+    });
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__sb_hold);
+    check_write(0xe10, 0xf, 0x123455cd);
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__sb_hold);
+    check_write(0xe14, 0x1, 0x55);
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc);
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__core_hault);
+    ut_assert(!top->ram_wr_en);
+    ut_assert(top->ram_addr << 2 == 0xe14);
+    pending_ops.push([](){
+        top->ram_data_out = 0xaabbcc55;
+    });
+    eval();
+    ut_assert(!top->rootp->rv32_core__DOT__core_hault);
+    regs.r6 = 0xaabbcc55;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 4);
+
+    // an entry left alone is written back once it waited SB_AGE cycles
+    run_op(OP_SW(0x18, 2, 1));
+    for (int i = 0; i < SB_AGE; i++)
+        run_op(OP_NOP());
+    pending_ops.push([](){
+        top->ram_data_out = OP_NOP();
+    });
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__sb_hold);
+    check_write(0xe18, 0xf, 0x1234abcd);
+    run_op(OP_NOP());
+    ut_assert(top->rootp->rv32_core__DOT__sb_count == 0);
+
+    // the mailbox page the host polls is written through like the
+    // peripherals, the store goes to the port on its own core_hault cycle
+    regs.r7 = 0x1f000;
+    set_regs(regs);
+    run_op_w_write(OP_SW(0x8, 2, 7), 0x1f008, 0xf, 0x1234abcd);
+    ut_assert(top->rootp->rv32_core__DOT__sb_count == 0);
+
+    fprintf(stderr, FG_GREEN "store buffer tests passed!\n" FG_RESET);
+}
+
+// Only in the FUSION=1 build, the other tests never fuse there as
+// ram_fetch_hi stays 0
+#if FUSION
+static void test_fusion() {
+    struct registers regs;
+    uint32_t pc;
+
+    run_reset();
+    grab_regs(regs);
+
+    // lui + addi, the addi immediate is sign extended
+    pc = top->rootp->rv32_core__DOT__pc;
+    run_op_pair(OP_LUI(0x12345000, 1), OP_ADDI(0xfff, 1, 1));
+    regs.r1 = 0x12344fff;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 8);
+    ut_assert(top->rootp->rv32_core__DOT__fuse_count[0] == 1);
+
+    // auipc + jalr, a far call linking past the pair
+    pc = top->rootp->rv32_core__DOT__pc;
+    run_op_pair(OP_AUIPC(0x1000, 1), OP_JALR(0x10, 1, 1));
+    regs.r1 = pc + 8;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 0x1010);
+    ut_assert(top->rootp->rv32_core__DOT__fuse_count[1] == 1);
+
+    // slli + srli zero extension
+    regs.r2 = 0xdeadbeef;
+    set_regs(regs);
+    pc = top->rootp->rv32_core__DOT__pc;
+    run_op_pair(OP_SLLI(16, 2, 3), OP_SRLI(16, 3, 3));
+    regs.r3 = 0xbeef;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 8);
+    ut_assert(top->rootp->rv32_core__DOT__fuse_count[2] == 1);
+
+    // the second word of a pair starting at an odd word is not fetched, the
+    // first half runs alone
+    run_op(OP_NOP());
+    pc = top->rootp->rv32_core__DOT__pc;
+    run_op_pair(OP_SLLI(16, 2, 3), OP_SRAI(16, 3, 3));
+    regs.r3 = 0xbeef0000;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 4);
+    ut_assert(top->rootp->rv32_core__DOT__fuse_count[2] == 1);
+    run_op(OP_SRAI(16, 3, 3));
+    regs.r3 = 0xffffbeef;
+    ut_assert(check_regs(regs));
+
+    // addi + bne loop tail, taken back to the pair and then falling through
+    regs.r4 = 2;
+    set_regs(regs);
+    pc = top->rootp->rv32_core__DOT__pc;
+    run_op_pair(OP_ADDI(-1, 4, 4), OP_BNE(-4, 0, 4));
+    regs.r4 = 1;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc);
+    run_op_pair(OP_ADDI(-1, 4, 4), OP_BNE(-4, 0, 4));
+    regs.r4 = 0;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 8);
+    ut_assert(top->rootp->rv32_core__DOT__fuse_count[3] == 2);
+
+    fprintf(stderr, FG_GREEN "fusion tests passed!\n" FG_RESET);
+}
+#endif
+
+// Only in the CFU=1 build, the tb plays the accelerator itself
+#if CFU
+static void test_cfu() {
+    struct registers regs;
+    uint32_t pc;
+
+    run_reset();
+    grab_regs(regs);
+
+    // done on the start cycle retires right away
+    regs.r1 = 6;
+    regs.r2 = 7;
+    set_regs(regs);
+    pc = top->rootp->rv32_core__DOT__pc;
+    pending_ops.push([](){
+        top->cfu_done = 1;
+        top->cfu_result = 42;
+    });
+    run_op(OP_CUSTOM0(0x15, 2, 2, 1, 3));
+    regs.r3 = 42;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 4);
+
+    // a multi cycle operation holds the instruction, the operands stay on
+    // the port and start is not repeated
+    pc = top->rootp->rv32_core__DOT__pc;
+    pending_ops.push([](){
+        top->ram_data_out = OP_CUSTOM0(0x15, 1, 1, 2, 4);
+        top->cfu_done = 0;
+    });
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__sb_hold);
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc);
+    ut_assert(!top->cfu_start);
+    ut_assert(top->cfu_func == (0x15 << 3 | 1));
+    ut_assert(top->cfu_rs1 == 7);
+    ut_assert(top->cfu_rs2 == 6);
+    pending_ops.push([](){
+        top->ram_data_out = OP_NOP();
+    });
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc);
+    pending_ops.push([](){
+        top->cfu_done = 1;
+        top->cfu_result = 0x1234;
+    });
+    eval();
+    regs.r4 = 0x1234;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 4);
+    pending_ops.push([](){
+        top->cfu_done = 0;
+    });
+    run_op(OP_NOP());
+    ut_assert(check_regs(regs));
+
+    fprintf(stderr, FG_GREEN "cfu tests passed!\n" FG_RESET);
+}
+#endif
+
 static void test_jal() {
     struct registers regs;
     uint32_t pc;
@@ -1298,7 +1875,94 @@ static void test_bxx() {
     fprintf(stderr, FG_GREEN "bxx tests passed!\n" FG_RESET);
 }
 
+// Only in the SYNC_READ=1 build, the other tests expect an instruction a
+// cycle. Each instruction and each core_hault cycle takes an address, a
+// decode and an execute cycle, with the port locked and its address held
+// until the execute cycle.
+#if SYNC_READ
+static void sync_phases(uint32_t addr) {
+    uint64_t instret = top->rootp->rv32_core__DOT__rdinstret;
+    uint32_t pc = top->rootp->rv32_core__DOT__pc;
+
+    for (int phase = 0; phase < 2; phase++) {
+        ut_assert(top->rootp->rv32_core__DOT__phase == phase);
+        ut_assert(top->ram_lock);
+        ut_assert(!top->ram_wr_en);
+        ut_assert(top->ram_addr << 2 == addr);
+        eval();
+        ut_assert(top->rootp->rv32_core__DOT__pc == pc);
+        ut_assert(top->rootp->rv32_core__DOT__rdinstret == instret);
+    }
+    ut_assert(top->rootp->rv32_core__DOT__phase == 2);
+    ut_assert(top->ram_addr << 2 == addr);
+}
+
+static void test_sync_read() {
+    struct registers regs;
+    uint32_t pc;
+
+    run_reset();
+    grab_regs(regs);
+    pc = top->rootp->rv32_core__DOT__pc;
+
+    // an add reads its operands on the decode cycle and writes on execute
+    regs.r1 = 5;
+    regs.r2 = 7;
+    regs.r7 = 0x1f000;
+    set_regs(regs);
+    pending_ops.push([](){
+        top->ram_data_out = OP_ADD(2, 1, 3);
+    });
+    sync_phases(pc);
+    eval();
+    regs.r3 = 12;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 4);
+    ut_assert(top->core_fault == 0);
+
+    // a load goes through the phases twice, for the instruction and for
+    // the data word
+    pending_ops.push([](){
+        top->ram_data_out = OP_LW(0x8, 7, 4);
+    });
+    sync_phases(pc + 4);
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__core_hault);
+    pending_ops.push([](){
+        top->ram_data_out = 0xfeedf00d;
+    });
+    sync_phases(0x1f008);
+    eval();
+    ut_assert(!top->rootp->rv32_core__DOT__core_hault);
+    regs.r4 = 0xfeedf00d;
+    ut_assert(check_regs(regs));
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 8);
+
+    // a write through store fires once, on the execute cycle of its
+    // core_hault
+    pending_ops.push([](){
+        top->ram_data_out = OP_SW(0xc, 2, 7);
+    });
+    sync_phases(pc + 8);
+    eval();
+    ut_assert(top->rootp->rv32_core__DOT__core_hault);
+    sync_phases(0x1f00c);
+    check_write(0x1f00c, 0xf, 7);
+    eval();
+    ut_assert(!top->rootp->rv32_core__DOT__core_hault);
+    ut_assert(!top->ram_wr_en);
+    ut_assert(top->rootp->rv32_core__DOT__pc == pc + 12);
+    ut_assert(top->rootp->rv32_core__DOT__sb_count == 0);
+    ut_assert(top->core_fault == 0);
+
+    fprintf(stderr, FG_GREEN "sync read tests passed!\n" FG_RESET);
+}
+#endif
+
 static void run_sim() {
+#if SYNC_READ
+    test_sync_read();
+#else
     test_lui();
     test_auipc();
     test_jal();
@@ -1310,6 +1974,16 @@ static void run_sim() {
     test_csr();
     test_load();
     test_store();
+    test_store_buffer();
+#if FUSION
+    test_fusion();
+#endif
+#if CFU
+    test_cfu();
+#endif
+    test_amo();
+    test_irq();
+#endif
 }
 
 int main(int argc, const char **argv) {
@@ -1335,6 +2009,7 @@ int main(int argc, const char **argv) {
         delete tfp;
         delete top;
         delete ctx;
+        return 1;
     }
     return 0;
 }
\ No newline at end of file
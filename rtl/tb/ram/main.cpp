@@ -1,6 +1,10 @@
 #include "Vram.h"
 #include "verilated.h"
 #include "verilated_vcd_c.h"
+#ifdef RAM_DPI
+#include "ram_dpi.h"
+#endif
+#include "../sim_task.h"
 
 #include <functional>
 #include <queue>
@@ -8,6 +12,11 @@
 #include <fstream>
 #include <string>
 
+#define AGENT_WORDS 64
+#define AGENT_BASE 0x200
+// enough child calls to run the 64 KiB arena dry if frames leaked
+#define AGENT_ROUNDS 2048
+
 #define FG_RED "\033[31m"
 #define FG_GREEN "\033[32m"
 #define FG_RESET "\033[0m"
@@ -32,6 +41,10 @@ static void _ut_assert(bool eq, const char *expr, const char *file, int lineno)
 VerilatedContext *ctx;
 Vram *top;
 VerilatedVcdC *tfp;
+#ifdef RAM_DPI
+svScope ram_scope;
+#endif
+sim_scheduler sched;
 
 static void eval()
 {
@@ -145,6 +158,158 @@ void mem_test() {
     ut_assert(top->b_data_out == 0xaaaaaaaa);
 }
 
+#ifdef RAM_DPI
+// Only written pages take host memory, the rest reads as zero
+void sparse_test() {
+    size_t pages = ram_dpi_pages(ram_scope);
+
+    pending_ops.push([](){
+        top->a_wr_en = 0;
+        top->b_wr_en = 0;
+        top->b_addr = 0x8000;
+    });
+    eval();
+    ut_assert(top->b_data_out == 0);
+    ut_assert(ram_dpi_pages(ram_scope) == pages);
+    pending_ops.push([](){
+        top->a_wr_en = 1;
+        top->a_addr = 0xfff0;
+        top->a_data_in = 0x5a5a5a5a;
+    });
+    eval();
+    pending_ops.push([](){
+        top->a_wr_en = 0;
+    });
+    eval();
+    ut_assert(top->a_data_out == 0x5a5a5a5a);
+    ut_assert(ram_dpi_pages(ram_scope) == pages + 1);
+    // a backdoor poke shows up once the port moves to it
+    ram_dpi_poke(ram_scope, 0x8001, 0x600df00d);
+    pending_ops.push([](){
+        top->b_addr = 0x8001;
+    });
+    eval();
+    ut_assert(top->b_data_out == 0x600df00d);
+}
+
+// A second model has a page table of its own, neither sees the other's writes
+void sparse_instances_test() {
+    Vram other{ctx, "other"};
+    svScope other_scope = svGetScopeFromName("other.ram_dpi");
+
+    ut_assert(other_scope != nullptr && other_scope != ram_scope);
+    ut_assert(ram_dpi_pages(other_scope) == 0);
+    ut_assert(ram_dpi_peek(other_scope, 0x8001) == 0);
+
+    other.a_wr_strobe = 0xf;
+    other.a_wr_en = 1;
+    other.a_addr = 0x8001;
+    other.a_data_in = 0x0badcafe;
+    other.clk = 0;
+    other.eval();
+    other.clk = 1;
+    other.eval();
+    other.a_wr_en = 0;
+    other.clk = 0;
+    other.eval();
+    ut_assert(other.a_data_out == 0x0badcafe);
+    ut_assert(ram_dpi_peek(other_scope, 0x8001) == 0x0badcafe);
+    ut_assert(ram_dpi_peek(ram_scope, 0x8001) == 0x600df00d);
+    ut_assert(ram_dpi_pages(other_scope) == 1);
+
+    ram_dpi_release(other_scope);
+}
+#endif
+
+// Clock the model until every spawned agent returned
+static void run_agents()
+{
+    while (!sched.idle()) {
+        pending_ops.push([](){ sched.tick(); });
+        eval();
+    }
+}
+
+static uint32_t agent_pattern(int i)
+{
+    return 0x9e3779b9u * (i + 1);
+}
+
+// words port A has written so far, port B reads behind it
+static int written;
+
+static sim_task a_write(uint32_t addr, uint32_t data)
+{
+    top->a_wr_en = 1;
+    top->a_addr = addr;
+    top->a_data_in = data;
+    co_await sched.clock();
+    top->a_wr_en = 0;
+}
+
+static sim_task a_writer()
+{
+    for (int i = 0; i < AGENT_WORDS; i++) {
+        co_await a_write(AGENT_BASE + i, agent_pattern(i));
+        written++;
+        // let the reader catch up now and then
+        if (i % 8 == 7)
+            co_await sched.clock(3);
+    }
+}
+
+static sim_task b_reader()
+{
+    top->b_wr_en = 0;
+    for (int i = 0; i < AGENT_WORDS; i++) {
+        co_await sched.until([i]{ return written > i; });
+        top->b_addr = AGENT_BASE + i;
+        co_await sched.clock();
+        ut_assert(top->b_data_out == agent_pattern(i));
+    }
+}
+
+// Both ports at once, each driven by its own agent
+void concurrent_test() {
+    written = 0;
+    sched.spawn(a_writer());
+    sched.spawn(b_reader());
+    run_agents();
+    ut_assert(written == AGENT_WORDS);
+    ut_assert(sched.frames() == 0);
+}
+
+static sim_task b_check(uint32_t addr, uint32_t expect)
+{
+    top->b_addr = addr;
+    co_await sched.clock();
+    ut_assert(top->b_data_out == expect);
+}
+
+static sim_task a_rewriter()
+{
+    for (int r = 0; r < AGENT_ROUNDS; r++)
+        co_await a_write(AGENT_BASE + AGENT_WORDS + r % AGENT_WORDS, agent_pattern(r));
+}
+
+static sim_task b_checker()
+{
+    top->b_wr_en = 0;
+    for (int r = 0; r < AGENT_ROUNDS; r++)
+        co_await b_check(AGENT_BASE + r % AGENT_WORDS, agent_pattern(r % AGENT_WORDS));
+}
+
+// Two agents calling children every cycle, so the child frames of one are
+// released while the other's sit above them in the arena. None of them may
+// end up on the heap.
+void children_test() {
+    sched.spawn(a_rewriter());
+    sched.spawn(b_checker());
+    run_agents();
+    ut_assert(sched.frames() == 0);
+    ut_assert(sched.heap_frames() == 0);
+}
+
 void load_file(string f_name) {
     string line;
     ifstream infile;
@@ -187,6 +352,9 @@ int main(int argc, const char **argv)
     ctx = new VerilatedContext;
     ctx->commandArgs(argc, argv);
     top = new Vram{ctx};
+#ifdef RAM_DPI
+    ram_scope = svGetScopeFromName("TOP.ram_dpi");
+#endif
     Verilated::traceEverOn(true);
     tfp = new VerilatedVcdC;
     top->trace(tfp, 99);
@@ -195,6 +363,12 @@ int main(int argc, const char **argv)
     try {
         run_sim();
         mem_test();
+#ifdef RAM_DPI
+        sparse_test();
+        sparse_instances_test();
+#endif
+        concurrent_test();
+        children_test();
         load_file("../../../src/build/test.dhex");
         tfp->close();
         delete tfp;
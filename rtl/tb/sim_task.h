@@ -0,0 +1,276 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Coroutine agents for the testbenches. A sim_task drives or watches the
+// model as straight-line code and gives up the clock with
+// `co_await sched.clock()` or `co_await sched.until(pred)`. The testbench
+// calls sim_scheduler::tick() once per clock, from the pending_ops slot
+// right after the posedge, so a task sees the outputs of that edge and the
+// inputs it sets are sampled on the next one.
+//
+// Frames come from an arena: a bump pointer, with a free list per frame
+// size for the frames that do not finish in the order they started. A task
+// calling other tasks every cycle stays off the heap, however the tasks
+// interleave.
+class sim_arena {
+public:
+    explicit sim_arena(size_t size) : base(new std::byte[size]), size(size) {}
+    ~sim_arena() { delete[] base; }
+
+    void *allocate(size_t bytes)
+    {
+        size_t slot = (bytes + 15) / 16;
+
+        if (slot < free_lists.size() && free_lists[slot]) {
+            void *p = free_lists[slot];
+            free_lists[slot] = *(void **)p;
+            frames++;
+            return p;
+        }
+        bytes = slot * 16;
+        if (used + bytes > size) {
+            spills++;
+            return ::operator new(bytes);
+        }
+        void *p = base + used;
+        used += bytes;
+        frames++;
+        return p;
+    }
+
+    void release(void *p, size_t bytes)
+    {
+        size_t slot = (bytes + 15) / 16;
+
+        if (p < base || p >= base + size) {
+            ::operator delete(p);
+            return;
+        }
+        bytes = slot * 16;
+        if (--frames == 0) {
+            // everything is back, start over from the bottom
+            used = 0;
+            free_lists.assign(free_lists.size(), nullptr);
+            return;
+        }
+        // the most recent frame is common, a child task returning
+        if ((std::byte *)p + bytes == base + used) {
+            used -= bytes;
+            return;
+        }
+        if (slot >= free_lists.size())
+            free_lists.resize(slot + 1, nullptr);
+        *(void **)p = free_lists[slot];
+        free_lists[slot] = p;
+    }
+
+    size_t live() const { return frames; }
+    // frames that did not fit and went to the heap
+    size_t heap_frames() const { return spills; }
+
+    // where new frames go, set by the scheduler
+    static inline sim_arena *current = nullptr;
+
+private:
+    std::byte *base;
+    size_t size;
+    size_t used = 0;
+    size_t frames = 0;
+    size_t spills = 0;
+    // released frames below the bump pointer, by size in 16 byte units,
+    // linked through their first word
+    std::vector<void *> free_lists;
+};
+
+class sim_task {
+public:
+    struct promise_type {
+        std::coroutine_handle<> parent;
+        std::exception_ptr error;
+        // where a spawned task reports that it ran off its end
+        std::vector<std::coroutine_handle<promise_type>> *finished = nullptr;
+
+        sim_task get_return_object()
+        {
+            return sim_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        // hand the thread straight back to the task that awaited us
+        struct final_awaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+            {
+                if (h.promise().parent)
+                    return h.promise().parent;
+                h.promise().finished->push_back(h);
+                return std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+
+        final_awaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+
+        static void *operator new(size_t bytes)
+        {
+            if (sim_arena::current)
+                return sim_arena::current->allocate(bytes);
+            return ::operator new(bytes);
+        }
+
+        static void operator delete(void *p, size_t bytes)
+        {
+            if (sim_arena::current)
+                sim_arena::current->release(p, bytes);
+            else
+                ::operator delete(p);
+        }
+    };
+
+    sim_task(sim_task &&other) noexcept : h(std::exchange(other.h, nullptr)) {}
+    sim_task(const sim_task &) = delete;
+    ~sim_task()
+    {
+        if (h)
+            h.destroy();
+    }
+
+    // `co_await child()` runs the child until it finishes, failed ut_asserts
+    // in it come out of the co_await
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+    {
+        h.promise().parent = caller;
+        return h;
+    }
+    void await_resume()
+    {
+        if (h.promise().error)
+            std::rethrow_exception(h.promise().error);
+    }
+
+private:
+    friend class sim_scheduler;
+
+    explicit sim_task(std::coroutine_handle<promise_type> h) : h(h) {}
+
+    std::coroutine_handle<promise_type> h;
+};
+
+class sim_scheduler {
+public:
+    explicit sim_scheduler(size_t arena_size = 64 * 1024) : arena(arena_size)
+    {
+        sim_arena::current = &arena;
+    }
+
+    ~sim_scheduler()
+    {
+        if (sim_arena::current == &arena)
+            sim_arena::current = nullptr;
+    }
+
+    // Start a task on the next tick, the scheduler owns it from now on
+    void spawn(sim_task task)
+    {
+        task.h.promise().finished = &finished;
+        wait.push_back({std::exchange(task.h, nullptr), cycle + 1, nullptr, nullptr});
+        roots++;
+    }
+
+    // Resume after n more ticks
+    auto clock(uint64_t n = 1)
+    {
+        struct awaiter {
+            sim_scheduler &s;
+            uint64_t n;
+            bool await_ready() const noexcept { return n == 0; }
+            void await_suspend(std::coroutine_handle<> h) { s.wait.push_back({h, s.cycle + n, nullptr, nullptr}); }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{*this, n};
+    }
+
+    // Resume on the first tick pred() holds, checked from the next one on.
+    // The predicate lives in the waiting frame, nothing is allocated.
+    template <typename Pred>
+    auto until(Pred pred)
+    {
+        struct awaiter {
+            sim_scheduler &s;
+            Pred pred;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                s.wait.push_back({h, s.cycle + 1, [](void *p){ return (*(Pred *)p)(); }, &pred});
+            }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{*this, std::move(pred)};
+    }
+
+    // Resume every task that is due, call once per clock
+    void tick()
+    {
+        cycle++;
+        ready.swap(wait);
+        for (size_t i = 0; i < ready.size(); i++) {
+            waiter &w = ready[i];
+
+            if (w.due > cycle || (w.check && !w.check(w.ctx))) {
+                wait.push_back(w);
+                continue;
+            }
+            w.h.resume();
+            reap();
+        }
+        ready.clear();
+    }
+
+    bool idle() const { return roots == 0; }
+    uint64_t now() const { return cycle; }
+    size_t frames() const { return arena.live(); }
+    size_t heap_frames() const { return arena.heap_frames(); }
+
+private:
+    struct waiter {
+        std::coroutine_handle<> h;
+        uint64_t due;
+        bool (*check)(void *);
+        void *ctx;
+    };
+
+    // Reclaim the spawned tasks that ran off their end and pass on the
+    // first failure. Children finish inside their parent's resume instead.
+    void reap()
+    {
+        std::exception_ptr error;
+
+        for (auto h : finished) {
+            if (!error)
+                error = h.promise().error;
+            h.destroy();
+            roots--;
+        }
+        finished.clear();
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    sim_arena arena;
+    std::vector<waiter> wait;
+    std::vector<waiter> ready;
+    std::vector<std::coroutine_handle<sim_task::promise_type>> finished;
+    uint64_t cycle = 0;
+    size_t roots = 0;
+};
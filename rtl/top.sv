@@ -1,7 +1,27 @@
 module top
     # (
+        // word address bits of the ram, 16 to 30. The peripherals stay at
+        // 0x3ff00 and the ram above them is reachable once this is over 16.
         parameter ADDR_WIDTH = 16,
-        parameter START_ADDR = 32'h10000
+        parameter START_ADDR = 32'h10000,
+        parameter NUM_HARTS  = 1,
+        // see rv32_core
+        parameter DUAL_ISSUE = 0,
+        parameter FUSION     = 0,
+        // block ram reads for the ram, the peripherals and the register
+        // files, see rv32_core. a_data_out answers a cycle after a_addr too.
+        parameter SYNC_READ  = 0,
+        // 0 puts the harts straight on the ram arbiter, 1 behind an
+        // axi_lite_master and axi_lite_mem, 2 behind a wb_master and wb_mem,
+        // the bus memories inject latency, see bus_delay. SYNC_READ = 0 only.
+        parameter BUS        = 0,
+        // log2 of the requests each bus master keeps in flight
+        parameter BUS_DEPTH_LOG2 = 2,
+        // every hart gets a cfu_mac on its custom-0 port
+        parameter CFU        = 1,
+        // hart 0 gets a trace_encoder, log2 of its buffer words
+        parameter TRACE      = 1,
+        parameter TRACE_LOG2 = 12
     )
     (
         input  wire                    clk,
@@ -12,49 +32,545 @@ module top
         input  wire [ADDR_WIDTH-1:0]   a_addr,
         input  wire [32-1:0]           a_data_in,
         output wire [32-1:0]           a_data_out,
-        output wire [3:0]              core_fault
+        // host doorbell, raises the machine external interrupt
+        input  wire                    ext_irq,
+        // idle cycles to skip this clock, see rv32_core
+        input  wire [32-1:0]           time_skip,
+        // latency range of the BUS memories, see bus_delay
+        // verilator lint_off UNUSEDSIGNAL
+        input  wire [8-1:0]            bus_lat_min,
+        input  wire [8-1:0]            bus_lat_max,
+        // verilator lint_on UNUSEDSIGNAL
+        // every hart is parked in wfi and no dma transfer is running
+        output wire                    core_sleep,
+        // per hart ecall service, see rv32_core
+        output wire [NUM_HARTS-1:0]    ecall_req,
+        input  wire [NUM_HARTS-1:0]    ecall_ack,
+        input  wire [32-1:0]           ecall_ret,
+        // branch trace of hart 0, see trace_encoder
+        input  wire                    trace_flush,
+        input  wire [TRACE_LOG2-1:0]   trace_rd_addr,
+        output wire [32-1:0]           trace_rd_data,
+        output wire [32-1:0]           trace_count,
+        output reg  [3:0]              core_fault
     );
 
-    wire                    b_wr_en;
-    wire [4-1:0]            b_wr_strobe;
-    wire [ADDR_WIDTH-1:0]   b_addr;
-    wire [32-1:0]           b_data_in;
+    // the core testbench watches the shared port to spot idle loops
+    wire                    b_wr_en     /*verilator public_flat_rd*/;
+    wire [4-1:0]            b_wr_strobe /*verilator public_flat_rd*/;
+    wire [ADDR_WIDTH-1:0]   b_addr      /*verilator public_flat_rd*/;
+    wire [32-1:0]           b_data_in   /*verilator public_flat_rd*/;
     wire [32-1:0]           b_data_out;
 
+    // 256 bytes below 0x40000 are peripherals instead of ram, the top of a
+    // 16 bit word address space and fixed for any wider one:
+    //   0x3ff00 - 0x3ff7f  clint
+    //   0x3ff80 - 0x3ffbf  dma
+    //   0x3ffc0 - 0x3ffff  cfu_mmio
+    localparam PERIPH_BASE = 32'h3ff00;
+    // the testbench mailboxes, see src/link.txt. The cores write the page
+    // through and keep its accesses in order.
+    localparam MAILBOX_BASE = 32'h1f000;
+
+    wire                    periph_sel  /*verilator public_flat_rd*/;
+    wire                    clint_sel;
+    wire                    dma_sel;
+    wire                    cfu_sel;
+    wire [32-1:0]           clint_data_out;
+    wire [32-1:0]           dma_data_out;
+    wire [32-1:0]           cfu_data_out;
+    wire                    ram_b_wr_en;
+    wire [32-1:0]           ram_b_data_out;
+    // upper half of the 64 bit instruction fetch, never a peripheral, a BUS
+    // master buffers its own
+    // verilator lint_off UNUSEDSIGNAL
+    wire [32-1:0]           ram_b_data_out_hi;
+    // verilator lint_on UNUSEDSIGNAL
+
+    assign periph_sel  = b_addr[ADDR_WIDTH-1:6] == PERIPH_BASE[ADDR_WIDTH-1+2:8];
+    assign clint_sel   = periph_sel && !b_addr[5];
+    assign dma_sel     = periph_sel && b_addr[5] && !b_addr[4];
+    assign cfu_sel     = periph_sel && b_addr[5] && b_addr[4];
+    assign ram_b_wr_en = b_wr_en && !periph_sel;
+
+    // a peripheral read answers when the ram would, on the cycle after the
+    // address with SYNC_READ
+    if (SYNC_READ != 0) begin : gen_sync_periph
+        reg          periph_q;
+        reg [32-1:0] periph_data_q;
+
+        always_ff @(posedge(clk)) begin
+            periph_q      <= periph_sel;
+            periph_data_q <= clint_sel ? clint_data_out :
+                             dma_sel   ? dma_data_out   : cfu_data_out;
+        end
+
+        assign b_data_out = periph_q ? periph_data_q : ram_b_data_out;
+    end else begin : gen_async_periph
+        assign b_data_out = clint_sel ? clint_data_out :
+                            dma_sel   ? dma_data_out   :
+                            cfu_sel   ? cfu_data_out   : ram_b_data_out;
+    end
+
+    // per hart ram ports, flattened for the arbiter
+    wire [NUM_HARTS-1:0]            hart_req;
+    wire [NUM_HARTS-1:0]            hart_lock;
+    // read by the core testbench to trace the accesses of each hart
+    wire [NUM_HARTS-1:0]            hart_gnt /*verilator public_flat_rd*/;
+    wire [NUM_HARTS-1:0]            hart_wr_en;
+    wire [NUM_HARTS*4-1:0]          hart_wr_strobe;
+    wire [NUM_HARTS*ADDR_WIDTH-1:0] hart_addr;
+    wire [NUM_HARTS*32-1:0]         hart_data_in;
+    wire [32-1:0]                   hart_data_out;
+    wire [NUM_HARTS*4-1:0]          hart_fault;
+    wire [NUM_HARTS-1:0]            hart_bus_error;
+    wire [NUM_HARTS-1:0]            hart_timer_irq;
+    wire [NUM_HARTS-1:0]            hart_soft_irq;
+    wire [NUM_HARTS-1:0]            hart_sleep;
+    wire                            ext_irq_pending;
+
+    // the dma engine is the last master on the arbiter, its completion shares
+    // the machine external interrupt with the host doorbell
+    wire                            dma_req;
+    wire                            dma_gnt;
+    wire                            dma_wr_en;
+    wire [4-1:0]                    dma_wr_strobe;
+    wire [ADDR_WIDTH-1:0]           dma_addr;
+    wire [32-1:0]                   dma_data_in;
+    wire                            dma_irq;
+
+    assign core_sleep = &hart_sleep && !dma_req;
+
+    // RAM_DPI swaps the flat array for the sparse host page table, see
+    // ram_dpi.sv
+`ifdef RAM_DPI
+    ram_dpi
+`else
     ram
+`endif
     #(
-        .ADDR_WIDTH ( 16 )
+        .ADDR_WIDTH ( ADDR_WIDTH ),
+        .SYNC_READ  ( SYNC_READ  )
     )
     ram_inst
     (
-        .clk         ( clk         ),
-        .a_wr_en     ( a_wr_en     ),
-        .a_wr_strobe ( a_wr_strobe ),
-        .a_addr      ( a_addr      ),
-        .a_data_in   ( a_data_in   ),
-        .a_data_out  ( a_data_out  ),
-        .b_wr_en     ( b_wr_en     ),
-        .b_wr_strobe ( b_wr_strobe ),
-        .b_addr      ( b_addr      ),
-        .b_data_in   ( b_data_in   ),
-        .b_data_out  ( b_data_out  )
+        .clk           ( clk               ),
+        .a_wr_en       ( a_wr_en           ),
+        .a_wr_strobe   ( a_wr_strobe       ),
+        .a_addr        ( a_addr            ),
+        .a_data_in     ( a_data_in         ),
+        .a_data_out    ( a_data_out        ),
+        .b_wr_en       ( ram_b_wr_en       ),
+        .b_wr_strobe   ( b_wr_strobe       ),
+        .b_addr        ( b_addr            ),
+        .b_data_in     ( b_data_in         ),
+        .b_data_out    ( ram_b_data_out    ),
+        .b_data_out_hi ( ram_b_data_out_hi )
+    );
+
+    clint
+    #(
+        .NUM_HARTS ( NUM_HARTS )
+    )
+    clint_inst
+    (
+        .clk         ( clk                  ),
+        .reset_n     ( reset_n              ),
+        .wr_en       ( b_wr_en && clint_sel ),
+        .wr_strobe   ( b_wr_strobe          ),
+        .addr        ( b_addr[4:0]          ),
+        .data_in     ( b_data_in            ),
+        .data_out    ( clint_data_out       ),
+        .ext_irq_set ( ext_irq              ),
+        .time_skip   ( time_skip            ),
+        .timer_irq   ( hart_timer_irq       ),
+        .soft_irq    ( hart_soft_irq        ),
+        .ext_irq     ( ext_irq_pending      )
     );
 
-    rv32_core
+    dma
     #(
         .ADDR_WIDTH ( ADDR_WIDTH ),
-        .START_ADDR ( START_ADDR )
+        .SYNC_READ  ( SYNC_READ  )
     )
-    rv32_inst
+    dma_inst
     (
-        .clk           ( clk         ),
-        .reset_n       ( reset_n     ),
-        .ram_wr_en     ( b_wr_en     ),
-        .ram_wr_strobe ( b_wr_strobe ),
-        .ram_addr      ( b_addr      ),
-        .ram_data_in   ( b_data_in   ),
-        .ram_data_out  ( b_data_out  ),
-        .core_fault    ( core_fault  )
+        .clk           ( clk                ),
+        .reset_n       ( reset_n            ),
+        .reg_wr_en     ( b_wr_en && dma_sel ),
+        .reg_addr      ( b_addr[4:0]        ),
+        .reg_data_in   ( b_data_in          ),
+        .reg_data_out  ( dma_data_out       ),
+        .ram_req       ( dma_req            ),
+        .ram_gnt       ( dma_gnt            ),
+        .ram_wr_en     ( dma_wr_en          ),
+        .ram_wr_strobe ( dma_wr_strobe      ),
+        .ram_addr      ( dma_addr           ),
+        .ram_data_in   ( dma_data_in        ),
+        .ram_data_out  ( hart_data_out      ),
+        .irq           ( dma_irq            )
     );
 
+    cfu_mmio cfu_mmio_inst
+    (
+        .clk          ( clk                ),
+        .reset_n      ( reset_n            ),
+        .reg_wr_en    ( b_wr_en && cfu_sel ),
+        .reg_addr     ( b_addr[1:0]        ),
+        .reg_data_in  ( b_data_in          ),
+        .reg_data_out ( cfu_data_out       )
+    );
+
+    mem_arbiter
+    #(
+        .NUM_PORTS  ( NUM_HARTS + 1 ),
+        .ADDR_WIDTH ( ADDR_WIDTH    )
+    )
+    arbiter_inst
+    (
+        .clk           ( clk                             ),
+        .reset_n       ( reset_n                         ),
+        .m_req         ( {dma_req, hart_req}             ),
+        .m_lock        ( {1'b0, hart_lock}               ),
+        .m_gnt         ( {dma_gnt, hart_gnt}             ),
+        .m_wr_en       ( {dma_wr_en, hart_wr_en}         ),
+        .m_wr_strobe   ( {dma_wr_strobe, hart_wr_strobe} ),
+        .m_addr        ( {dma_addr, hart_addr}           ),
+        .m_data_in     ( {dma_data_in, hart_data_in}     ),
+        .m_data_out    ( hart_data_out                   ),
+        .ram_wr_en     ( b_wr_en                         ),
+        .ram_wr_strobe ( b_wr_strobe                     ),
+        .ram_addr      ( b_addr                          ),
+        .ram_data_in   ( b_data_in                       ),
+        .ram_data_out  ( b_data_out                      )
+    );
+
+    genvar i;
+    generate
+        for (i = 0; i < NUM_HARTS; i = i + 1) begin : gen_hart
+            // the core never starts an operation without CFU
+            // verilator lint_off UNUSEDSIGNAL
+            wire                    cfu_start;
+            wire [10-1:0]           cfu_func;
+            wire [32-1:0]           cfu_rs1;
+            wire [32-1:0]           cfu_rs2;
+            // verilator lint_on UNUSEDSIGNAL
+            wire                    cfu_done;
+            wire [32-1:0]           cfu_result;
+            // only hart 0 is traced
+            // verilator lint_off UNUSEDSIGNAL
+            wire [1:0]              trace_iretire;
+            wire [2*3-1:0]          trace_itype;
+            wire [32-1:0]           trace_iaddr;
+            // verilator lint_on UNUSEDSIGNAL
+            // the ram port of the core, to the arbiter or a bus master. Only
+            // a bus master takes the fetch hint.
+            wire                    core_req;
+            wire                    core_lock;
+            // verilator lint_off UNUSEDSIGNAL
+            wire                    core_fetch;
+            // verilator lint_on UNUSEDSIGNAL
+            wire                    core_gnt;
+            wire                    core_wr_en;
+            wire [4-1:0]            core_wr_strobe;
+            wire [ADDR_WIDTH-1:0]   core_addr;
+            wire [32-1:0]           core_data_in;
+            wire [32-1:0]           core_data_out;
+            wire [32-1:0]           core_fetch_hi;
+
+            rv32_core
+            #(
+                .ADDR_WIDTH   ( ADDR_WIDTH   ),
+                .START_ADDR   ( START_ADDR   ),
+                .PERIPH_BASE  ( PERIPH_BASE  ),
+                .MAILBOX_BASE ( MAILBOX_BASE ),
+                .HART_ID      ( i            ),
+                .DUAL_ISSUE   ( DUAL_ISSUE   ),
+                .FUSION       ( FUSION       ),
+                .CFU          ( CFU          ),
+                .SYNC_READ    ( SYNC_READ    )
+            )
+            rv32_inst
+            (
+                .clk           ( clk                                      ),
+                .reset_n       ( reset_n                                  ),
+                .ram_wr_en     ( core_wr_en                               ),
+                .ram_wr_strobe ( core_wr_strobe                           ),
+                .ram_addr      ( core_addr                                ),
+                .ram_data_in   ( core_data_in                             ),
+                .ram_data_out  ( core_data_out                            ),
+                .ram_fetch_hi  ( core_fetch_hi                            ),
+                .ram_req       ( core_req                                 ),
+                .ram_lock      ( core_lock                                ),
+                .ram_gnt       ( core_gnt                                 ),
+                .ram_fetch     ( core_fetch                               ),
+                .snoop_wr_en   ( b_wr_en                                  ),
+                .snoop_addr    ( b_addr                                   ),
+                .timer_irq     ( hart_timer_irq[i]                        ),
+                .soft_irq      ( hart_soft_irq[i]                         ),
+                .ext_irq       ( ext_irq_pending || dma_irq               ),
+                .time_skip     ( time_skip                                ),
+                .sleep         ( hart_sleep[i]                            ),
+                .ecall_req     ( ecall_req[i]                             ),
+                .ecall_ack     ( ecall_ack[i]                             ),
+                .ecall_ret     ( ecall_ret                                ),
+                .cfu_start     ( cfu_start                                ),
+                .cfu_func      ( cfu_func                                 ),
+                .cfu_rs1       ( cfu_rs1                                  ),
+                .cfu_rs2       ( cfu_rs2                                  ),
+                .cfu_done      ( cfu_done                                 ),
+                .cfu_result    ( cfu_result                               ),
+                .trace_iretire ( trace_iretire                            ),
+                .trace_itype   ( trace_itype                              ),
+                .trace_iaddr   ( trace_iaddr                              ),
+                .core_fault    ( hart_fault[i*4 +: 4]                     )
+            );
+
+            if (BUS == 0) begin : gen_direct
+                assign hart_req[i]                           = core_req;
+                assign hart_lock[i]                          = core_lock;
+                assign hart_wr_en[i]                         = core_wr_en;
+                assign hart_wr_strobe[i*4 +: 4]              = core_wr_strobe;
+                assign hart_addr[i*ADDR_WIDTH +: ADDR_WIDTH] = core_addr;
+                assign hart_data_in[i*32 +: 32]              = core_data_in;
+                assign core_gnt                              = hart_gnt[i];
+                assign core_data_out                         = hart_data_out;
+                assign core_fetch_hi                         = ram_b_data_out_hi;
+                assign hart_bus_error[i]                     = 1'b0;
+            end else if (BUS == 1) begin : gen_axi
+                wire                    awvalid;
+                wire                    awready;
+                wire [ADDR_WIDTH+2-1:0] awaddr;
+                wire [3-1:0]            awprot;
+                wire                    awlock;
+                wire                    wvalid;
+                wire                    wready;
+                wire [32-1:0]           wdata;
+                wire [4-1:0]            wstrb;
+                wire                    bvalid;
+                wire                    bready;
+                wire [2-1:0]            bresp;
+                wire                    arvalid;
+                wire                    arready;
+                wire [ADDR_WIDTH+2-1:0] araddr;
+                wire [3-1:0]            arprot;
+                wire                    arlock;
+                wire                    rvalid;
+                wire                    rready;
+                wire [32-1:0]           rdata;
+                wire [2-1:0]            rresp;
+
+                axi_lite_master
+                #(
+                    .ADDR_WIDTH  ( ADDR_WIDTH                     ),
+                    .DEPTH_LOG2  ( BUS_DEPTH_LOG2                 ),
+                    .FETCH_PAIRS ( DUAL_ISSUE != 0 || FUSION != 0 )
+                )
+                master_inst
+                (
+                    .clk           ( clk               ),
+                    .reset_n       ( reset_n           ),
+                    .ram_req       ( core_req          ),
+                    .ram_lock      ( core_lock         ),
+                    .ram_fetch     ( core_fetch        ),
+                    .ram_wr_en     ( core_wr_en        ),
+                    .ram_wr_strobe ( core_wr_strobe    ),
+                    .ram_addr      ( core_addr         ),
+                    .ram_data_in   ( core_data_in      ),
+                    .ram_data_out  ( core_data_out     ),
+                    .ram_fetch_hi  ( core_fetch_hi     ),
+                    .ram_gnt       ( core_gnt          ),
+                    .bus_error     ( hart_bus_error[i] ),
+                    .awvalid       ( awvalid           ),
+                    .awready       ( awready           ),
+                    .awaddr        ( awaddr            ),
+                    .awprot        ( awprot            ),
+                    .awlock        ( awlock            ),
+                    .wvalid        ( wvalid            ),
+                    .wready        ( wready            ),
+                    .wdata         ( wdata             ),
+                    .wstrb         ( wstrb             ),
+                    .bvalid        ( bvalid            ),
+                    .bready        ( bready            ),
+                    .bresp         ( bresp             ),
+                    .arvalid       ( arvalid           ),
+                    .arready       ( arready           ),
+                    .araddr        ( araddr            ),
+                    .arprot        ( arprot            ),
+                    .arlock        ( arlock            ),
+                    .rvalid        ( rvalid            ),
+                    .rready        ( rready            ),
+                    .rdata         ( rdata             ),
+                    .rresp         ( rresp             )
+                );
+
+                axi_lite_mem
+                #(
+                    .ADDR_WIDTH ( ADDR_WIDTH )
+                )
+                mem_inst
+                (
+                    .clk           ( clk                                   ),
+                    .reset_n       ( reset_n                               ),
+                    .lat_min       ( bus_lat_min                           ),
+                    .lat_max       ( bus_lat_max                           ),
+                    .awvalid       ( awvalid                               ),
+                    .awready       ( awready                               ),
+                    .awaddr        ( awaddr                                ),
+                    .awprot        ( awprot                                ),
+                    .awlock        ( awlock                                ),
+                    .wvalid        ( wvalid                                ),
+                    .wready        ( wready                                ),
+                    .wdata         ( wdata                                 ),
+                    .wstrb         ( wstrb                                 ),
+                    .bvalid        ( bvalid                                ),
+                    .bready        ( bready                                ),
+                    .bresp         ( bresp                                 ),
+                    .arvalid       ( arvalid                               ),
+                    .arready       ( arready                               ),
+                    .araddr        ( araddr                                ),
+                    .arprot        ( arprot                                ),
+                    .arlock        ( arlock                                ),
+                    .rvalid        ( rvalid                                ),
+                    .rready        ( rready                                ),
+                    .rdata         ( rdata                                 ),
+                    .rresp         ( rresp                                 ),
+                    .ram_req       ( hart_req[i]                           ),
+                    .ram_lock      ( hart_lock[i]                          ),
+                    .ram_gnt       ( hart_gnt[i]                           ),
+                    .ram_wr_en     ( hart_wr_en[i]                         ),
+                    .ram_wr_strobe ( hart_wr_strobe[i*4 +: 4]              ),
+                    .ram_addr      ( hart_addr[i*ADDR_WIDTH +: ADDR_WIDTH] ),
+                    .ram_data_in   ( hart_data_in[i*32 +: 32]              ),
+                    .ram_data_out  ( hart_data_out                         )
+                );
+            end else begin : gen_wb
+                wire                    cyc;
+                wire                    stb;
+                wire                    we;
+                wire                    lock;
+                wire [ADDR_WIDTH+2-1:0] adr;
+                wire [32-1:0]           dat_w;
+                wire [4-1:0]            sel;
+                wire                    stall;
+                wire                    ack;
+                wire                    err;
+                wire [32-1:0]           dat_r;
+
+                wb_master
+                #(
+                    .ADDR_WIDTH  ( ADDR_WIDTH                     ),
+                    .DEPTH_LOG2  ( BUS_DEPTH_LOG2                 ),
+                    .FETCH_PAIRS ( DUAL_ISSUE != 0 || FUSION != 0 )
+                )
+                master_inst
+                (
+                    .clk           ( clk               ),
+                    .reset_n       ( reset_n           ),
+                    .ram_req       ( core_req          ),
+                    .ram_lock      ( core_lock         ),
+                    .ram_fetch     ( core_fetch        ),
+                    .ram_wr_en     ( core_wr_en        ),
+                    .ram_wr_strobe ( core_wr_strobe    ),
+                    .ram_addr      ( core_addr         ),
+                    .ram_data_in   ( core_data_in      ),
+                    .ram_data_out  ( core_data_out     ),
+                    .ram_fetch_hi  ( core_fetch_hi     ),
+                    .ram_gnt       ( core_gnt          ),
+                    .bus_error     ( hart_bus_error[i] ),
+                    .cyc           ( cyc               ),
+                    .stb           ( stb               ),
+                    .we            ( we                ),
+                    .lock          ( lock              ),
+                    .adr           ( adr               ),
+                    .dat_w         ( dat_w             ),
+                    .sel           ( sel               ),
+                    .stall         ( stall             ),
+                    .ack           ( ack               ),
+                    .err           ( err               ),
+                    .dat_r         ( dat_r             )
+                );
+
+                wb_mem
+                #(
+                    .ADDR_WIDTH ( ADDR_WIDTH )
+                )
+                mem_inst
+                (
+                    .clk           ( clk                                   ),
+                    .reset_n       ( reset_n                               ),
+                    .lat_min       ( bus_lat_min                           ),
+                    .lat_max       ( bus_lat_max                           ),
+                    .cyc           ( cyc                                   ),
+                    .stb           ( stb                                   ),
+                    .we            ( we                                    ),
+                    .lock          ( lock                                  ),
+                    .adr           ( adr                                   ),
+                    .dat_w         ( dat_w                                 ),
+                    .sel           ( sel                                   ),
+                    .stall         ( stall                                 ),
+                    .ack           ( ack                                   ),
+                    .err           ( err                                   ),
+                    .dat_r         ( dat_r                                 ),
+                    .ram_req       ( hart_req[i]                           ),
+                    .ram_lock      ( hart_lock[i]                          ),
+                    .ram_gnt       ( hart_gnt[i]                           ),
+                    .ram_wr_en     ( hart_wr_en[i]                         ),
+                    .ram_wr_strobe ( hart_wr_strobe[i*4 +: 4]              ),
+                    .ram_addr      ( hart_addr[i*ADDR_WIDTH +: ADDR_WIDTH] ),
+                    .ram_data_in   ( hart_data_in[i*32 +: 32]              ),
+                    .ram_data_out  ( hart_data_out                         )
+                );
+            end
+
+            if (CFU != 0) begin : gen_cfu
+                cfu_mac cfu_inst
+                (
+                    .clk     ( clk        ),
+                    .reset_n ( reset_n    ),
+                    .start   ( cfu_start  ),
+                    .func    ( cfu_func   ),
+                    .rs1     ( cfu_rs1    ),
+                    .rs2     ( cfu_rs2    ),
+                    .done    ( cfu_done   ),
+                    .result  ( cfu_result )
+                );
+            end else begin : gen_no_cfu
+                assign cfu_done   = 1'b0;
+                assign cfu_result = '0;
+            end
+
+            if (TRACE != 0 && i == 0) begin : gen_trace
+                trace_encoder
+                #(
+                    .DEPTH_LOG2 ( TRACE_LOG2 )
+                )
+                trace_inst
+                (
+                    .clk     ( clk           ),
+                    .reset_n ( reset_n       ),
+                    .iretire ( trace_iretire ),
+                    .itype   ( trace_itype   ),
+                    .iaddr   ( trace_iaddr   ),
+                    .flush   ( trace_flush   ),
+                    .rd_addr ( trace_rd_addr ),
+                    .rd_data ( trace_rd_data ),
+                    .count   ( trace_count   )
+                );
+            end else if (i == 0) begin : gen_no_trace
+                assign trace_rd_data = '0;
+                assign trace_count   = '0;
+            end
+        end
+    endgenerate
+
+    // report the fault of any hart, the testbench can look up which one
+    always_comb begin
+        core_fault = '0;
+        for (int h = 0; h < NUM_HARTS; h++) begin
+            // a bus error shows as an illegal access
+            core_fault = core_fault | hart_fault[h*4 +: 4] | (hart_bus_error[h] ? 4'd2 : 4'd0);
+        end
+    end
+
 endmodule
@@ -0,0 +1,151 @@
+// Branch trace encoder for the trace port of rv32_core, after RISC-V
+// E-Trace. Only what a decoder can not work out from the program is kept:
+// one bit per conditional branch, the target of each uninferable jump (jalr
+// and mret) and the point of each interrupt. Sequential code and jal cost
+// nothing. See rtl/tb/core/trace_decode.h for the decoder.
+//
+// Packets are 32 bit words in a circular trace buffer, kind in [1:0]:
+//
+//  kind | packet
+//  -----+----------------------------------------------------------------------
+//  0    | branches, [6:2] count and [31:7] taken bits, the oldest in bit 7
+//  1    | jump, the last uninferable jump went to [31:2] << 2
+//  2    | stop, the flow reached [31:2] << 2 without retiring it, for an
+//       | interrupt or a flush. A pending jump target is that address.
+//  3    | sync, the flow restarts at [31:2] << 2, after reset and interrupts
+//
+// Branch bits are written out before the next address packet, or once the
+// next ones do not fit. A cycle writes at most two words. flush writes the
+// pending state out on a cycle nothing retires, to end a trace.
+module trace_encoder
+    #(
+        // log2 of the words the trace buffer keeps
+        parameter DEPTH_LOG2 = 12
+    )
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        // trace port of rv32_core
+        input  wire [1:0]               iretire,
+        input  wire [2*3-1:0]           itype,
+        // instructions are word aligned
+        // verilator lint_off UNUSEDSIGNAL
+        input  wire [32-1:0]            iaddr,
+        // verilator lint_on UNUSEDSIGNAL
+        input  wire                     flush,
+        // buffer read port, the last 2**DEPTH_LOG2 of count words are kept
+        input  wire [DEPTH_LOG2-1:0]    rd_addr,
+        output wire [32-1:0]            rd_data,
+        output reg  [32-1:0]            count
+    );
+
+    localparam ITYPE_INTERRUPT = 3'd2;
+    localparam ITYPE_RETURN    = 3'd3;
+    localparam ITYPE_NOT_TAKEN = 3'd4;
+    localparam ITYPE_TAKEN     = 3'd5;
+    localparam ITYPE_JUMP      = 3'd6;
+
+    localparam KIND_BRANCHES = 2'd0;
+    localparam KIND_JUMP     = 2'd1;
+    localparam KIND_STOP     = 2'd2;
+    localparam KIND_SYNC     = 2'd3;
+
+    localparam MAP_BITS = 25;
+
+    localparam PEND_NONE = 2'd0;
+    localparam PEND_JUMP = 2'd1;
+    localparam PEND_SYNC = 2'd2;
+
+    reg  [31:0]             buffer [2**DEPTH_LOG2];
+    reg  [MAP_BITS-1:0]     map;
+    reg  [4:0]              map_count;
+    reg  [1:0]              pend;
+
+    reg  [MAP_BITS-1:0]     next_map;
+    reg  [4:0]              next_count;
+    reg  [1:0]              next_pend;
+    reg  [1:0]              words;
+    reg  [31:0]             word[2];
+    reg  [1:0]              new_bits;
+    reg  [1:0]              taken;
+
+    assign rd_data = buffer[rd_addr];
+
+    always_comb begin
+        next_map   = map;
+        next_count = map_count;
+        next_pend  = pend;
+        words      = '0;
+        word       = '{default: '0};
+        new_bits   = '0;
+        taken      = '0;
+
+        // the branches of this cycle, in retire order
+        for (int i = 0; i < 2; i++) begin
+            if (i < 32'(iretire) && (itype[i*3 +: 3] == ITYPE_NOT_TAKEN || itype[i*3 +: 3] == ITYPE_TAKEN)) begin
+                taken[new_bits] = itype[i*3 +: 3] == ITYPE_TAKEN;
+                new_bits        = new_bits + 2'd1;
+            end
+        end
+
+        if (flush || (iretire == '0 && itype[2:0] == ITYPE_INTERRUPT)) begin
+            if (map_count != '0) begin
+                word[words] = {map, map_count, KIND_BRANCHES};
+                words       = words + 2'd1;
+            end
+            word[words] = {iaddr[31:2], KIND_STOP};
+            words       = words + 2'd1;
+            next_map    = '0;
+            next_count  = '0;
+            next_pend   = PEND_SYNC;
+        end else if (iretire != '0) begin
+            if (pend == PEND_SYNC) begin
+                word[words] = {iaddr[31:2], KIND_SYNC};
+                words       = words + 2'd1;
+            end else if (pend == PEND_JUMP) begin
+                if (map_count != '0) begin
+                    word[words] = {map, map_count, KIND_BRANCHES};
+                    words       = words + 2'd1;
+                end
+                word[words] = {iaddr[31:2], KIND_JUMP};
+                words       = words + 2'd1;
+                next_map    = '0;
+                next_count  = '0;
+            end else if (32'(map_count) + 32'(new_bits) > MAP_BITS) begin
+                word[words] = {map, map_count, KIND_BRANCHES};
+                words       = words + 2'd1;
+                next_map    = '0;
+                next_count  = '0;
+            end
+            for (int i = 0; i < 2; i++) begin
+                if (i < 32'(new_bits)) begin
+                    next_map[next_count] = taken[i];
+                    next_count           = next_count + 5'd1;
+                end
+            end
+            // only the last instruction of a group can leave the sequence
+            next_pend = itype[(32'(iretire) - 1)*3 +: 3] == ITYPE_RETURN ||
+                        itype[(32'(iretire) - 1)*3 +: 3] == ITYPE_JUMP ? PEND_JUMP : PEND_NONE;
+        end
+    end
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            map       <= '0;
+            map_count <= '0;
+            pend      <= PEND_SYNC;
+            count     <= '0;
+        end else begin
+            map       <= next_map;
+            map_count <= next_count;
+            pend      <= next_pend;
+            count     <= count + 32'(words);
+            for (int i = 0; i < 2; i++) begin
+                if (i < 32'(words)) begin
+                    buffer[DEPTH_LOG2'(count + 32'(i))] <= word[i];
+                end
+            end
+        end
+    end
+
+endmodule
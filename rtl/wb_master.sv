@@ -0,0 +1,101 @@
+// Pipelined Wishbone B4 master for the ram port of rv32_core, see
+// bus_master for how the core's accesses map to requests. A request goes out
+// on every cycle stb is high and stall low, up to 2**DEPTH_LOG2 of them wait
+// for their ack or err, and cyc stays high until the last one did. lock is
+// req_lock of bus_master, the slave holds off other masters until a request
+// comes without it.
+module wb_master
+    # (
+        parameter ADDR_WIDTH  = 16,
+        // see bus_master
+        parameter DEPTH_LOG2  = 2,
+        parameter FETCH_PAIRS = 0
+    )
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        // ram port of rv32_core
+        input  wire                     ram_req,
+        input  wire                     ram_lock,
+        input  wire                     ram_fetch,
+        input  wire                     ram_wr_en,
+        input  wire [4-1:0]             ram_wr_strobe,
+        input  wire [ADDR_WIDTH-1:0]    ram_addr,
+        input  wire [32-1:0]            ram_data_in,
+        output wire [32-1:0]            ram_data_out,
+        output wire [32-1:0]            ram_fetch_hi,
+        output wire                     ram_gnt,
+        output wire                     bus_error,
+        // Wishbone, byte addresses
+        output wire                     cyc,
+        output wire                     stb,
+        output wire                     we,
+        output wire                     lock,
+        output wire [ADDR_WIDTH+2-1:0]  adr,
+        output wire [32-1:0]            dat_w,
+        output wire [4-1:0]             sel,
+        input  wire                     stall,
+        input  wire                     ack,
+        input  wire                     err,
+        input  wire [32-1:0]            dat_r
+    );
+
+    wire                    req_valid;
+    wire                    req_we;
+    // Wishbone has no fetch tag
+    // verilator lint_off UNUSEDSIGNAL
+    wire                    req_fetch;
+    // verilator lint_on UNUSEDSIGNAL
+    wire [ADDR_WIDTH-1:0]   req_addr;
+
+    // requests sent and not answered yet
+    reg  [DEPTH_LOG2:0]     pending;
+
+    assign cyc = stb || pending != '0;
+    assign stb = req_valid;
+    assign we  = req_we;
+    assign adr = {req_addr, 2'b00};
+
+    always_ff @(posedge(clk)) begin
+        if (!reset_n) begin
+            pending <= '0;
+        end else begin
+            pending <= pending + (DEPTH_LOG2+1)'(stb && !stall) - (DEPTH_LOG2+1)'(ack || err);
+        end
+    end
+
+    bus_master
+    #(
+        .ADDR_WIDTH  ( ADDR_WIDTH  ),
+        .DEPTH_LOG2  ( DEPTH_LOG2  ),
+        .FETCH_PAIRS ( FETCH_PAIRS )
+    )
+    bus_inst
+    (
+        .clk           ( clk           ),
+        .reset_n       ( reset_n       ),
+        .ram_req       ( ram_req       ),
+        .ram_lock      ( ram_lock      ),
+        .ram_fetch     ( ram_fetch     ),
+        .ram_wr_en     ( ram_wr_en     ),
+        .ram_wr_strobe ( ram_wr_strobe ),
+        .ram_addr      ( ram_addr      ),
+        .ram_data_in   ( ram_data_in   ),
+        .ram_data_out  ( ram_data_out  ),
+        .ram_fetch_hi  ( ram_fetch_hi  ),
+        .ram_gnt       ( ram_gnt       ),
+        .req_valid     ( req_valid     ),
+        .req_ready     ( !stall        ),
+        .req_we        ( req_we        ),
+        .req_fetch     ( req_fetch     ),
+        .req_lock      ( lock          ),
+        .req_addr      ( req_addr      ),
+        .req_data      ( dat_w         ),
+        .req_strobe    ( sel           ),
+        .rsp_valid     ( ack || err    ),
+        .rsp_data      ( dat_r         ),
+        .rsp_err       ( err           ),
+        .bus_error     ( bus_error     )
+    );
+
+endmodule
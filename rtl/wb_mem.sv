@@ -0,0 +1,81 @@
+// Pipelined Wishbone B4 slave over bus_delay, the latency injecting memory
+// for wb_master in top.sv. stall is high while the queue is full, every
+// request gets an ack in order, never err. lock keeps the ram port, see
+// bus_delay.
+module wb_mem
+    # (
+        parameter ADDR_WIDTH = 16,
+        // see bus_delay
+        parameter DEPTH_LOG2 = 3
+    )
+    (
+        input  wire                     clk,
+        input  wire                     reset_n,
+        input  wire [8-1:0]             lat_min,
+        input  wire [8-1:0]             lat_max,
+        // Wishbone, byte addresses
+        input  wire                     cyc,
+        input  wire                     stb,
+        input  wire                     we,
+        input  wire                     lock,
+        // verilator lint_off UNUSEDSIGNAL
+        input  wire [ADDR_WIDTH+2-1:0]  adr,
+        // verilator lint_on UNUSEDSIGNAL
+        input  wire [32-1:0]            dat_w,
+        input  wire [4-1:0]             sel,
+        output wire                     stall,
+        output wire                     ack,
+        output wire                     err,
+        output wire [32-1:0]            dat_r,
+        // ram master port
+        output wire                     ram_req,
+        output wire                     ram_lock,
+        input  wire                     ram_gnt,
+        output wire                     ram_wr_en,
+        output wire [4-1:0]             ram_wr_strobe,
+        output wire [ADDR_WIDTH-1:0]    ram_addr,
+        output wire [32-1:0]            ram_data_in,
+        input  wire [32-1:0]            ram_data_out
+    );
+
+    wire                    req_ready;
+    // verilator lint_off UNUSEDSIGNAL
+    wire                    rsp_we;
+    // verilator lint_on UNUSEDSIGNAL
+
+    assign stall = !req_ready;
+    assign err   = 1'b0;
+
+    bus_delay
+    #(
+        .ADDR_WIDTH ( ADDR_WIDTH ),
+        .DEPTH_LOG2 ( DEPTH_LOG2 )
+    )
+    delay_inst
+    (
+        .clk           ( clk                       ),
+        .reset_n       ( reset_n                   ),
+        .lat_min       ( lat_min                   ),
+        .lat_max       ( lat_max                   ),
+        .req_valid     ( cyc && stb                ),
+        .req_ready     ( req_ready                 ),
+        .req_we        ( we                        ),
+        .req_lock      ( lock                      ),
+        .req_addr      ( adr[ADDR_WIDTH+2-1:2]     ),
+        .req_data      ( dat_w                     ),
+        .req_strobe    ( sel                       ),
+        .rsp_valid     ( ack                       ),
+        .rsp_ready     ( 1'b1                      ),
+        .rsp_we        ( rsp_we                    ),
+        .rsp_data      ( dat_r                     ),
+        .ram_req       ( ram_req                   ),
+        .ram_lock      ( ram_lock                  ),
+        .ram_gnt       ( ram_gnt                   ),
+        .ram_wr_en     ( ram_wr_en                 ),
+        .ram_wr_strobe ( ram_wr_strobe             ),
+        .ram_addr      ( ram_addr                  ),
+        .ram_data_in   ( ram_data_in               ),
+        .ram_data_out  ( ram_data_out              )
+    );
+
+endmodule
@@ -0,0 +1,64 @@
+// Target macros for the riscv-arch-test suite on the dabble core. Hart 0
+// runs the test, the other harts park in wfi like lib/crt0.S does. A test
+// ends through the exit call of the ecall proxy with the bounds of its
+// signature in a1 and a2, the testbench reads the signature straight out
+// of the ram, see batch_run() in rtl/tb/core/main.cpp.
+#ifndef _DABBLE_MODEL_TEST_H
+#define _DABBLE_MODEL_TEST_H
+
+#define SYS_EXIT            93
+#define CLINT_MSIP          0x3FF20
+
+#define RVMODEL_DATA_SECTION                                            \
+        .pushsection .tohost, "aw", @progbits;                          \
+        .align 8; .global tohost; tohost: .dword 0;                     \
+        .align 8; .global fromhost; fromhost: .dword 0;                 \
+        .popsection;                                                    \
+        .align 8; .global begin_regstate; begin_regstate:               \
+        .word 128;                                                      \
+        .align 8; .global end_regstate; end_regstate:                   \
+        .word 4;
+
+#define RVMODEL_BOOT                                                    \
+        csrr    t0, mhartid;                                            \
+        beqz    t0, 2f;                                                 \
+1:      wfi;                                                            \
+        j       1b;                                                     \
+2:
+
+#define RVMODEL_HALT                                                    \
+        la      a1, begin_signature;                                    \
+        la      a2, end_signature;                                      \
+        li      a0, 0;                                                  \
+        li      a7, SYS_EXIT;                                           \
+        ecall;                                                          \
+1:      j       1b;
+
+#define RVMODEL_DATA_BEGIN                                              \
+        RVMODEL_DATA_SECTION                                            \
+        .align 4; .global begin_signature; begin_signature:
+
+#define RVMODEL_DATA_END                                                \
+        .align 4; .global end_signature; end_signature:
+
+// no console, failures show up in the signature
+#define RVMODEL_IO_INIT
+#define RVMODEL_IO_WRITE_STR(_R, _STR)
+#define RVMODEL_IO_CHECK()
+#define RVMODEL_IO_ASSERT_GPR_EQ(_S, _R, _I)
+#define RVMODEL_IO_ASSERT_SFPR_EQ(_F, _R, _I)
+#define RVMODEL_IO_ASSERT_DFPR_EQ(_D, _R, _I)
+
+#define RVMODEL_SET_MSW_INT                                             \
+        li      t1, 1;                                                  \
+        li      t2, CLINT_MSIP;                                         \
+        sw      t1, 0(t2);
+
+#define RVMODEL_CLEAR_MSW_INT                                           \
+        li      t2, CLINT_MSIP;                                         \
+        sw      x0, 0(t2);
+
+#define RVMODEL_CLEAR_MTIMER_INT
+#define RVMODEL_CLEAR_MEXT_INT
+
+#endif
@@ -0,0 +1,181 @@
+#include <stdarg.h>
+
+#include "coremark.h"
+#include <bench.h>
+#include <syscalls.h>
+
+#if VALIDATION_RUN
+volatile ee_s32 seed1_volatile = 0x3415;
+volatile ee_s32 seed2_volatile = 0x3415;
+volatile ee_s32 seed3_volatile = 0x66;
+#endif
+#if PERFORMANCE_RUN
+volatile ee_s32 seed1_volatile = 0x0;
+volatile ee_s32 seed2_volatile = 0x0;
+volatile ee_s32 seed3_volatile = 0x66;
+#endif
+#if PROFILE_RUN
+volatile ee_s32 seed1_volatile = 0x8;
+volatile ee_s32 seed2_volatile = 0x8;
+volatile ee_s32 seed3_volatile = 0x8;
+#endif
+volatile ee_s32 seed4_volatile = ITERATIONS;
+volatile ee_s32 seed5_volatile = 0;
+
+ee_u32 default_num_contexts = 1;
+
+static CORETIMETYPE start_time_val;
+static CORETIMETYPE stop_time_val;
+
+// The timed region is also what the benchmark runner reports
+void start_time(void)
+{
+    bench_start();
+    start_time_val = (CORETIMETYPE) bench_cycles();
+}
+
+void stop_time(void)
+{
+    stop_time_val = (CORETIMETYPE) bench_cycles();
+    bench_stop();
+}
+
+CORE_TICKS get_time(void)
+{
+    return stop_time_val - start_time_val;
+}
+
+secs_ret time_in_secs(CORE_TICKS ticks)
+{
+    return ticks / (CPU_MHZ * 1000000);
+}
+
+void portable_init(core_portable *p, int *argc, char *argv[])
+{
+    (void) argc;
+    (void) argv;
+    if (sizeof(ee_ptr_int) != sizeof(ee_u8 *))
+    {
+        ee_printf("ERROR! Please define ee_ptr_int to a type that holds a pointer!\n");
+    }
+    if (sizeof(ee_u32) != 4)
+    {
+        ee_printf("ERROR! Please define ee_u32 to a 32b unsigned type!\n");
+    }
+    p->portable_id = 1;
+}
+
+void portable_fini(core_portable *p)
+{
+    p->portable_id = 0;
+}
+
+// Just enough printf for the CoreMark report: %c %s %d %u %x with an
+// optional 0 flag, width and l modifier. Output goes out a line at a time.
+static char out_buf[128];
+static ee_size_t out_len;
+
+static void out_char(char c)
+{
+    out_buf[out_len++] = c;
+    if (c == '\n' || out_len == sizeof(out_buf))
+    {
+        _write(STDOUT_FILENO, out_buf, out_len);
+        out_len = 0;
+    }
+}
+
+static void out_uint(ee_u32 value, ee_u32 base, int width, char pad)
+{
+    char digits[10];
+    int len = 0;
+
+    do
+    {
+        digits[len++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value != 0);
+    while (width-- > len)
+    {
+        out_char(pad);
+    }
+    while (len > 0)
+    {
+        out_char(digits[--len]);
+    }
+}
+
+int ee_printf(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    for (; *fmt != '\0'; fmt++)
+    {
+        char pad = ' ';
+        int width = 0;
+
+        if (*fmt != '%')
+        {
+            out_char(*fmt);
+            continue;
+        }
+        fmt++;
+        if (*fmt == '0')
+        {
+            pad = '0';
+            fmt++;
+        }
+        while (*fmt >= '0' && *fmt <= '9')
+        {
+            width = width * 10 + (*fmt++ - '0');
+        }
+        while (*fmt == 'l')
+        {
+            fmt++;
+        }
+        switch (*fmt)
+        {
+            case 'c':
+                out_char((char) va_arg(args, int));
+                break;
+            case 's':
+            {
+                const char *s = va_arg(args, const char *);
+                while (*s != '\0')
+                {
+                    out_char(*s++);
+                }
+                break;
+            }
+            case 'd':
+            {
+                ee_s32 value = va_arg(args, ee_s32);
+                if (value < 0)
+                {
+                    out_char('-');
+                    out_uint(-(ee_u32) value, 10, width - 1, pad);
+                }
+                else
+                {
+                    out_uint(value, 10, width, pad);
+                }
+                break;
+            }
+            case 'u':
+                out_uint(va_arg(args, ee_u32), 10, width, pad);
+                break;
+            case 'x':
+                out_uint(va_arg(args, ee_u32), 16, width, pad);
+                break;
+            case '\0':
+                fmt--;
+                break;
+            default:
+                out_char(*fmt);
+                break;
+        }
+    }
+    va_end(args);
+    return 0;
+}
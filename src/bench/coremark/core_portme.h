@@ -0,0 +1,78 @@
+#ifndef CORE_PORTME_H
+#define CORE_PORTME_H
+
+// CoreMark port for the dabble core. Runs from lib/crt0.S on hart 0 with
+// static memory, times with rdcycle and prints through the ecall proxy.
+
+#include <stdint.h>
+
+#define HAS_FLOAT           0
+#define HAS_TIME_H          0
+#define USE_CLOCK           0
+#define HAS_STDIO           0
+#define HAS_PRINTF          0
+
+#ifndef COMPILER_VERSION
+#define COMPILER_VERSION    __VERSION__
+#endif
+#ifndef COMPILER_FLAGS
+#define COMPILER_FLAGS      FLAGS_STR
+#endif
+#ifndef MEM_LOCATION
+#define MEM_LOCATION        "STATIC"
+#endif
+
+// cycles per second the reported times assume
+#ifndef CPU_MHZ
+#define CPU_MHZ             100
+#endif
+
+typedef int16_t     ee_s16;
+typedef uint16_t    ee_u16;
+typedef int32_t     ee_s32;
+typedef uint8_t     ee_u8;
+typedef uint32_t    ee_u32;
+typedef uint32_t    ee_ptr_int;
+typedef size_t      ee_size_t;
+
+#ifndef NULL
+#define NULL ((void *) 0)
+#endif
+
+#define align_mem(x) (void *) (4 + (((ee_ptr_int) (x) - 1) & ~3))
+
+#define CORETIMETYPE        ee_u32
+typedef ee_u32 CORE_TICKS;
+
+#define SEED_METHOD         SEED_VOLATILE
+#define MEM_METHOD          MEM_STATIC
+#define MULTITHREAD         1
+#define USE_PTHREAD         0
+#define USE_FORK            0
+#define USE_SOCKET          0
+#define MAIN_HAS_NOARGC     1
+#define MAIN_HAS_NORETURN   0
+
+extern ee_u32 default_num_contexts;
+
+typedef struct CORE_PORTABLE_S
+{
+    ee_u8 portable_id;
+} core_portable;
+
+void portable_init(core_portable *p, int *argc, char *argv[]);
+void portable_fini(core_portable *p);
+
+#if !defined(PROFILE_RUN) && !defined(PERFORMANCE_RUN) && !defined(VALIDATION_RUN)
+#if (TOTAL_DATA_SIZE == 1200)
+#define PROFILE_RUN 1
+#elif (TOTAL_DATA_SIZE == 2000)
+#define PERFORMANCE_RUN 1
+#else
+#define VALIDATION_RUN 1
+#endif
+#endif
+
+int ee_printf(const char *fmt, ...);
+
+#endif
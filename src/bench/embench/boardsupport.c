@@ -0,0 +1,19 @@
+#include <support.h>
+#include <bench.h>
+
+// main() in the Embench support code brackets benchmark() with the triggers,
+// the runner reports what they measure
+
+void initialise_board(void)
+{
+}
+
+void __attribute__((noinline)) start_trigger(void)
+{
+    bench_start();
+}
+
+void __attribute__((noinline)) stop_trigger(void)
+{
+    bench_stop();
+}
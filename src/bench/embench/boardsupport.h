@@ -0,0 +1,10 @@
+#ifndef BOARDSUPPORT_H
+#define BOARDSUPPORT_H
+
+// Embench board support for the dabble core, see boardsupport.c. The
+// benchmarks scale their loop counts by CPU_MHZ, set from the Makefile.
+#ifndef CPU_MHZ
+#define CPU_MHZ 1
+#endif
+
+#endif
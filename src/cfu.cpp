@@ -0,0 +1,119 @@
+#include <stdint.h>
+#include <cfu.h>
+
+// The example accelerator reached through its custom-0 instructions and
+// through its register window, see run_cfu() in rtl/tb/core/main.cpp for
+// the host side. With scale_harts set the first that many harts share a
+// multiply kernel instead, see run_cfu_scaling(). Every fetch goes over the
+// one shared ram port, the multiplier of each hart is what runs next to the
+// others, so rounds of multiplies per item keep the harts on it.
+#define OPERANDS     256
+#define SCALE_ITEMS  256
+#define SCALE_ROUNDS 8
+#define SCALE_MIX    0x9e3779b1u
+
+volatile uint32_t *results     = (volatile uint32_t *) 0x1F500;
+volatile uint32_t *scale_harts = (volatile uint32_t *) 0x1F514;
+volatile uint32_t *scale_total = (volatile uint32_t *) 0x1F518;
+volatile uint32_t *scale_done  = (volatile uint32_t *) 0x1F51C;
+
+static inline uint32_t hart_id(void)
+{
+    uint32_t id;
+    asm volatile ("csrr %0, mhartid" : "=r"(id));
+    return id;
+}
+
+static inline uint32_t cycle(void)
+{
+    uint32_t c;
+    asm volatile ("rdcycle %0" : "=r"(c));
+    return c;
+}
+
+// xorshift, the image has no runtime to multiply with
+static inline uint32_t next(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    return x ^ x << 5;
+}
+
+// off the bus for good, nothing a hart enables here can wake it
+static inline void park(void)
+{
+    while (true)
+    {
+        asm volatile ("wfi");
+    }
+}
+
+static void scale(uint32_t harts)
+{
+    uint32_t sum = 0;
+
+    if (hart_id() >= harts)
+    {
+        park();
+    }
+
+    // interleave the items so every hart gets the same amount
+    for (uint32_t i = hart_id(); i < SCALE_ITEMS; i += harts)
+    {
+        uint32_t x = next(i + 1);
+
+        for (uint32_t r = 0; r < SCALE_ROUNDS; r++)
+        {
+            x = cfu_mul(x, SCALE_MIX) + cfu_mulhu(x, SCALE_MIX);
+        }
+        sum += x;
+    }
+
+    __atomic_fetch_add(scale_total, sum, __ATOMIC_RELAXED);
+    __atomic_fetch_add(scale_done, 1, __ATOMIC_RELEASE);
+    park();
+}
+
+extern "C" void _start(void)
+{
+    uint32_t start;
+    uint32_t x;
+    uint32_t sum;
+
+    if (*scale_harts != 0)
+    {
+        scale(*scale_harts);
+    }
+    if (hart_id() != 0)
+    {
+        park();
+    }
+
+    start = cycle();
+    x = 1;
+    sum = 0;
+    for (uint32_t i = 0; i < OPERANDS; i++)
+    {
+        uint32_t y = next(x);
+        sum += (cfu_mul(x, y) ^ cfu_mulhu(x, y)) + cfu_sad(x, y);
+        x = next(y);
+    }
+    results[0] = cycle() - start;
+    results[2] = sum;
+
+    start = cycle();
+    x = 1;
+    sum = 0;
+    for (uint32_t i = 0; i < OPERANDS; i++)
+    {
+        uint32_t y = next(x);
+        sum += (cfu_mmio_op(CFU_MUL, x, y) ^ cfu_mmio_op(CFU_MULHU, x, y)) +
+               cfu_mmio_op(CFU_SAD, x, y);
+        x = next(y);
+    }
+    results[1] = cycle() - start;
+    results[3] = sum;
+
+    results[4] = 1;
+    park();
+}
@@ -0,0 +1,67 @@
+#include <stdint.h>
+#include <dma.h>
+
+// Copy bandwidth of the dma engine against a plain load/store loop, see
+// run_dma() in rtl/tb/core/main.cpp for the host side
+#define COPY_WORDS 1024
+
+volatile uint32_t *results = (volatile uint32_t *) 0x1F300;
+
+// in the buffer window of link.txt, below the stack and off the heap
+uint32_t *src      = (uint32_t *) 0x30000;
+uint32_t *dst_cpu  = (uint32_t *) 0x31000;
+uint32_t *dst_dma  = (uint32_t *) 0x32000;
+uint32_t *dst_odd  = (uint32_t *) 0x33000;
+
+static inline uint32_t hart_id(void)
+{
+    uint32_t id;
+    asm volatile ("csrr %0, mhartid" : "=r"(id));
+    return id;
+}
+
+static inline uint32_t cycle(void)
+{
+    uint32_t c;
+    asm volatile ("rdcycle %0" : "=r"(c));
+    return c;
+}
+
+extern "C" void _start(void)
+{
+    uint32_t start;
+
+    // the other harts stay off the bus, nothing they enable can wake them
+    if (hart_id() != 0)
+    {
+        while (true)
+        {
+            asm volatile ("wfi");
+        }
+    }
+
+    // volatile keeps clang from turning the loop into a memcpy call
+    start = cycle();
+    for (uint32_t i = 0; i < COPY_WORDS; i++)
+    {
+        ((volatile uint32_t *) dst_cpu)[i] = ((volatile uint32_t *) src)[i];
+    }
+    results[0] = cycle() - start;
+
+    start = cycle();
+    dma_start(dst_dma, src, COPY_WORDS);
+    dma_sleep();
+    results[1] = cycle() - start;
+
+    // gather the odd words into a packed buffer
+    start = cycle();
+    dma_start_strided(dst_odd, 4, src + 1, 8, COPY_WORDS / 2);
+    dma_sleep();
+    results[2] = cycle() - start;
+
+    results[3] = 1;
+    while (true)
+    {
+        asm volatile ("wfi");
+    }
+}
@@ -0,0 +1,58 @@
+#include <stdint.h>
+
+// Command service on the test.cpp mailbox for the fork-server fuzzer, see
+// run_fuzz() in rtl/tb/core/main.cpp. a holds the command in its low byte
+// and an operand above it, b the argument, the result goes to y. Like
+// test.cpp it runs without a stack, so everything has to stay in registers.
+volatile uint32_t *a = (volatile uint32_t *) 0x1F000;
+volatile uint32_t *b = (volatile uint32_t *) 0x1F004;
+volatile uint32_t *y = (volatile uint32_t *) 0x1F008;
+
+static const uint32_t squares[16] = {
+    0, 1, 4, 9, 16, 25, 36, 49, 64, 81, 100, 121, 144, 169, 196, 225
+};
+
+extern "C" void _start(void)
+{
+    while (true)
+    {
+        uint32_t cmd = *a;
+        uint32_t arg = *b;
+        uint32_t op = cmd >> 8;
+        uint32_t r;
+
+        switch (cmd & 0xff) {
+        case 1:
+            r = arg + op;
+            break;
+        case 2:
+            r = squares[arg & 15];
+            break;
+        case 3:
+            // hash of the first arg % 32 numbers
+            r = 0;
+            for (uint32_t i = 0; i < (arg & 31); i++)
+                r = r * 31 + i;
+            break;
+        case 4:
+            // a three byte key, each byte is its own branch
+            r = arg;
+            if ((op & 0xff) == 'k') {
+                r ^= 1;
+                if ((op >> 8 & 0xff) == 'e') {
+                    r ^= 2;
+                    if ((op >> 16) == 'y')
+                        r = ~arg;
+                }
+            }
+            break;
+        case 5:
+            r = arg > op ? arg - op : op - arg;
+            break;
+        default:
+            r = cmd + arg;
+            break;
+        }
+        *y = r;
+    }
+}
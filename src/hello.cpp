@@ -0,0 +1,41 @@
+#include <stdint.h>
+#include <syscalls.h>
+
+// Host I/O through the ecall proxy, see run_semihost() in
+// rtl/tb/core/main.cpp for the input it gets and the output it expects
+char line[64];
+
+static inline uint32_t hart_id(void)
+{
+    uint32_t id;
+    asm volatile ("csrr %0, mhartid" : "=r"(id));
+    return id;
+}
+
+extern "C" void _start(void)
+{
+    if (hart_id() != 0)
+    {
+        while (true)
+        {
+            asm volatile ("wfi");
+        }
+    }
+
+    uint32_t start = clock();
+
+    print("hello from the dabble core\n");
+    ssize_t n = _read(STDIN_FILENO, line, sizeof(line));
+    for (ssize_t i = 0; i < n; i++)
+    {
+        if (line[i] >= 'a' && line[i] <= 'z')
+        {
+            line[i] -= 'a' - 'A';
+        }
+    }
+    _write(STDOUT_FILENO, line, n);
+    print("cycles: ");
+    print_uint(clock() - start);
+    print("\n");
+    _exit(n < 0);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+// Region of interest counters for the benchmark runner, see run_bench() in
+// rtl/tb/core/main.cpp. bench_start() leaves the current counters in the
+// mailbox and bench_stop() turns them into the elapsed counts.
+#define BENCH_RESULTS       0x1F400
+
+#define BENCH_CYCLES_LO     (*(volatile uint32_t *) (BENCH_RESULTS + 0x00))
+#define BENCH_CYCLES_HI     (*(volatile uint32_t *) (BENCH_RESULTS + 0x04))
+#define BENCH_INSTRET_LO    (*(volatile uint32_t *) (BENCH_RESULTS + 0x08))
+#define BENCH_INSTRET_HI    (*(volatile uint32_t *) (BENCH_RESULTS + 0x0C))
+#define BENCH_VALID         (*(volatile uint32_t *) (BENCH_RESULTS + 0x10))
+
+static inline uint32_t bench_cycles_hi(void)
+{
+    uint32_t hi;
+    asm volatile ("rdcycleh %0" : "=r"(hi));
+    return hi;
+}
+
+static inline uint32_t bench_instret_hi(void)
+{
+    uint32_t hi;
+    asm volatile ("rdinstreth %0" : "=r"(hi));
+    return hi;
+}
+
+// re-read when the low word wrapped between the two halves
+static inline uint64_t bench_cycles(void)
+{
+    uint32_t hi;
+    uint32_t lo;
+
+    do
+    {
+        hi = bench_cycles_hi();
+        asm volatile ("rdcycle %0" : "=r"(lo));
+    } while (hi != bench_cycles_hi());
+    return ((uint64_t) hi << 32) | lo;
+}
+
+static inline uint64_t bench_instret(void)
+{
+    uint32_t hi;
+    uint32_t lo;
+
+    do
+    {
+        hi = bench_instret_hi();
+        asm volatile ("rdinstret %0" : "=r"(lo));
+    } while (hi != bench_instret_hi());
+    return ((uint64_t) hi << 32) | lo;
+}
+
+static inline void bench_start(void)
+{
+    uint64_t instret = bench_instret();
+    uint64_t cycles = bench_cycles();
+
+    BENCH_VALID = 0;
+    BENCH_CYCLES_LO = (uint32_t) cycles;
+    BENCH_CYCLES_HI = (uint32_t) (cycles >> 32);
+    BENCH_INSTRET_LO = (uint32_t) instret;
+    BENCH_INSTRET_HI = (uint32_t) (instret >> 32);
+}
+
+static inline void bench_stop(void)
+{
+    uint64_t cycles = bench_cycles();
+    uint64_t instret = bench_instret();
+
+    cycles -= ((uint64_t) BENCH_CYCLES_HI << 32) | BENCH_CYCLES_LO;
+    instret -= ((uint64_t) BENCH_INSTRET_HI << 32) | BENCH_INSTRET_LO;
+    BENCH_CYCLES_LO = (uint32_t) cycles;
+    BENCH_CYCLES_HI = (uint32_t) (cycles >> 32);
+    BENCH_INSTRET_LO = (uint32_t) instret;
+    BENCH_INSTRET_HI = (uint32_t) (instret >> 32);
+    BENCH_VALID = 1;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+// Intrinsics for the custom-0 accelerator port, see rtl/cfu_mac.sv for the
+// functions of the example accelerator. Each one is a single R-type
+// instruction, the core waits in it until the accelerator is done.
+#define CFU_MUL             0
+#define CFU_MULHU           1
+#define CFU_SAD             2
+
+// func3 and func7 have to be constants, they are encoded in the instruction.
+// 0x0b is the custom-0 major opcode.
+#define CFU_OP(func3, func7, a, b) ({                                       \
+    uint32_t _r;                                                            \
+    asm (".insn r 0x0b, %1, %2, %0, %3, %4"                                 \
+         : "=r"(_r) : "i"(func3), "i"(func7), "r"(a), "r"(b));              \
+    _r;                                                                     \
+})
+
+static inline uint32_t cfu_mul(uint32_t a, uint32_t b)
+{
+    return CFU_OP(CFU_MUL, 0, a, b);
+}
+
+static inline uint32_t cfu_mulhu(uint32_t a, uint32_t b)
+{
+    return CFU_OP(CFU_MULHU, 0, a, b);
+}
+
+static inline uint32_t cfu_sad(uint32_t a, uint32_t b)
+{
+    return CFU_OP(CFU_SAD, 0, a, b);
+}
+
+// The same accelerator behind the cfu_mmio register window in top.sv. Every
+// access is a peripheral load or store, which costs the core a stall cycle.
+#define CFU_MMIO_BASE       0x3FFC0
+
+#define CFU_MMIO_RS1        (*(volatile uint32_t *) (CFU_MMIO_BASE + 0x00))
+#define CFU_MMIO_RS2        (*(volatile uint32_t *) (CFU_MMIO_BASE + 0x04))
+#define CFU_MMIO_FUNC       (*(volatile uint32_t *) (CFU_MMIO_BASE + 0x08))
+#define CFU_MMIO_RESULT     (*(volatile uint32_t *) (CFU_MMIO_BASE + 0x0C))
+
+#define CFU_MMIO_BUSY       (1 << 0)
+
+static inline uint32_t cfu_mmio_op(uint32_t func, uint32_t a, uint32_t b)
+{
+    CFU_MMIO_RS1 = a;
+    CFU_MMIO_RS2 = b;
+    CFU_MMIO_FUNC = func;
+    while (CFU_MMIO_FUNC & CFU_MMIO_BUSY)
+    {
+    }
+    return CFU_MMIO_RESULT;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+// Driver for the dma engine in rtl/dma.sv, see there for the register map.
+// Addresses and strides are in bytes and have to be word aligned.
+#define DMA_BASE            0x3FF80
+
+#define DMA_SRC             (*(volatile uint32_t *) (DMA_BASE + 0x00))
+#define DMA_DST             (*(volatile uint32_t *) (DMA_BASE + 0x04))
+#define DMA_COUNT           (*(volatile uint32_t *) (DMA_BASE + 0x08))
+#define DMA_SRC_STRIDE      (*(volatile uint32_t *) (DMA_BASE + 0x0C))
+#define DMA_DST_STRIDE      (*(volatile uint32_t *) (DMA_BASE + 0x10))
+#define DMA_CTRL            (*(volatile uint32_t *) (DMA_BASE + 0x14))
+#define DMA_STATUS          (*(volatile uint32_t *) (DMA_BASE + 0x18))
+
+#define DMA_CTRL_START      (1 << 0)
+#define DMA_CTRL_IRQ_EN     (1 << 1)
+#define DMA_STATUS_BUSY     (1 << 0)
+#define DMA_STATUS_DONE     (1 << 1)
+
+#define DMA_MIE_MEIE        (1 << 11)
+
+// Move count words, stepping the source and destination by their own stride
+// after every word. The engine takes one transfer at a time.
+static inline void dma_start_strided(void *dst, uint32_t dst_stride,
+                                     const void *src, uint32_t src_stride,
+                                     uint32_t count)
+{
+    DMA_SRC = (uint32_t) src;
+    DMA_DST = (uint32_t) dst;
+    DMA_COUNT = count;
+    DMA_SRC_STRIDE = src_stride;
+    DMA_DST_STRIDE = dst_stride;
+    DMA_CTRL = DMA_CTRL_START | DMA_CTRL_IRQ_EN;
+}
+
+static inline void dma_start(void *dst, const void *src, uint32_t count)
+{
+    dma_start_strided(dst, 4, src, 4, count);
+}
+
+static inline bool dma_busy(void)
+{
+    return DMA_STATUS & DMA_STATUS_BUSY;
+}
+
+// Spin on the status register. Every poll is a bus cycle the transfer does
+// not get.
+static inline void dma_wait(void)
+{
+    while (dma_busy())
+    {
+    }
+    DMA_STATUS = DMA_STATUS_DONE;
+}
+
+// Park the hart in wfi until the completion interrupt, leaving the bus to the
+// engine. The interrupt is the machine external one, so with mstatus.MIE set
+// the trap handler sees it first and has to leave the done bit alone.
+static inline void dma_sleep(void)
+{
+    asm volatile ("csrs mie, %0" :: "r"(DMA_MIE_MEIE));
+    while (dma_busy())
+    {
+        asm volatile ("wfi");
+    }
+    DMA_STATUS = DMA_STATUS_DONE;
+}
@@ -0,0 +1,21 @@
+#include <stdint.h>
+
+// Newlib style break for malloc, between __heap_start and __heap_end from
+// link.txt
+
+extern char __heap_start[];
+extern char __heap_end[];
+
+static char *heap_top = __heap_start;
+
+void *_sbrk(ssize_t incr)
+{
+    char *prev = heap_top;
+
+    if (incr > __heap_end - heap_top || incr < __heap_start - heap_top)
+    {
+        return (void *) -1;
+    }
+    heap_top += incr;
+    return prev;
+}
@@ -0,0 +1,19 @@
+#include <string.h>
+
+// Overlap safe copy, forwards through the word wide memcpy in lib/string.S
+// when that cannot clobber the source, backwards a byte at a time otherwise.
+void *memmove(void *dst, const void *src, size_t len)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+
+    if (d <= s || d >= s + len)
+    {
+        return memcpy(dst, src, len);
+    }
+    while (len--)
+    {
+        d[len] = s[len];
+    }
+    return dst;
+}
@@ -0,0 +1,129 @@
+#include <stdint.h>
+
+// Multiply and divide helpers clang calls on a core without the M extension,
+// under the libgcc / compiler-rt names. Shift and add only, so nothing in
+// here turns into a call back into this file.
+
+uint32_t __mulsi3(uint32_t a, uint32_t b)
+{
+    uint32_t r = 0;
+
+    while (b != 0)
+    {
+        if (b & 1)
+        {
+            r += a;
+        }
+        a <<= 1;
+        b >>= 1;
+    }
+    return r;
+}
+
+uint64_t __muldi3(uint64_t a, uint64_t b)
+{
+    uint64_t r = 0;
+
+    while (b != 0)
+    {
+        if (b & 1)
+        {
+            r += a;
+        }
+        a <<= 1;
+        b >>= 1;
+    }
+    return r;
+}
+
+// Restoring division. A zero divisor gives an all ones quotient and the
+// dividend as remainder, the same as the M extension.
+static uint32_t udivmodsi(uint32_t n, uint32_t d, uint32_t *rem)
+{
+    uint32_t q = 0;
+    uint32_t r = 0;
+
+    for (int i = 31; i >= 0; i--)
+    {
+        r = (r << 1) | ((n >> i) & 1);
+        if (r >= d)
+        {
+            r -= d;
+            q |= (uint32_t) 1 << i;
+        }
+    }
+    *rem = r;
+    return q;
+}
+
+static uint64_t udivmoddi(uint64_t n, uint64_t d, uint64_t *rem)
+{
+    uint64_t q = 0;
+    uint64_t r = 0;
+
+    for (int i = 63; i >= 0; i--)
+    {
+        r = (r << 1) | ((n >> i) & 1);
+        if (r >= d)
+        {
+            r -= d;
+            q |= (uint64_t) 1 << i;
+        }
+    }
+    *rem = r;
+    return q;
+}
+
+uint32_t __udivsi3(uint32_t n, uint32_t d)
+{
+    uint32_t r;
+    return udivmodsi(n, d, &r);
+}
+
+uint32_t __umodsi3(uint32_t n, uint32_t d)
+{
+    uint32_t r;
+    udivmodsi(n, d, &r);
+    return r;
+}
+
+int32_t __divsi3(int32_t n, int32_t d)
+{
+    uint32_t r;
+    uint32_t q = udivmodsi(n < 0 ? -(uint32_t) n : n, d < 0 ? -(uint32_t) d : d, &r);
+    return (n < 0) != (d < 0) ? -q : q;
+}
+
+int32_t __modsi3(int32_t n, int32_t d)
+{
+    uint32_t r;
+    udivmodsi(n < 0 ? -(uint32_t) n : n, d < 0 ? -(uint32_t) d : d, &r);
+    return n < 0 ? -r : r;
+}
+
+uint64_t __udivdi3(uint64_t n, uint64_t d)
+{
+    uint64_t r;
+    return udivmoddi(n, d, &r);
+}
+
+uint64_t __umoddi3(uint64_t n, uint64_t d)
+{
+    uint64_t r;
+    udivmoddi(n, d, &r);
+    return r;
+}
+
+int64_t __divdi3(int64_t n, int64_t d)
+{
+    uint64_t r;
+    uint64_t q = udivmoddi(n < 0 ? -(uint64_t) n : n, d < 0 ? -(uint64_t) d : d, &r);
+    return (n < 0) != (d < 0) ? -q : q;
+}
+
+int64_t __moddi3(int64_t n, int64_t d)
+{
+    uint64_t r;
+    udivmoddi(n < 0 ? -(uint64_t) n : n, d < 0 ? -(uint64_t) d : d, &r);
+    return n < 0 ? -r : r;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+// Single producer, single consumer request ring in ram, shared with the host
+// side in rtl/tb/core/ring_host.h.
+//
+// The host fills descriptors and publishes them by moving head, the firmware
+// answers them in place and publishes the answers by moving done. Each index
+// has a single writer and runs freely, the slot is the index modulo
+// RING_ENTRIES. A slot is free again once the host has read its answer back.
+//
+//  byte offset | field
+//  ------------+-------------------------------------------------------------
+//  0x00        | head, written by the host
+//  0x04        | done, written by the firmware
+//  0x40 + 16*n | descriptor n: a, b, y = a + b, unused
+// in the buffer window of src/link.txt, below the stack and off the heap
+#define RING_BASE       0x38000
+#define RING_ENTRIES    64
+
+#define RING_HEAD       (RING_BASE + 0x00)
+#define RING_DONE       (RING_BASE + 0x04)
+#define RING_DESC(n)    (RING_BASE + 0x40 + 16 * ((n) & (RING_ENTRIES - 1)))
+#define RING_DESC_A     0x0
+#define RING_DESC_B     0x4
+#define RING_DESC_Y     0x8
+
+struct ring_desc {
+    uint32_t a;
+    uint32_t b;
+    uint32_t y;
+    uint32_t unused;
+};
+
+// Firmware side. The acquire load keeps the descriptor reads after it and
+// the release store keeps the answers before it.
+static inline uint32_t ring_head(void)
+{
+    return __atomic_load_n((uint32_t *) RING_HEAD, __ATOMIC_ACQUIRE);
+}
+
+static inline void ring_complete(uint32_t done)
+{
+    __atomic_store_n((uint32_t *) RING_DONE, done, __ATOMIC_RELEASE);
+}
+
+static inline ring_desc *ring_slot(uint32_t n)
+{
+    return (ring_desc *) RING_DESC(0) + (n & (RING_ENTRIES - 1));
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+// The bits of the C library the compiler and the benchmarks call into,
+// word wide versions in lib/string.S and memmove in lib/memmove.c
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *memcpy(void *dst, const void *src, size_t len);
+void *memmove(void *dst, const void *src, size_t len);
+void *memset(void *dst, int value, size_t len);
+int memcmp(const void *a, const void *b, size_t len);
+size_t strlen(const char *s);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+
+// Newlib style system call stubs, serviced by the testbench over ecall, see
+// semihost_call() in rtl/tb/core/main.cpp. The call number goes in a7, the
+// arguments in a0 - a2 and the result comes back in a0, negative on error.
+#define SYS_READ        63
+#define SYS_WRITE       64
+#define SYS_EXIT        93
+// not a newlib call, low word of the simulated cycle count on the host
+#define SYS_CLOCK       1024
+
+#define STDIN_FILENO    0
+#define STDOUT_FILENO   1
+#define STDERR_FILENO   2
+
+static inline uint32_t syscall3(uint32_t n, uint32_t a0, uint32_t a1, uint32_t a2)
+{
+    register uint32_t r_a0 asm("a0") = a0;
+    register uint32_t r_a1 asm("a1") = a1;
+    register uint32_t r_a2 asm("a2") = a2;
+    register uint32_t r_a7 asm("a7") = n;
+
+    // the host reads and writes the buffers behind our back
+    asm volatile ("ecall" : "+r"(r_a0) : "r"(r_a1), "r"(r_a2), "r"(r_a7) : "memory");
+    return r_a0;
+}
+
+// lib/heap.c, for the images that link the crt0 runtime
+#ifdef __cplusplus
+extern "C"
+#endif
+void *_sbrk(ssize_t incr);
+
+static inline ssize_t _write(int fd, const void *buf, size_t len)
+{
+    return syscall3(SYS_WRITE, fd, (uint32_t) buf, len);
+}
+
+static inline ssize_t _read(int fd, void *buf, size_t len)
+{
+    return syscall3(SYS_READ, fd, (uint32_t) buf, len);
+}
+
+static inline __attribute__((noreturn)) void _exit(int code)
+{
+    syscall3(SYS_EXIT, code, 0, 0);
+    // the host stops the simulation, the core never gets the ack
+    for (;;)
+    {
+    }
+}
+
+static inline uint32_t clock(void)
+{
+    return syscall3(SYS_CLOCK, 0, 0, 0);
+}
+
+static inline size_t str_len(const char *s)
+{
+    size_t len = 0;
+
+    while (s[len] != '\0')
+    {
+        len++;
+    }
+    return len;
+}
+
+static inline void print(const char *s)
+{
+    _write(STDOUT_FILENO, s, str_len(s));
+}
+
+// Without the M extension a division is a libcall we do not link, so the
+// digits come from subtracting powers of ten. Static buffers, the images do
+// not set up a stack.
+static inline void print_uint(uint32_t value)
+{
+    static uint32_t scale[10];
+    static char buf[10];
+    uint32_t digits = 1;
+
+    scale[0] = 1;
+    while (digits < 10 && scale[digits - 1] * 10 <= value)
+    {
+        scale[digits] = scale[digits - 1] * 10;
+        digits++;
+    }
+    for (uint32_t i = 0; i < digits; i++)
+    {
+        char digit = '0';
+
+        while (value >= scale[digits - 1 - i])
+        {
+            value -= scale[digits - 1 - i];
+            digit++;
+        }
+        buf[i] = digit;
+    }
+    _write(STDOUT_FILENO, buf, digits);
+}
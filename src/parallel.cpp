@@ -0,0 +1,81 @@
+#include <stdint.h>
+
+// Every hart runs this image, see run_parallel() in rtl/tb/core/main.cpp for
+// the host side of the mailbox. The harts from num_harts on sit it out, so
+// the same image checks one hart and all of them.
+#define WORK_ITEMS 256
+#define ROUNDS     8
+
+volatile uint32_t *num_harts = (volatile uint32_t *) 0x1F100;
+volatile uint32_t *total     = (volatile uint32_t *) 0x1F104;
+volatile uint32_t *done      = (volatile uint32_t *) 0x1F108;
+volatile uint32_t *items     = (volatile uint32_t *) 0x1F10C;
+volatile uint32_t *work      = (volatile uint32_t *) 0x1F200;
+
+static inline uint32_t hart_id(void)
+{
+    uint32_t id;
+    asm volatile ("csrr %0, mhartid" : "=r"(id));
+    return id;
+}
+
+// xorshift, the image has no runtime to multiply with
+static inline uint32_t next(uint32_t x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    return x ^ x << 5;
+}
+
+// *p += value in an LR/SC loop, retried whenever another hart wrote the
+// word in between
+static inline void reserved_add(volatile uint32_t *p, uint32_t value)
+{
+    uint32_t sum;
+    uint32_t fail;
+
+    asm volatile ("1: lr.w %0, (%2)\n"
+                  "   add  %0, %0, %3\n"
+                  "   sc.w %1, %0, (%2)\n"
+                  "   bnez %1, 1b"
+                  : "=&r"(sum), "=&r"(fail) : "r"(p), "r"(value) : "memory");
+}
+
+// off the bus for good, nothing a hart enables here can wake it
+static inline void park(void)
+{
+    while (true)
+    {
+        asm volatile ("wfi");
+    }
+}
+
+extern "C" void _start(void)
+{
+    uint32_t harts = *num_harts;
+    uint32_t sum = 0;
+
+    if (hart_id() >= harts)
+    {
+        park();
+    }
+
+    // interleave the work items so every hart touches the same amount
+    for (uint32_t i = hart_id(); i < WORK_ITEMS; i += harts)
+    {
+        uint32_t x = work[i];
+
+        for (uint32_t r = 0; r < ROUNDS; r++)
+        {
+            x = next(x);
+        }
+        sum += x;
+        // one AMO per item, so the harts keep contending for the word
+        __atomic_fetch_add(items, 1, __ATOMIC_RELAXED);
+    }
+
+    reserved_add(total, sum);
+    __atomic_fetch_add(done, 1, __ATOMIC_RELEASE);
+
+    park();
+}
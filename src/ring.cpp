@@ -0,0 +1,46 @@
+#include <stdint.h>
+#include <ring.h>
+
+// a + b service fed through the request ring instead of the single mailbox
+// of test.cpp, see run_ring() in rtl/tb/core/main.cpp for the host side
+
+static inline uint32_t hart_id(void)
+{
+    uint32_t id;
+    asm volatile ("csrr %0, mhartid" : "=r"(id));
+    return id;
+}
+
+extern "C" void _start(void)
+{
+    // the host clears the indices before releasing reset
+    uint32_t tail = 0;
+
+    // one consumer only, the other harts stay off the bus
+    if (hart_id() != 0)
+    {
+        while (true)
+        {
+            asm volatile ("wfi");
+        }
+    }
+
+    while (true)
+    {
+        uint32_t head = ring_head();
+
+        if (tail == head)
+        {
+            continue;
+        }
+        // answer everything published so far, then complete it with a single
+        // store
+        while (tail != head)
+        {
+            ring_desc *d = ring_slot(tail);
+            d->y = d->a + d->b;
+            tail++;
+        }
+        ring_complete(tail);
+    }
+}
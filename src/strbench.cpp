@@ -0,0 +1,199 @@
+#include <stdint.h>
+#include <string.h>
+#include <syscalls.h>
+#include <bench.h>
+
+// Checks the word wide string functions in lib/string.S against byte loops
+// over every small size and alignment, then times both on a 1 KiB buffer.
+// Exits with the number of mismatches, run_strbench() in rtl/tb/core/main.cpp
+// expects 0.
+#define BUF_SIZE    1024
+#define CHECK_SIZE  80
+// sizes plus the largest offset plus guard bytes either side
+#define CHECK_BUF   (CHECK_SIZE + 8)
+
+static uint8_t src[BUF_SIZE + 8];
+static uint8_t dst[BUF_SIZE + 8];
+static uint8_t ref[BUF_SIZE + 8];
+// keeps the timed calls whose result nobody needs
+static volatile int sink;
+
+// no_builtin keeps clang from turning the reference loops back into calls
+__attribute__((no_builtin("memcpy"), noinline))
+static void byte_copy(uint8_t *d, const uint8_t *s, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        d[i] = s[i];
+    }
+}
+
+__attribute__((no_builtin("memset"), noinline))
+static void byte_set(uint8_t *d, uint8_t value, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        d[i] = value;
+    }
+}
+
+__attribute__((no_builtin("memcmp"), noinline))
+static int byte_cmp(const uint8_t *a, const uint8_t *b, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (a[i] != b[i])
+        {
+            return a[i] - b[i];
+        }
+    }
+    return 0;
+}
+
+__attribute__((no_builtin("strlen"), noinline))
+static size_t byte_len(const uint8_t *s)
+{
+    size_t len = 0;
+
+    while (s[len] != 0)
+    {
+        len++;
+    }
+    return len;
+}
+
+// xorshift, a multiply would be a libcall per byte; never a zero byte
+static void fill(uint8_t *buf, uint32_t seed, size_t len)
+{
+    seed |= 1;
+    for (size_t i = 0; i < len; i++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        buf[i] = seed | 1;
+    }
+}
+
+static int sign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+static uint32_t check(void)
+{
+    uint32_t errors = 0;
+
+    for (size_t len = 0; len < CHECK_SIZE; len++)
+    {
+        for (size_t s_off = 0; s_off < 4; s_off++)
+        {
+            for (size_t d_off = 0; d_off < 4; d_off++)
+            {
+                fill(src, len, CHECK_BUF);
+                fill(dst, ~len, CHECK_BUF);
+                fill(ref, ~len, CHECK_BUF);
+                memcpy(dst + d_off, src + s_off, len);
+                byte_copy(ref + d_off, src + s_off, len);
+                errors += byte_cmp(dst, ref, CHECK_BUF) != 0;
+
+                memset(dst + d_off, s_off, len);
+                byte_set(ref + d_off, s_off, len);
+                errors += byte_cmp(dst, ref, CHECK_BUF) != 0;
+
+                // equal, then different in the last byte of the range
+                byte_copy(dst + d_off, src + s_off, len);
+                errors += memcmp(dst + d_off, src + s_off, len) != 0;
+                if (len > 0)
+                {
+                    dst[d_off + len - 1] ^= 0x80;
+                    errors += sign(memcmp(dst + d_off, src + s_off, len))
+                        != sign(byte_cmp(dst + d_off, src + s_off, len));
+                }
+            }
+            src[s_off + len] = 0;
+            errors += strlen((char *) src + s_off) != byte_len(src + s_off);
+            fill(src, len, CHECK_BUF);
+        }
+    }
+
+    // overlapping moves in both directions
+    for (size_t len = 0; len < CHECK_SIZE; len++)
+    {
+        fill(src, len, CHECK_BUF);
+        byte_copy(dst, src, CHECK_BUF);
+        memmove(src + 3, src, len);
+        byte_copy(ref + 3, dst, len);
+        errors += byte_cmp(src + 3, ref + 3, len) != 0;
+        byte_copy(src, dst, CHECK_BUF);
+        memmove(src, src + 5, len);
+        errors += byte_cmp(src, dst + 5, len) != 0;
+    }
+    return errors;
+}
+
+// cycles per byte with two decimals
+static void report(const char *name, const char *variant, uint32_t cycles)
+{
+    uint32_t centi = cycles * 100 / BUF_SIZE;
+
+    print(name);
+    print(variant);
+    print_uint(centi / 100);
+    print(".");
+    if (centi % 100 < 10)
+    {
+        print("0");
+    }
+    print_uint(centi % 100);
+    print(" cycles/byte\n");
+}
+
+static void time_all(const char *variant, size_t off)
+{
+    uint64_t start;
+
+    fill(src, 1, sizeof(src));
+    src[off + BUF_SIZE - 1] = 0;
+
+    start = bench_cycles();
+    byte_copy(dst + off, src, BUF_SIZE);
+    report("byte memcpy ", variant, bench_cycles() - start);
+    start = bench_cycles();
+    memcpy(dst + off, src, BUF_SIZE);
+    report("word memcpy ", variant, bench_cycles() - start);
+
+    start = bench_cycles();
+    byte_set(dst + off, 0x5a, BUF_SIZE);
+    report("byte memset ", variant, bench_cycles() - start);
+    start = bench_cycles();
+    memset(dst + off, 0x5a, BUF_SIZE);
+    report("word memset ", variant, bench_cycles() - start);
+
+    byte_copy(dst + off, src + off, BUF_SIZE);
+    start = bench_cycles();
+    sink = byte_cmp(dst + off, src + off, BUF_SIZE);
+    report("byte memcmp ", variant, bench_cycles() - start);
+    start = bench_cycles();
+    sink = memcmp(dst + off, src + off, BUF_SIZE);
+    report("word memcmp ", variant, bench_cycles() - start);
+
+    start = bench_cycles();
+    sink = byte_len(src + off);
+    report("byte strlen ", variant, bench_cycles() - start);
+    start = bench_cycles();
+    sink = strlen((char *) src + off);
+    report("word strlen ", variant, bench_cycles() - start);
+}
+
+int main()
+{
+    uint32_t errors = check();
+
+    print("mismatches: ");
+    print_uint(errors);
+    print("\n");
+    time_all("aligned    ", 0);
+    time_all("misaligned ", 1);
+    return errors;
+}
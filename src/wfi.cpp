@@ -0,0 +1,84 @@
+#include <stdint.h>
+
+// Same a + b service as test.cpp, but woken by the host doorbell instead of
+// polling, plus a periodic timer tick. See run_wfi() in rtl/tb/core/main.cpp.
+#define CLINT_BASE   0x3FF00
+#define STACK_TOP    0x3F000
+#define TICK_CYCLES  1000
+
+#define MIE_MTIE     (1 << 7)
+#define MIE_MEIE     (1 << 11)
+#define MSTATUS_MIE  (1 << 3)
+#define MCAUSE_MTI   0x80000007
+#define MCAUSE_MEI   0x8000000b
+
+volatile int32_t *a = (volatile int32_t *) 0x1F000;
+volatile int32_t *b = (volatile int32_t *) 0x1F004;
+volatile int32_t *y = (volatile int32_t *) 0x1F008;
+volatile uint32_t *ticks = (volatile uint32_t *) 0x1F00C;
+
+volatile uint32_t *mtime    = (volatile uint32_t *) (CLINT_BASE + 0x00);
+volatile uint32_t *doorbell = (volatile uint32_t *) (CLINT_BASE + 0x08);
+volatile uint32_t *mtimecmp = (volatile uint32_t *) (CLINT_BASE + 0x40);
+
+extern "C" void trap_handler(void);
+
+static inline uint32_t hart_id(void)
+{
+    uint32_t id;
+    asm volatile ("csrr %0, mhartid" : "=r"(id));
+    return id;
+}
+
+static inline __attribute__((always_inline)) void set_next_tick(void)
+{
+    volatile uint32_t *cmp = mtimecmp + 2 * hart_id();
+    uint32_t hi;
+    uint32_t lo;
+
+    do {
+        hi = mtime[1];
+        lo = mtime[0];
+    } while (hi != mtime[1]);
+
+    uint64_t next = (((uint64_t) hi << 32) | lo) + TICK_CYCLES;
+
+    // keep the compare in the future while it is half written
+    cmp[1] = 0xffffffff;
+    cmp[0] = (uint32_t) next;
+    cmp[1] = (uint32_t) (next >> 32);
+}
+
+// _start has to stay the first function in the image
+extern "C" void _start(void)
+{
+    // 1KB of stack per hart for the trap handler
+    asm volatile ("mv sp, %0" :: "r"(STACK_TOP - (hart_id() << 10)));
+    asm volatile ("csrw mtvec, %0" :: "r"(trap_handler));
+    set_next_tick();
+    asm volatile ("csrw mie, %0" :: "r"(MIE_MTIE | MIE_MEIE));
+    asm volatile ("csrs mstatus, %0" :: "r"(MSTATUS_MIE));
+
+    while (true)
+    {
+        asm volatile ("wfi");
+    }
+}
+
+extern "C" void __attribute__((interrupt("machine"))) trap_handler(void)
+{
+    uint32_t cause;
+    asm volatile ("csrr %0, mcause" : "=r"(cause));
+
+    if (cause == MCAUSE_MTI)
+    {
+        __atomic_fetch_add(ticks, 1, __ATOMIC_RELAXED);
+        set_next_tick();
+    }
+    else if (cause == MCAUSE_MEI)
+    {
+        // ack first so a ring that lands while we compute is not lost
+        *doorbell = 1;
+        *y = *a + *b;
+    }
+}